@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Memory management.
+ *
+ * All memory that arbints use for their structs, their digits and temporary
+ * results comes from three functions, which are malloc, realloc and free by
+ * default. They can be replaced like in GMP: the sizes of the blocks are
+ * passed back when they are reallocated or freed, so the replacements don't
+ * need to keep track of them. The strings from arbint_to_str and
+ * arbint_to_hex are the exception and always come from malloc.
+ *
+ * The functions must not return NULL for sizes other than 0, otherwise the
+ * program is ended like it is when malloc fails.
+ */
+
+typedef void* (*arbint_alloc_function)(size_t size);
+typedef void* (*arbint_realloc_function)(void* ptr, size_t old_size, size_t new_size);
+typedef void (*arbint_free_function)(void* ptr, size_t size);
+
+// Replace the memory functions. NULL for any of them means the default one.
+// This should happen before any arbints exist, because blocks from the old
+// functions would be passed to the new ones.
+void arbint_set_memory_functions(arbint_alloc_function alloc_function,
+                                 arbint_realloc_function realloc_function,
+                                 arbint_free_function free_function);
+
+// Get the current memory functions. The pointers may be NULL for the ones
+// that aren't needed.
+void arbint_get_memory_functions(arbint_alloc_function* alloc_function,
+                                 arbint_realloc_function* realloc_function,
+                                 arbint_free_function* free_function);
+
+// Allocate, reallocate and free through the arena of the calling thread if
+// it has one, otherwise through the memory functions. NULL is returned on
+// failure, freeing NULL does nothing, and the contents of reallocated blocks
+// are kept up to the smaller size.
+void* arbint_allocate(size_t size);
+void* arbint_reallocate(void* ptr, size_t old_size, size_t new_size);
+void arbint_deallocate(void* ptr, size_t size);
+
+/*
+ * Arenas
+ *
+ * An arena hands out blocks that start on a cache line, from chunks that it
+ * gets from the memory functions. Blocks of up to ARBINT_ARENA_MAX_CLASS bytes
+ * are rounded up to a power of two, at least one cache line, and freed blocks
+ * are kept in a list for each of these sizes to be handed out again. Larger
+ * blocks get their own allocation.
+ *
+ * While an arena is in use by a thread, everything that arbint allocates in
+ * that thread comes from it. When the computation is done, all of it can be
+ * given back at once with arbint_arena_release, which keeps the chunks for the
+ * next one, so that a warm arena doesn't allocate at all:
+ *
+ *     arbint_arena_use(arena);
+ *     ... compute with arbints, without freeing them ...
+ *     arbint_arena_use(NULL);
+ *     arbint_arena_release(arena);
+ *
+ * Blocks from the memory functions that reach an arena, for example when an
+ * arbint from before is reallocated, go back to the memory functions.
+ * Arbints that hold blocks from an arena must not be used after it's
+ * released, and must be freed, if at all, while the arena is in use.
+ *
+ * An arena must only be used by one thread at a time.
+ */
+
+typedef struct arbint_arena_struct* arbint_arena;
+
+#define ARBINT_ARENA_CACHE_LINE 64
+#define ARBINT_ARENA_MAX_CLASS ((size_t) 1 << 18)
+
+// Allocate an empty arena, which gets its first chunk when it's used
+arbint_arena arbint_arena_new(void);
+
+// Give everything back to the memory functions, and free the arena
+void arbint_arena_free(arbint_arena arena);
+
+// Free all blocks at once, keeping the chunks
+void arbint_arena_release(arbint_arena arena);
+
+// Make `arena` the one of the calling thread, or go back to the memory
+// functions with NULL. Returns the one that was used before.
+arbint_arena arbint_arena_use(arbint_arena arena);
+
+// Number of bytes the arena has from the memory functions
+size_t arbint_arena_size(arbint_arena arena);
@@ -2,9 +2,16 @@
 
 #include <stdint.h>
 
+#include "allocation.h"
+#include "bitwise.h"
 #include "datatypes.h"
+#include "gcd.h"
 #include "helper-functions.h"
+#include "modular.h"
 #include "operators.h"
+#include "product.h"
+#include "summation.h"
+#include "thread-pool.h"
 
 /* Constructor functions */
 
@@ -12,16 +19,24 @@
 // `to_fill`
 //  - `base` can be between 2 and 36, inclusive
 //  - `input_str` can include a leading +/- sign
-//  - After that sign, `input_str` can only contain characters valid in the
+//  - In base 16 and base 2, the digits can start with a 0x or 0b prefix
+//  (after the sign)
+//  - After the sign and prefix, `input_str` can only contain characters valid in the
 //  given `base`
 //    '0'..'9' are interpreted as 0..9, 'A'..'Z' and 'a'..'z' as 10..35
+//  - In bases 2, 4, 8, 16 and 32, the digits are converted to bits directly,
+//  in time linear in the length of `input_str`
 //  - to_fill->value is (re)allocated when it's not large enough or when it's
 //  NULL
 void str_to_arbint(char* input_str, arbint to_fill, uint32_t base);
 
 // Construct an arbint from an uint64_t
-//  - If the upper 32 bits are 0, the result will have length 1, otherwise 2
+//  - The result has length 1 with 64-bit limbs. With LIMB_BITS=32 it has length 2
+//  if the upper 32 bits are nonzero, otherwise 1
 //  - The sign will always be positive
+//  - The value is stored inside the struct, and the previous value of
+//  `to_fill` is deallocated, so `to_fill` must be initialised (or have a NULL
+//  value)
 void u64_to_arbint(uint64_t value, arbint to_fill);
 
 /* Initialisation functions */
@@ -31,9 +46,12 @@ void u64_to_arbint(uint64_t value, arbint to_fill);
 arbint arbint_new(void);
 
 // Allocate an arbint
-//  - Returns an arbint with value=0, length=`length`, sign=POSITIVE
+//  - Returns an arbint with value=0, length=1, sign=POSITIVE and room for
+//  `length` digits
 //    -> Useful if you know that it will hold a large value and want to avoid
 //    realloc's
+//  - Values of up to ARBINT_INLINE_LIMBS digits are stored inside the struct,
+//  so small arbints take a single allocation
 arbint arbint_new_length(size_t length);
 
 // Allocate an arbint
@@ -42,16 +60,25 @@ arbint arbint_new_length(size_t length);
 //    use!
 arbint arbint_new_empty();
 
+// Initialise an arbint_struct that the caller provides, for example on the
+// stack, to 0 with length 1
+//  - Doesn't allocate anything until the value grows beyond
+//  ARBINT_INLINE_LIMBS digits
+//  - Release it with arbint_free_value instead of arbint_free
+void arbint_init(arbint to_init);
+
 /* Reset functions */
 
 // Resets an arbint to 0
-//  - Reallocate the value array to contain one digit, set length to 1
+//  - Deallocate the value array and use one digit inside the struct, set
+//  length to 1
 //  - Set that digit to 0
 //  - Set the sign to POSITIVE
 void arbint_reset(arbint to_reset);
 
 // Reset an arbint to 0
-//  - Sets all digits to 0, but keeps length and sign
+//  - Sets length to 1, the digit to 0 and the sign to POSITIVE, but keeps the
+//  room for the digits
 void arbint_set_zero(arbint new_arbint);
 
 // Deallocate an arbint and its value.
@@ -66,8 +93,91 @@ void arbint_free_value(arbint to_free);
 //  - `to_mul` is reallocated if the result wouldn't fit otherwise
 void arbint_mul(arbint to_mul, uint32_t multiplier);
 
-// Should at some point convert to an actual string in arbitrary base
-void arbint_to_str(arbint to_convert, char** to_fill /*, uint32_t base*/);
+// Multiplies two arbints and returns the product in a newly allocated arbint
+//  - Works for all sign combinations
+//  - Uses schoolbook multiplication for small numbers and Karatsuba or Toom-3
+//  for larger ones
+arbint arbint_mul_arbint(arbint a, arbint b);
+
+// Multiplies two arbints and stores the product in `result`
+//  - `result->value` is only reallocated if it's too short for the product, so
+//  it can be reused in loops
+//  - `result` may be the same arbint as `a` or `b`
+void arbint_mul_arbint_into(arbint result, arbint a, arbint b);
+
+// Number of digits that are enough to hold a * b. A result arbint with at least
+// this many digits is never reallocated by arbint_mul_arbint_into.
+size_t arbint_mul_size(arbint a, arbint b);
+
+// Squares an arbint and returns the result in a newly allocated arbint
+//  - About twice as fast as arbint_mul_arbint(a, a) for small numbers,
+//  because every cross product a[i] * a[j] is only computed once
+arbint arbint_sqr(arbint a);
+
+// Squares an arbint and stores the result in `result`
+//  - Reallocates like arbint_mul_arbint_into, `result` may be `a`
+void arbint_sqr_into(arbint result, arbint a);
+
+// Number of digits that are enough to hold a * a, see arbint_mul_size
+size_t arbint_sqr_size(arbint a);
+
+// a += b * c and a -= b * c, for all sign combinations
+//  - Products with a factor of one digit are added in the same pass that
+//  computes them. Larger ones are computed with the faster multiplication
+//  algorithms into a temporary and added in place.
+//  - Like arbint_add_inplace, only the digits of `a` that the product or a
+//  carry reaches are touched, and `a` only grows if the result doesn't fit
+//  - `a` may be the same arbint as `b` or `c`
+void arbint_addmul(arbint a, arbint b, arbint c);
+void arbint_submul(arbint a, arbint b, arbint c);
+
+// a += b * c and a -= b * c for a single digit `c`
+void arbint_addmul_ui(arbint a, arbint b, limb_t c);
+void arbint_submul_ui(arbint a, arbint b, limb_t c);
+
+// Divides `a` by `b` and stores the quotient in `quotient` and the remainder
+// in `remainder`
+//  - The quotient is rounded towards zero and the remainder has the sign of
+//  `a`, so that a = quotient * b + remainder, like / and % in C
+//  - `quotient` and `remainder` must be different arbints, but either may be
+//  `a` or `b`. They're only reallocated if they're too short.
+//  - Long division for small numbers and recursive (Burnikel-Ziegler)
+//  division for large ones, which takes a few times as long as a
+//  multiplication of the same size
+//  - Exits with EDOM if `b` is 0
+void arbint_divmod(arbint quotient, arbint remainder, arbint a, arbint b);
+
+// Divides `a` by a single limb, stores the quotient in `quotient` and returns
+// the absolute value of the remainder
+//  - The quotient is rounded towards zero, so the remainder has the sign of
+//  `a`, like / and % in C
+//  - `quotient` may be `a`, and is only reallocated if it's too short
+//  - Uses a precomputed reciprocal of the divisor instead of hardware division
+//  - Exits with EDOM if `divisor` is 0
+limb_t arbint_divmod_ui(arbint quotient, arbint a, limb_t divisor);
+
+// Returns `a` mod `divisor`, which is between 0 and divisor - 1 for negative
+// numbers as well
+//  - Faster than arbint_divmod_ui, because the quotient isn't needed
+//  - Exits with EDOM if `divisor` is 0
+limb_t arbint_mod_ui(arbint a, limb_t divisor);
+
+// Allocates and fills *to_fill with the digits of to_convert in `base`
+//  - `base` can be between 2 and 36, inclusive
+//  - Digits above 9 are written as 'A'..'Z', negative numbers start with '-'
+//  - Long numbers are converted by divide and conquer
+void arbint_to_str(arbint to_convert, char** to_fill, uint32_t base);
 
 // Allocates and fills *to_fill with a hex representation of to_convert
+//  - Uppercase digits without leading zeroes, "0" for 0
+//  - The string is allocated with its exact length
 void arbint_to_hex(arbint to_convert, char** to_fill);
+
+// Writes the hex representation of to_convert to `buffer` and returns its
+// length, without the terminating '\0'
+//  - `buffer` must have room for arbint_to_hex_size(to_convert) characters
+size_t arbint_to_hex_into(arbint to_convert, char* buffer);
+
+// Number of characters of the hex representation of to_convert, including a
+// '-' sign and the terminating '\0'
+size_t arbint_to_hex_size(arbint to_convert);
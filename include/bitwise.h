@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "datatypes.h"
+
+/*
+ * Shifts and bitwise operations.
+ *
+ * Negative numbers behave as if they were stored in two's complement with
+ * infinitely many leading one bits, like in GMP: -1 has all bits set, and
+ * -6 = ...11010. So a & b, a | b and a ^ b have the same bits as the machine
+ * instructions would have on numbers that fit into a register.
+ *
+ * The results are only reallocated if they are too short, and may be any of
+ * the operands.
+ */
+
+// result = a * 2^count
+void arbint_shl(arbint result, arbint a, size_t count);
+
+// result = floor(a / 2^count), which shifts the two's complement bits of
+// negative numbers as well, so that -5 >> 1 = -3
+void arbint_shr(arbint result, arbint a, size_t count);
+
+// result = a & b
+void arbint_and(arbint result, arbint a, arbint b);
+
+// result = a | b
+void arbint_or(arbint result, arbint a, arbint b);
+
+// result = a ^ b
+void arbint_xor(arbint result, arbint a, arbint b);
+
+// result = ~a, which is -a - 1
+void arbint_not(arbint result, arbint a);
+
+// Returns the bit of `a` with weight 2^index
+bool arbint_test_bit(arbint a, size_t index);
+
+// Set the bit of `a` with weight 2^index to 1
+void arbint_set_bit(arbint a, size_t index);
+
+// Set the bit of `a` with weight 2^index to 0
+void arbint_clear_bit(arbint a, size_t index);
+
+// Number of one bits of `a`, or SIZE_MAX if `a` is negative and so has
+// infinitely many
+size_t arbint_popcount(arbint a);
+
+// Number of bits of |a| without leading zeros, 0 for 0
+size_t arbint_bit_length(arbint a);
+
+// Number of trailing zero bits of `a`, which is the index of its lowest one
+// bit for either sign, or SIZE_MAX for 0
+size_t arbint_trailing_zeros(arbint a);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datatypes.h"
+
+/*
+ * Conversion between strings of digits and raw limb arrays.
+ *
+ * Short strings are converted digit chunk by digit chunk: as many digits as
+ * fit into one limb are collected into a single number first, which is then
+ * added to the result with one pass over its limbs. In bases up to 10, the
+ * digits of a chunk are read 8 at a time with arithmetic on 64-bit words.
+ *
+ * That is still quadratic in the length of the string, so long strings are
+ * split in two instead. Both halves are converted recursively and combined as
+ *
+ *   high * base^(digits in low) + low
+ *
+ * which makes the conversion about as fast as a multiplication of numbers of
+ * that size. The powers of the base are computed once per conversion by
+ * repeated squaring and reused on all levels of the recursion.
+ *
+ * None of that is needed in bases 2, 4, 8, 16 and 32, where every digit stands
+ * for a fixed group of bits. Their digits are packed into the limbs directly
+ * in a single pass.
+ *
+ * Output works the same way in reverse: a short number is divided by the
+ * largest power of the base that fits into a limb until nothing is left, which
+ * splits off one chunk of digits per division. Long numbers are split by
+ * dividing by the power of the base with about half as many limbs, and the
+ * quotient and the remainder are converted recursively.
+ */
+
+// If a string has at least this many limbs worth of digits, it's converted by
+// divide and conquer instead of chunk by chunk
+#define FROM_STR_DC_THRESHOLD 40
+
+// Numbers with at least this many limbs are written to strings by divide and
+// conquer
+#define TO_STR_DC_THRESHOLD 30
+
+// Number of characters at the start of the `count` characters at `str` that
+// are valid digits in `base`, which is `count` if they all are. In bases up to
+// 10, the digits are checked 8 at a time.
+size_t count_valid_digits(const char* str, size_t count, unsigned int base);
+
+// Number of limbs that are enough for the value of any string of `count`
+// digits in `base`. In power of two bases, that's just
+// the number of bits rounded up to whole limbs.
+size_t limbs_from_str_size(size_t count, unsigned int base);
+
+// Number of characters that it takes to write {up, n} in `base`, exactly
+//  - The bit length gives it in power of two bases, and in others whenever it
+//  fixes the number of digits. Otherwise the number is compared with a power
+//  of the base, which costs about as much as one multiplication of its size.
+size_t limbs_to_str_size(const limb_t* up, size_t n, unsigned int base);
+
+// Write the digits of {up, n} in `base` to str, most significant first, with
+// '0'..'9' and 'A'..'Z' as digits and without a terminating '\0'
+//  - Requires 2 <= base <= 36
+//  - str must have room for limbs_to_str_size(up, n, base) characters
+//  - Returns the number of digits, which is 1 for 0
+size_t limbs_to_str(char* str, const limb_t* up, size_t n, unsigned int base);
+
+// Convert the `count` digits at `str` (most significant first) in the given
+// base to a number and write it to rp.
+//  - Requires 2 <= base <= 36, and that all characters are valid digits in
+//  that base (see count_valid_digits)
+//  - rp must have room for limbs_from_str_size(count, base) limbs
+//  - Returns the number of limbs of the result without leading zeroes, which
+//  is 0 if the value is 0. Limbs above that are left undefined.
+size_t limbs_from_str(limb_t* rp, const char* str, size_t count, unsigned int base);
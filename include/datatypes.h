@@ -3,6 +3,31 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Width of a digit ('limb') of an arbint in bits, either 64 or 32. 64-bit
+ * limbs do twice the work per instruction on 64-bit machines and use
+ * unsigned __int128 for products and carries. Set it at build time with
+ * -DARBINT_LIMB_BITS=32 (make LIMB_BITS=32). Everything that is compiled
+ * against the library must use the same value.
+ */
+#ifndef ARBINT_LIMB_BITS
+#define ARBINT_LIMB_BITS 64
+#endif
+
+#if ARBINT_LIMB_BITS == 64
+typedef uint64_t limb_t;
+// Double-width type for products and carries of two limbs
+__extension__ typedef unsigned __int128 dlimb_t;
+#elif ARBINT_LIMB_BITS == 32
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+#else
+#error "ARBINT_LIMB_BITS must be 32 or 64"
+#endif
+
+#define LIMB_BITS ARBINT_LIMB_BITS
+#define LIMB_MAX ((limb_t) -1)
+
 typedef enum sign {
 	NEGATIVE = 0,
 	POSITIVE = 1,
@@ -11,23 +36,42 @@ typedef enum sign {
 /*
  * Basic arbitrary-sized integer data type
  *
- * value:  Array of 32-bit unsigned ints that represents the integer value.
- *         The least significant number is at index 0 and stands for 1's.
- *         The next number, at index 1, counts in units of 2^64. The value
- *         can be interpreted as a base 2^32 number where each uint32_t is
- *         a 'digit', or as a continuous, long binary number.
+ * value:  Array of limbs (LIMB_BITS-bit unsigned ints) that represents the
+ *         integer value. The least significant number is at index 0 and
+ *         stands for 1's. The next number, at index 1, counts in units of
+ *         2^LIMB_BITS. The value can be interpreted as a base 2^LIMB_BITS
+ *         number where each limb is a 'digit', or as a continuous, long
+ *         binary number.
  *
  * sign:   An enum storing the sign with values NEGATIVE or POSITIVE.
  *
- * length: An integer storing the number of uint32_t's contained in value.
- *         Whenever value is reallocated to make more space, this value must
- *         be updated with the new size.
+ * length: The number of limbs of the value. Numbers are kept normalized:
+ *         the top limb is not 0, except for the number 0 itself, which has a
+ *         single limb 0 and is positive. So 0 is recognized, and numbers
+ *         compared by size, without looking at more than one limb.
+ *
+ * capacity: The number of limbs that value has room for. The limbs from
+ *         length up to capacity are unused and may hold anything. Whenever
+ *         value is reallocated, this must be updated with the new size.
+ *
+ * inline_value: Room for ARBINT_INLINE_LIMBS limbs inside the struct. Values
+ *         of up to that many limbs are stored here, with `value` pointing to
+ *         it, so that small numbers need no allocation of their own. They
+ *         move to the heap when they grow beyond it (see arbint_resize).
+ *         Because of that pointer, an arbint_struct must not be copied by
+ *         assignment: the copy would point into the original.
  */
+
+// Number of limbs stored inside an arbint_struct, 128 bits for either width
+#define ARBINT_INLINE_LIMBS (128 / LIMB_BITS)
+
 typedef struct
 {
-	uint32_t* value;
-	enum sign sign; // POSITIVE or NEGATIVE
-	size_t length;  // Number of uint32_t's in value
+	limb_t* value;
+	enum sign sign;  // POSITIVE or NEGATIVE
+	size_t length;   // Number of limbs of the value, without leading zeros
+	size_t capacity; // Number of limbs allocated for value
+	limb_t inline_value[ARBINT_INLINE_LIMBS];
 } arbint_struct;
 
 typedef arbint_struct* arbint;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datatypes.h"
+
+/*
+ * Division of raw limb arrays.
+ *
+ * Hardware division is slow and, for a two-limb numerator, not available at
+ * all on most machines. Instead, a divisor limb d is normalized (shifted so
+ * that its top bit is set) and inverted once, after which every two-by-one
+ * limb division takes two multiplications and a few corrections (Moller and
+ * Granlund, "Improved division by invariant integers", 2011).
+ */
+
+/*
+ * A divisor limb with everything that is precomputed for it, so that numbers
+ * that are divided by the same limb over and over again only pay for that
+ * once. With B = 2^LIMB_BITS:
+ *
+ * powers: B^1..B^5 mod divisor, which limbs_mod_1_preinv uses for divisors
+ *         below MOD_1_FOLD_LIMIT. Each of those steps folds four limbs into
+ *         a two-limb residue with independent multiplications, and a single
+ *         division at the end reduces the residue.
+ */
+typedef struct
+{
+	limb_t divisor;
+	limb_t normalized; // divisor << shift, with the top bit set
+	limb_t inverse;    // limbs_invert_limb(normalized)
+	unsigned int shift;
+	limb_t powers[5];
+} limb_divisor;
+
+// Divisors below this limit are reduced four limbs at a time. The five terms
+// of a step are each less than B * divisor, so the residue stays below B^2.
+#define MOD_1_FOLD_LIMIT ((limb_t) 1 << (LIMB_BITS - 3))
+
+// Divisors and quotients with at least this many limbs are divided
+// recursively, which makes division about as fast as multiplication
+#if LIMB_BITS == 64
+#define DIV_DC_THRESHOLD 40
+#else
+#define DIV_DC_THRESHOLD 70
+#endif
+
+// Inverse of a normalized limb d (top bit set), which is
+// floor((2^(2*LIMB_BITS) - 1) / d) - 2^LIMB_BITS
+limb_t limbs_invert_limb(limb_t d);
+
+// Precompute everything for dividing by d, which must not be 0
+void limbs_divisor_init(limb_divisor* divisor, limb_t d);
+
+// {qp, n} = {up, n} / d, returns the remainder
+//  - Requires n >= 1 and d != 0
+//  - qp may be equal to up
+limb_t limbs_divrem_1(limb_t* qp, const limb_t* up, size_t n, limb_t d);
+
+// limbs_divrem_1 with a precomputed divisor
+limb_t limbs_divrem_1_preinv(limb_t* qp, const limb_t* up, size_t n,
+                             const limb_divisor* divisor);
+
+// {up, n} mod d, without computing the quotient
+//  - Requires d != 0, n can be 0
+limb_t limbs_mod_1(const limb_t* up, size_t n, limb_t d);
+
+// limbs_mod_1 with a precomputed divisor
+limb_t limbs_mod_1_preinv(const limb_t* up, size_t n, const limb_divisor* divisor);
+
+// Divide {np, nn} by {dp, dn}. Writes the nn - dn + 1 limbs of the quotient to
+// qp and the dn limbs of the remainder to rp.
+//  - Requires nn >= dn >= 1 and dp[dn - 1] != 0
+//  - qp and rp must not overlap with each other, np or dp
+//  - Schoolbook division (Knuth's Algorithm D), or Burnikel-Ziegler recursive
+//  division if both the divisor and the quotient have at least
+//  DIV_DC_THRESHOLD limbs
+void limbs_div_qr(limb_t* qp, limb_t* rp, const limb_t* np, size_t nn, const limb_t* dp,
+                  size_t dn);
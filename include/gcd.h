@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "datatypes.h"
+
+// Stores the greatest common divisor of `a` and `b` in `result`
+//  - The result is never negative, and gcd(0, 0) = 0
+//  - `result` may be `a` or `b`
+//  - Lehmer's algorithm, which takes numbers about one limb closer to their
+//  gcd with each step, and for large numbers the half-gcd algorithm, which
+//  takes n limbs down to n/2 in about the time of a few multiplications
+void arbint_gcd(arbint result, arbint a, arbint b);
+
+// Stores gcd(a, b) in `g` and cofactors with g = s * a + t * b in `s` and `t`
+//  - `t` can be NULL if it isn't needed, which saves a multiplication and a
+//  division
+//  - `g`, `s` and `t` must be different arbints, but any of them may be `a` or
+//  `b`
+//  - |s| <= |b| / g and |t| <= |a| / g
+void arbint_gcdext(arbint g, arbint s, arbint t, arbint a, arbint b);
+
+// Stores the inverse of `a` modulo |m| in `result`, between 0 and |m| - 1
+//  - Returns false and leaves `result` as it is if there is no inverse,
+//  which is when gcd(a, m) != 1
+//  - Exits with EDOM if `m` is 0
+bool arbint_invert(arbint result, arbint a, arbint m);
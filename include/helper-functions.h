@@ -17,8 +17,42 @@ bool addition_will_wrap(uint32_t a, uint32_t b);
 
 arbint arbint_copy(arbint src);
 
+// Copy the value of `src` to `dest`, which is only reallocated if it's too
+// short
+void arbint_copy_into(arbint dest, arbint src);
+
+// Exchange the values of `a` and `b` without copying their digits
+void arbint_swap(arbint a, arbint b);
+
+// Position of the top digit of `input`, 0 for 0
 size_t arbint_highest_digit(arbint input);
 
+// Reallocate the value of `to_resize` to room for `capacity` digits
+//  - The value is kept. If it's longer, it's cut down to its lower
+//  `capacity` digits.
+//  - The new digits above the value are not initialised
+//  - Values of up to ARBINT_INLINE_LIMBS digits that are stored inside the
+//  struct stay there, larger ones move to the heap
+void arbint_resize(arbint to_resize, size_t capacity);
+
+// Make sure that `to_grow` has room for at least `capacity` digits, keeping
+// its value
+//  - The capacity grows by at least half, so that repeated growth by a digit
+//  only reallocates a logarithmic number of times
+void arbint_reserve(arbint to_grow, size_t capacity);
+
+// Make the first `length` digits of `a`, which may have leading zeros, its
+// value
+//  - Sets a->length to the number of digits without the leading zeros
+//  - 0 gets a single digit and becomes positive
+void arbint_normalize(arbint a, size_t length);
+
+// True if the value of `a` is stored inside the struct instead of on the heap,
+// so that it must not be passed to free or realloc
+bool arbint_value_is_inline(arbint a);
+
+// Give up the capacity of `to_trim` beyond its value. Values that are short
+// enough move back into the struct.
 void arbint_trim(arbint to_trim);
 
 /* Print functions (for debugging) */
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datatypes.h"
+
+/*
+ * Low-level arithmetic on limb arrays
+ *
+ * A number {ap, n} is the array of n base 2^LIMB_BITS digits ('limbs') at ap, least
+ * significant first, like the value of an arbint. These functions only do the
+ * math: they never allocate, the caller makes sure that the result array is
+ * large enough. Carries and borrows are returned instead of stored, so the
+ * caller decides whether the number has to grow.
+ *
+ * Unless noted otherwise, rp may be equal to ap or bp (but not overlap them
+ * partially). When rp == ap, the functions that propagate a carry through the
+ * upper part of a stop as soon as the carry is gone.
+ *
+ * On x86-64, add_n and sub_n are written in assembly, and mul_1, addmul_1 and
+ * mul_basecase use mulx, adcx and adox on CPUs with BMI2 and ADX, which is
+ * checked once when the library is loaded.
+ */
+
+// {rp, n} = {ap, n} + {bp, n}, returns the carry (0 or 1)
+limb_t limbs_add_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n);
+
+// {rp, an} = {ap, an} + {bp, bn}, requires an >= bn, returns the carry
+limb_t limbs_add(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn);
+
+// {rp, n} = {ap, n} + b, returns the carry
+limb_t limbs_add_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+
+// {rp, n} = {ap, n} - {bp, n}, returns the borrow (0 or 1)
+limb_t limbs_sub_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n);
+
+// {rp, an} = {ap, an} - {bp, bn}, requires an >= bn, returns the borrow
+limb_t limbs_sub(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn);
+
+// {rp, n} = {ap, n} - b, returns the borrow
+limb_t limbs_sub_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+
+// {rp, n} = {ap, n} * b, returns the most significant limb of the product
+limb_t limbs_mul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+
+// {rp, n} += {ap, n} * b, returns the carry limb
+//  - rp must not be ap
+limb_t limbs_addmul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+
+// {rp, an + bn} = {ap, an} * {bp, bn} by schoolbook multiplication
+//  - Requires an >= bn >= 1
+//  - rp must not overlap with ap or bp
+void limbs_mul_basecase(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp,
+                        size_t bn);
+
+// {rp, n} -= {ap, n} * b, returns the borrow limb
+//  - rp must not be ap
+limb_t limbs_submul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+
+// {rp, n} = {ap, n} << count, returns the bits shifted out at the top
+//  - Requires 0 < count < LIMB_BITS
+limb_t limbs_lshift(limb_t* rp, const limb_t* ap, size_t n, unsigned int count);
+
+// {rp, n} = {ap, n} >> count, returns the bits shifted out at the bottom in the
+// upper bits of the returned limb
+//  - Requires 0 < count < LIMB_BITS
+limb_t limbs_rshift(limb_t* rp, const limb_t* ap, size_t n, unsigned int count);
+
+// {rp, n} = {ap, n} & {bp, n}, | and ^ respectively
+void limbs_and_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n);
+void limbs_ior_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n);
+void limbs_xor_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n);
+
+// {rp, n} = ~{ap, n}, the complement of every bit
+void limbs_com(limb_t* rp, const limb_t* ap, size_t n);
+
+// Number of one bits in {ap, n}
+size_t limbs_popcount(const limb_t* ap, size_t n);
+
+// Compare {ap, n} and {bp, n}: +1 if a > b, 0 if a == b, -1 if a < b
+int limbs_cmp(const limb_t* ap, const limb_t* bp, size_t n);
+
+// Number of limbs of {ap, n} without leading zeroes, 0 if the number is zero
+size_t limbs_significant(const limb_t* ap, size_t n);
+
+// Number of leading zero bits of a limb, LIMB_BITS for 0
+unsigned int limb_leading_zeros(limb_t x);
+
+// Number of trailing zero bits of a limb, LIMB_BITS for 0
+unsigned int limb_trailing_zeros(limb_t x);
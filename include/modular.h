@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "datatypes.h"
+
+/*
+ * Arithmetic modulo a fixed number m with n limbs.
+ *
+ * A modulus context holds everything that can be precomputed for m, so that
+ * the modular operations never divide:
+ *
+ *  - If m is odd, numbers are kept in Montgomery form a * R mod m, with
+ *  R = 2^(n * LIMB_BITS). A product of two such numbers is reduced by adding
+ *  the multiple of m that clears its lower n limbs, which leaves
+ *  a * b * R mod m in the upper ones (Montgomery's REDC).
+ *  - If m is even, numbers are kept as they are and a product is reduced with
+ *  Barrett's method, which estimates the quotient by multiplying with a
+ *  precomputed reciprocal of m.
+ *
+ * arbint_to_mod brings a number into the form of the context and
+ * arbint_from_mod brings it back. In between, it can go through any number of
+ * modular operations, which all take and return numbers in the form of the
+ * context. Those are between 0 and m - 1.
+ *
+ * The context holds the scratch space of the operations, so one context must
+ * not be used by several threads at once.
+ */
+typedef struct
+{
+	limb_t* modulus;    // m without leading zero limbs
+	size_t length;      // n, the number of limbs of m
+	bool montgomery;    // m is odd and numbers are in Montgomery form
+	limb_t inverse;     // -1 / m mod 2^LIMB_BITS, for REDC
+	limb_t* inverse_n;  // -1 / m mod R, for REDC of large numbers
+	limb_t* r_squared;  // R^2 mod m, for converting into Montgomery form
+	limb_t* reciprocal; // floor(2^(2 * n * LIMB_BITS) / m), for Barrett reduction
+	size_t reciprocal_length;
+	limb_t* scratch; // Operands, products and reductions
+} arbint_mod_ctx_struct;
+
+typedef arbint_mod_ctx_struct* arbint_mod_ctx;
+
+// Allocate a context for arithmetic modulo |modulus|
+//  - Computes the constants with one division, so it pays off as soon as a few
+//  products are reduced
+//  - Exits with EDOM if `modulus` is 0
+arbint_mod_ctx arbint_mod_ctx_new(arbint modulus);
+
+// Deallocate a context and everything it holds
+void arbint_mod_ctx_free(arbint_mod_ctx ctx);
+
+// Reduce `a` modulo m and store it in the form of the context in `result`
+//  - `a` can have any sign and size, negative numbers are reduced to 0..m - 1
+//  - `result` may be `a`
+void arbint_to_mod(arbint result, arbint a, arbint_mod_ctx ctx);
+
+// Convert `a` from the form of the context back into a plain number
+//  - `result` may be `a`
+void arbint_from_mod(arbint result, arbint a, arbint_mod_ctx ctx);
+
+// result = a * b mod m
+//  - `a` and `b` must be in the form of the context, `result` may be either
+void arbint_mulmod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx);
+
+// result = a * a mod m, faster than arbint_mulmod(result, a, a, ctx)
+void arbint_sqrmod(arbint result, arbint a, arbint_mod_ctx ctx);
+
+// result = a + b mod m
+void arbint_addmod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx);
+
+// result = a - b mod m
+void arbint_submod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx);
+
+// result = base^exp mod |mod|
+//  - Sliding windows over the bits of `exp`, with the window size picked from
+//  its length, and all products reduced in Montgomery form for odd moduli
+//  - The result is between 0 and |mod| - 1, `result` may be any of the operands
+//  - A negative `exp` raises the inverse of `base` to -exp
+//  - Exits with EDOM if `mod` is 0, or if `exp` is negative and `base` has no
+//  inverse modulo `mod`
+void arbint_powm(arbint result, arbint base, arbint exp, arbint mod);
+
+// result = base^exp mod m, with `base` and `result` in the form of the context
+//  - Saves converting numbers for every exponentiation, for example when
+//  testing many bases against the same modulus
+//  - Exits with EDOM if `exp` is negative
+void arbint_powm_ctx(arbint result, arbint base, arbint exp, arbint_mod_ctx ctx);
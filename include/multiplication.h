@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datatypes.h"
+
+/*
+ * Multiplication of raw limb arrays.
+ *
+ * These functions work on plain arrays of base 2^LIMB_BITS digits (least significant
+ * first) instead of arbints, so that the recursive algorithms can work on
+ * parts of a number without copying them into new arbints.
+ */
+
+/*
+ * The thresholds are in limbs, so they depend on the limb width. A 64-bit limb
+ * product costs about as much as a 32-bit one but covers four times as much of
+ * the result, so the basecase stops paying off earlier.
+ */
+#if LIMB_BITS == 64
+
+// Below this many limbs, the schoolbook (basecase) multiplication is used
+#define KARATSUBA_THRESHOLD 24
+
+// From this many limbs on, Toom-3 is used instead of Karatsuba
+#define TOOM3_THRESHOLD 128
+
+// If the shorter operand has at least this many limbs, the product is computed
+// with number-theoretic transforms (see ntt.h)
+#define NTT_THRESHOLD 1000
+
+// The same thresholds for squaring. The basecase does about half the work of
+// a general multiplication, so it pays off for longer.
+#define SQR_KARATSUBA_THRESHOLD 32
+#define SQR_TOOM3_THRESHOLD 160
+#define SQR_NTT_THRESHOLD 1000
+
+#else
+
+#define KARATSUBA_THRESHOLD 40
+#define TOOM3_THRESHOLD 250
+#define NTT_THRESHOLD 1000
+#define SQR_KARATSUBA_THRESHOLD 56
+#define SQR_TOOM3_THRESHOLD 250
+#define SQR_NTT_THRESHOLD 1000
+
+#endif
+
+// Multiply {ap, an} by {bp, bn} and write the an + bn limbs of the product to
+// rp.
+//  - Requires an >= bn >= 1
+//  - rp must not overlap with ap or bp
+//  - Picks schoolbook, Karatsuba, Toom-3 or NTT depending on the operand sizes
+void limbs_mul(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn);
+
+// Square {ap, n} and write the 2n limbs of the result to rp.
+//  - Requires n >= 1
+//  - rp must not overlap with ap
+void limbs_sqr(limb_t* rp, const limb_t* ap, size_t n);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datatypes.h"
+
+/*
+ * Multiplication by number-theoretic transforms (NTT).
+ *
+ * The operands are cut into 64-bit coefficients and their cyclic convolution
+ * is computed modulo three primes p < 2^61 of the form k * 2^e + 1, which
+ * have roots of unity for all power-of-two transform lengths up to 2^48. The
+ * exact coefficients of the product are then recovered with the Chinese
+ * remainder theorem. A coefficient of the product is a sum of at most
+ * min(an, bn) products of two limbs, so it is below min(an, bn) * (2^64 - 1)^2.
+ * The product p0 * p1 * p2 of the primes is larger than 2^182, so this bound
+ * stays below it for any min(an, bn) < 2^54, far beyond what fits into memory.
+ */
+
+// Multiply {ap, an} by {bp, bn} and write the an + bn limbs of the product to
+// rp in O(n log n) time.
+//  - Requires an >= bn >= 1
+//  - rp must not overlap with ap or bp
+void limbs_mul_ntt(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp,
+                   size_t bn);
+
+// Square {ap, n} and write the 2n limbs of the result to rp. Only needs one
+// forward transform per prime instead of two.
+void limbs_sqr_ntt(limb_t* rp, const limb_t* ap, size_t n);
@@ -21,7 +21,7 @@ bool arbint_gt(arbint a, arbint b);  // a greater than b
 bool arbint_leq(arbint a, arbint b); // a less than or equal b
 bool arbint_geq(arbint a, arbint b); // a greater than or equal b
 
-// Reverses the sign of `to_negate`.
+// Reverses the sign of `to_negate`. 0 stays positive.
 void arbint_neg(arbint to_negate);
 
 // Adds two arbints together, assuming they're both positive.
@@ -33,7 +33,38 @@ arbint arbint_add(arbint a, arbint b);
 // Subtracts two arbints and returns the result in a newly allocated arbint
 arbint arbint_sub(arbint a, arbint b);
 
-void add_to_arbint(arbint to_add, uint32_t value, size_t position);
+/*
+ * The *_into versions store the result in an existing arbint instead of
+ * allocating a new one. result->value is only reallocated if it has room for
+ * fewer digits than the result needs, so reusing the same result arbint in a
+ * loop doesn't allocate anything once it is large enough. `result` may be the
+ * same arbint as `a` or `b`.
+ */
+
+// Like arbint_add_primitive, but stores abs(a) + abs(b) in `result`
+void arbint_add_primitive_into(arbint result, arbint a, arbint b);
+
+// Stores a + b in `result`
+void arbint_add_into(arbint result, arbint a, arbint b);
+
+// Stores a - b in `result`
+void arbint_sub_into(arbint result, arbint a, arbint b);
+
+// a += b and a -= b
+//  - Only the digits of `a` that `b` or a carry reaches are touched, so adding
+//  small numbers to a large accumulator takes time in the size of the small
+//  ones
+//  - `a` only grows when a carry leaves its top digit, or when `b` is longer
+void arbint_add_inplace(arbint a, arbint b);
+void arbint_sub_inplace(arbint a, arbint b);
+
+// Number of digits that are enough to hold a + b or a - b, for any signs.
+// Allocating the result with arbint_new_length(arbint_add_size(a, b)) means
+// that arbint_add_into never has to reallocate it.
+size_t arbint_add_size(arbint a, arbint b);
+size_t arbint_sub_size(arbint a, arbint b);
+
+void add_to_arbint(arbint to_add, limb_t value, size_t position);
 
 // Returns true if a == 0, false if not
 bool arbint_is_zero(arbint a);
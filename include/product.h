@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "datatypes.h"
+
+/*
+ * Products of many numbers, and the combinatorial functions built on them.
+ *
+ * The factors are multiplied in a balanced tree: the two halves of the list
+ * are multiplied recursively and their products multiplied at the end, so
+ * that both sides of every multiplication have about the same size and the
+ * fast algorithms (Karatsuba, Toom-3, NTT) can be used for the large ones.
+ * Multiplying the factors one at a time instead takes quadratic time. The
+ * halves of large products go to the thread pool like for arbint_sum (see
+ * arbint_set_threads in thread-pool.h).
+ */
+
+// Stores factors[0] * ... * factors[n - 1] in `result`, 1 for n = 0
+//  - The halves of the tree are split by the number of digits of the
+//  factors, not their count
+//  - `result` may be one of the factors
+void arbint_product(arbint result, arbint* factors, size_t n);
+
+// Stores the product of the single-digit `factors` in `result`, 1 for n = 0
+//  - Neighbouring factors whose product fits in a digit are multiplied first,
+//  so that the leaves of the tree are full digits
+void arbint_product_ui(arbint result, const limb_t* factors, size_t n);
+
+// Stores n! in `result`
+//  - Uses the prime swing algorithm: n! = (n/2)!^2 * swing(n), where swing(n)
+//  is a product of prime powers that is computed with a product tree. The
+//  powers of 2 are added with a single shift at the end.
+void arbint_fac_ui(arbint result, limb_t n);
+
+// Stores the binomial coefficient n choose k in `result`, 0 for k > n
+//  - For k close to 0 or n, the product of the k factors (n - k + 1) ... n is
+//  divided by k!. Otherwise the result is built from its prime factorization,
+//  whose exponents are the carries of adding k and n - k in base p (Kummer).
+void arbint_bin_uiui(arbint result, limb_t n, limb_t k);
+
+// Stores the product of all primes <= n in `result`, 1 for n < 2
+void arbint_primorial_ui(arbint result, limb_t n);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "datatypes.h"
+
+/*
+ * Sums and dot products of arrays of arbints.
+ *
+ * The terms are added digit by digit into accumulators of two limbs per
+ * digit, so the carries are only propagated once at the end instead of for
+ * every term, and no intermediate arbints are allocated. Large arrays are
+ * split into halves recursively, with the second half going to the thread
+ * pool while there are threads left (see arbint_set_threads in
+ * thread-pool.h), and the sums of the halves added pairwise. The result is
+ * exact, so it doesn't depend on the number of threads.
+ */
+
+// Returns terms[0] + ... + terms[n - 1] in a newly allocated arbint, 0 for n = 0
+arbint arbint_sum(arbint* terms, size_t n);
+
+// Returns a[0] * b[0] + ... + a[n - 1] * b[n - 1] in a newly allocated arbint
+arbint arbint_dot(arbint* a, arbint* b, size_t n);
+
+// Like arbint_sum and arbint_dot, but store the result in `result`, which may
+// be one of the terms
+void arbint_sum_into(arbint result, arbint* terms, size_t n);
+void arbint_dot_into(arbint result, arbint* a, arbint* b, size_t n);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Threads.
+ *
+ * Work that splits into independent parts (the halves of a sum or a product
+ * tree, the sub-products of Karatsuba and Toom-3, the transforms of an NTT
+ * multiplication) is handed to a pool of worker threads as tasks. Every
+ * thread has a deque of the tasks it handed out: it takes them back from the
+ * end, newest first, and when it runs out it steals the oldest task of
+ * another thread, which is the largest one near the root of its recursion.
+ * A thread that waits for a task runs other tasks in the meantime, so nested
+ * parallel calls can't run out of threads, and sleeps only when there are
+ * none left, until its own task is done.
+ *
+ * Every deque has its own lock, and finishing a task only wakes the thread
+ * that spawned it. Threads that call arbint functions get a deque of their
+ * own while they have tasks in the pool, up to as many as there are threads;
+ * the tasks of further ones run right away.
+ *
+ * The workers are started when they're first needed. Tasks run without an
+ * arena, even on a thread that uses one, because the blocks they allocate may
+ * be freed by another thread. They allocate from the memory functions (see
+ * allocation.h), which then must be safe to call from several threads at once.
+ */
+
+// Below this many limbs, multiplications stay on the calling thread
+#define ARBINT_THREAD_THRESHOLD 2048
+
+// Set the number of threads that arbint functions may use, including the
+// calling one. The default is 1, and 0 means 1 as well.
+//  - Stops the workers of the old count, so it must not be called while
+//  other threads are in arbint functions
+void arbint_set_threads(size_t count);
+size_t arbint_get_threads(void);
+
+// Set the number of limbs from which the operands of a multiplication are
+// split over several threads, ARBINT_THREAD_THRESHOLD by default. Lower
+// values also split Karatsuba and Toom-3, which only ever see operands of
+// fewer than NTT_THRESHOLD limbs (see multiplication.h).
+void arbint_set_thread_threshold(size_t limbs);
+size_t arbint_get_thread_threshold(void);
+
+/*
+ * The pool itself, for the functions above
+ */
+
+typedef void (*thread_pool_function)(void* argument);
+typedef void (*thread_pool_range_function)(void* argument, size_t begin, size_t end);
+
+// A task lives on the stack of the thread that spawns it, which must join it
+// before it returns
+typedef struct
+{
+	thread_pool_function function;
+	void* argument;
+	size_t owner; // The deque of the spawning thread, to wake it when it's done
+	bool done;
+} thread_pool_task;
+
+// Returns true if work on `limbs` limbs should be split over threads
+bool thread_pool_active(size_t limbs);
+
+// Hand `function(argument)` to the pool. It runs right away on the calling
+// thread if there are no workers, or if the deque of the thread is full.
+void thread_pool_spawn(thread_pool_task* task, thread_pool_function function,
+                       void* argument);
+
+// Wait until the task is done, running tasks from the deques in the meantime
+void thread_pool_join(thread_pool_task* task);
+
+// Call `function(argument, begin, end)` on pieces of [0, count) that cover it,
+// in parallel. The pieces have at least `grain` elements, and there are at
+// most a few per thread.
+void thread_pool_for(size_t count, size_t grain, thread_pool_range_function function,
+                     void* argument);
@@ -0,0 +1,362 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+
+// Arena blocks go from one cache line up to ARBINT_ARENA_MAX_CLASS in powers
+// of two
+#define CLASS_COUNT 13
+
+// Every chunk is twice as large as the one before, up to the maximum, so that
+// large computations don't need many of them
+#define FIRST_CHUNK_SIZE ((size_t) 1 << 16)
+#define MAX_CHUNK_SIZE ((size_t) 1 << 24)
+
+typedef struct arena_chunk
+{
+	struct arena_chunk* next;
+	void* allocation;
+	size_t allocation_size;
+	char* start;
+	char* end;
+} arena_chunk;
+
+typedef struct large_block
+{
+	// Stored right in front of the block
+	struct large_block* next;
+	void* allocation;
+	size_t allocation_size;
+} large_block;
+
+struct arbint_arena_struct
+{
+	// All chunks in the order they are used, and the one that new blocks are
+	// cut from, starting at `top`
+	arena_chunk* chunks;
+	arena_chunk* current;
+	char* top;
+
+	// Freed blocks of each size class, linked through their first bytes
+	void* free_blocks[CLASS_COUNT];
+
+	large_block* large_blocks;
+	size_t size;
+};
+
+static void*
+default_alloc(size_t size)
+{
+	return malloc(size);
+}
+
+static void*
+default_realloc(void* ptr, size_t old_size, size_t new_size)
+{
+	(void) old_size;
+	return realloc(ptr, new_size);
+}
+
+static void
+default_free(void* ptr, size_t size)
+{
+	(void) size;
+	free(ptr);
+}
+
+static arbint_alloc_function alloc_memory     = default_alloc;
+static arbint_realloc_function realloc_memory = default_realloc;
+static arbint_free_function free_memory       = default_free;
+
+// The arena of the calling thread, if any
+static __thread arbint_arena thread_arena = NULL;
+
+void
+arbint_set_memory_functions(arbint_alloc_function alloc_function,
+                            arbint_realloc_function realloc_function,
+                            arbint_free_function free_function)
+{
+	alloc_memory   = alloc_function ? alloc_function : default_alloc;
+	realloc_memory = realloc_function ? realloc_function : default_realloc;
+	free_memory    = free_function ? free_function : default_free;
+}
+
+void
+arbint_get_memory_functions(arbint_alloc_function* alloc_function,
+                            arbint_realloc_function* realloc_function,
+                            arbint_free_function* free_function)
+{
+	if (alloc_function)
+		*alloc_function = alloc_memory;
+	if (realloc_function)
+		*realloc_function = realloc_memory;
+	if (free_function)
+		*free_function = free_memory;
+}
+
+/*
+ * Arenas
+ */
+
+static char*
+align_up(void* ptr)
+{
+	uintptr_t address = (uintptr_t) ptr;
+	uintptr_t mask    = ARBINT_ARENA_CACHE_LINE - 1;
+	return (char*)((address + mask) & ~mask);
+}
+
+static unsigned int
+size_class(size_t size)
+{
+	unsigned int class = 0;
+	while (((size_t) ARBINT_ARENA_CACHE_LINE << class) < size)
+	{
+		class++;
+	}
+	return class;
+}
+
+static bool
+in_chunks(arbint_arena arena, void* ptr)
+{
+	uintptr_t address = (uintptr_t) ptr;
+	for (arena_chunk* chunk = arena->chunks; chunk != NULL; chunk = chunk->next)
+	{
+		if (address >= (uintptr_t) chunk->start && address < (uintptr_t) chunk->end)
+			return true;
+	}
+	return false;
+}
+
+static arena_chunk*
+add_chunk(arbint_arena arena, size_t min_size)
+{
+	// Append a chunk with room for at least min_size bytes
+	arena_chunk* last = NULL;
+	size_t size       = FIRST_CHUNK_SIZE;
+	for (arena_chunk* chunk = arena->chunks; chunk != NULL; chunk = chunk->next)
+	{
+		last = chunk;
+		size = 2 * (size_t)(chunk->end - chunk->start);
+	}
+	if (size > MAX_CHUNK_SIZE)
+		size = MAX_CHUNK_SIZE;
+	if (size < min_size)
+		size = min_size;
+
+	// The header goes in front of the first cache line of the chunk
+	size_t allocation_size = sizeof(arena_chunk) + ARBINT_ARENA_CACHE_LINE - 1 + size;
+	void* allocation       = alloc_memory(allocation_size);
+	if (allocation == NULL)
+		return NULL;
+	char* start            = align_up((char*) allocation + sizeof(arena_chunk));
+	arena_chunk* chunk     = (arena_chunk*)(start - sizeof(arena_chunk));
+	chunk->next            = NULL;
+	chunk->allocation      = allocation;
+	chunk->allocation_size = allocation_size;
+	chunk->start           = start;
+	chunk->end             = start + size;
+
+	if (last)
+		last->next = chunk;
+	else
+		arena->chunks = chunk;
+	arena->size += allocation_size;
+	return chunk;
+}
+
+static void*
+allocate_large(arbint_arena arena, size_t size)
+{
+	size_t allocation_size = sizeof(large_block) + ARBINT_ARENA_CACHE_LINE - 1 + size;
+	void* allocation       = alloc_memory(allocation_size);
+	if (allocation == NULL)
+		return NULL;
+	char* block             = align_up((char*) allocation + sizeof(large_block));
+	large_block* header     = (large_block*) block - 1;
+	header->next            = arena->large_blocks;
+	header->allocation      = allocation;
+	header->allocation_size = allocation_size;
+	arena->large_blocks     = header;
+	arena->size += allocation_size;
+	return block;
+}
+
+static bool
+free_large(arbint_arena arena, void* ptr)
+{
+	// Returns false if ptr isn't one of the large blocks of the arena
+	for (large_block** link = &arena->large_blocks; *link != NULL; link = &(*link)->next)
+	{
+		large_block* header = *link;
+		if ((void*)(header + 1) == ptr)
+		{
+			*link = header->next;
+			arena->size -= header->allocation_size;
+			free_memory(header->allocation, header->allocation_size);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void*
+arena_allocate(arbint_arena arena, size_t size)
+{
+	if (size > ARBINT_ARENA_MAX_CLASS)
+		return allocate_large(arena, size);
+
+	unsigned int class = size_class(size);
+	void* block        = arena->free_blocks[class];
+	if (block != NULL)
+	{
+		arena->free_blocks[class] = *(void**) block;
+		return block;
+	}
+
+	// Cut a new block from the current chunk, or the next one that is large
+	// enough. Chunks that are skipped stay unused until the arena is released.
+	size_t block_size = (size_t) ARBINT_ARENA_CACHE_LINE << class;
+	while (arena->current == NULL ||
+	       (size_t)(arena->current->end - arena->top) < block_size)
+	{
+		arena_chunk* next = arena->current ? arena->current->next : arena->chunks;
+		if (next == NULL)
+			next = add_chunk(arena, block_size);
+		if (next == NULL)
+			return NULL;
+		arena->current = next;
+		arena->top     = next->start;
+	}
+	block = arena->top;
+	arena->top += block_size;
+	return block;
+}
+
+static void
+arena_free(arbint_arena arena, void* ptr, size_t size)
+{
+	// Blocks that didn't come from the arena go back to the memory functions
+	if (size > ARBINT_ARENA_MAX_CLASS)
+	{
+		if (!free_large(arena, ptr))
+			free_memory(ptr, size);
+		return;
+	}
+	if (!in_chunks(arena, ptr))
+	{
+		free_memory(ptr, size);
+		return;
+	}
+
+	unsigned int class        = size_class(size);
+	*(void**) ptr             = arena->free_blocks[class];
+	arena->free_blocks[class] = ptr;
+}
+
+static void*
+arena_reallocate(arbint_arena arena, void* ptr, size_t old_size, size_t new_size)
+{
+	// Blocks that keep their size class stay where they are
+	if (old_size <= ARBINT_ARENA_MAX_CLASS && new_size <= ARBINT_ARENA_MAX_CLASS &&
+	    size_class(old_size) == size_class(new_size) && in_chunks(arena, ptr))
+	{
+		return ptr;
+	}
+
+	void* new_ptr = arena_allocate(arena, new_size);
+	if (new_ptr == NULL)
+		return NULL;
+	memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+	arena_free(arena, ptr, old_size);
+	return new_ptr;
+}
+
+arbint_arena
+arbint_arena_new(void)
+{
+	arbint_arena arena = alloc_memory(sizeof(struct arbint_arena_struct));
+	if (arena == NULL)
+		return NULL;
+	memset(arena, 0, sizeof(struct arbint_arena_struct));
+	arena->size = sizeof(struct arbint_arena_struct);
+	return arena;
+}
+
+void
+arbint_arena_free(arbint_arena arena)
+{
+	arbint_arena_release(arena);
+	arena_chunk* chunk = arena->chunks;
+	while (chunk != NULL)
+	{
+		arena_chunk* next = chunk->next;
+		free_memory(chunk->allocation, chunk->allocation_size);
+		chunk = next;
+	}
+	if (thread_arena == arena)
+		thread_arena = NULL;
+	free_memory(arena, sizeof(struct arbint_arena_struct));
+}
+
+void
+arbint_arena_release(arbint_arena arena)
+{
+	while (arena->large_blocks != NULL)
+	{
+		free_large(arena, arena->large_blocks + 1);
+	}
+	memset(arena->free_blocks, 0, sizeof(arena->free_blocks));
+	arena->current = NULL;
+	arena->top     = NULL;
+}
+
+arbint_arena
+arbint_arena_use(arbint_arena arena)
+{
+	arbint_arena previous = thread_arena;
+	thread_arena          = arena;
+	return previous;
+}
+
+size_t
+arbint_arena_size(arbint_arena arena)
+{
+	return arena->size;
+}
+
+/*
+ * Allocation for the rest of the library
+ */
+
+void*
+arbint_allocate(size_t size)
+{
+	if (thread_arena)
+		return arena_allocate(thread_arena, size);
+	return alloc_memory(size);
+}
+
+void*
+arbint_reallocate(void* ptr, size_t old_size, size_t new_size)
+{
+	if (ptr == NULL)
+		return arbint_allocate(new_size);
+	if (thread_arena)
+		return arena_reallocate(thread_arena, ptr, old_size, new_size);
+	return realloc_memory(ptr, old_size, new_size);
+}
+
+void
+arbint_deallocate(void* ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+	if (thread_arena)
+		arena_free(thread_arena, ptr, size);
+	else
+		free_memory(ptr, size);
+}
@@ -5,8 +5,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocation.h"
+#include "conversion.h"
 #include "datatypes.h"
+#include "division.h"
 #include "helper-functions.h"
+#include "limbs.h"
+#include "multiplication.h"
 #include "operators.h"
 
 #include "arbint.h"
@@ -14,7 +19,8 @@
 void
 arbint_mul(arbint to_mul, uint32_t multiplier)
 {
-	// Multiply an arbint by any 32-bit unsigned integer
+	// Multiply an arbint by any 32-bit unsigned integer, which always fits into
+	// a limb
 
 	if (multiplier == 0)
 	{
@@ -28,83 +34,404 @@ arbint_mul(arbint to_mul, uint32_t multiplier)
 		return;
 	}
 
-	size_t position      = 0;
-	uint64_t temp_result = 0;
+	// Multiply all digits at once and only grow if the top digit overflows
+	size_t length = to_mul->length;
+	limb_t carry  = limbs_mul_1(to_mul->value, to_mul->value, length, multiplier);
+	if (carry)
+	{
+		arbint_reserve(to_mul, length + 1);
+		to_mul->value[length] = carry;
+		to_mul->length        = length + 1;
+	}
+}
+
+static void
+set_result_zero(arbint result)
+{
+	// Set result to 0 without giving up a value array that is already there,
+	// so that a result arbint that is reused in a loop keeps its digits
+	if (result->value == NULL)
+		arbint_reset(result);
+	else
+		arbint_set_zero(result);
+}
+
+static void
+check_divisor(bool is_zero, const char* function)
+{
+	if (is_zero)
+	{
+		fprintf(stderr, "%s: Division by zero\n", function);
+		exit(EDOM); // 33 Numerical argument out of domain
+	}
+}
+
+limb_t
+arbint_divmod_ui(arbint quotient, arbint a, limb_t divisor)
+{
+	// Divide |a| by the divisor and give the quotient the sign of a, so that
+	// it's rounded towards zero
+	check_divisor(divisor == 0, "arbint_divmod_ui");
+	size_t length = limbs_significant(a->value, a->length);
+	sign a_sign   = a->sign;
+	if (length == 0)
+	{
+		set_result_zero(quotient);
+		return 0;
+	}
+
+	arbint_reserve(quotient, length);
+	limb_t remainder = limbs_divrem_1(quotient->value, a->value, length, divisor);
+	quotient->sign   = a_sign;
+	arbint_normalize(quotient, length);
+	return remainder;
+}
+
+limb_t
+arbint_mod_ui(arbint a, limb_t divisor)
+{
+	check_divisor(divisor == 0, "arbint_mod_ui");
+	limb_t remainder = limbs_mod_1(a->value, a->length, divisor);
+	if (a->sign == NEGATIVE && remainder != 0)
+	{
+		remainder = divisor - remainder;
+	}
+	return remainder;
+}
+
+static limb_t*
+product_buffer(arbint result, arbint a, arbint b, size_t length)
+{
+	// Returns result->value if the product of a and b can be written to it
+	// directly, otherwise a newly allocated array of `length` digits.
+	// The limb functions can't write to their own operands.
+	if (result != a && result != b && result->value != NULL && result->capacity >= length)
+	{
+		return result->value;
+	}
+
+	limb_t* product = arbint_allocate(length * sizeof(limb_t));
+	if (product == NULL)
+	{
+		fprintf(stderr, "product_buffer: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return product;
+}
+
+static void
+store_product(arbint result, limb_t* product, size_t length, sign product_sign)
+{
+	// Make `product` (as returned by product_buffer) the value of result,
+	// which has `length` digits with possibly some leading zeros
+	if (product != result->value)
+	{
+		arbint_free_value(result);
+		result->value    = product;
+		result->capacity = length;
+	}
+	result->sign = product_sign;
+	arbint_normalize(result, length);
+}
+
+arbint
+arbint_mul_arbint(arbint a, arbint b)
+{
+	arbint result = arbint_new_empty();
+	arbint_mul_arbint_into(result, a, b);
+	return result;
+}
+
+void
+arbint_mul_arbint_into(arbint result, arbint a, arbint b)
+{
+	// Multiply two arbints of any sign and size and put the product in result
+
+	if (arbint_is_zero(a) || arbint_is_zero(b))
+	{
+		// x * 0 = 0
+		set_result_zero(result);
+		return;
+	}
+
+	// Leading zeroes don't need to be multiplied
+	size_t a_length = arbint_highest_digit(a) + 1;
+	size_t b_length = arbint_highest_digit(b) + 1;
+	size_t length   = a_length + b_length;
+	limb_t* product = product_buffer(result, a, b, length);
+
+	// limbs_mul wants the longer operand first
+	if (a_length >= b_length)
+		limbs_mul(product, a->value, a_length, b->value, b_length);
+	else
+		limbs_mul(product, b->value, b_length, a->value, a_length);
+
+	store_product(result, product, length, a->sign == b->sign ? POSITIVE : NEGATIVE);
+}
+
+size_t
+arbint_mul_size(arbint a, arbint b)
+{
+	// The product of an m-digit and an n-digit number has at most m + n digits
+	size_t a_length = limbs_significant(a->value, a->length);
+	size_t b_length = limbs_significant(b->value, b->length);
+	if (a_length == 0 || b_length == 0)
+	{
+		return 1;
+	}
+	return a_length + b_length;
+}
+
+size_t
+arbint_sqr_size(arbint a)
+{
+	return arbint_mul_size(a, a);
+}
+
+arbint
+arbint_sqr(arbint a)
+{
+	arbint result = arbint_new_empty();
+	arbint_sqr_into(result, a);
+	return result;
+}
+
+void
+arbint_sqr_into(arbint result, arbint a)
+{
+	// Square an arbint, which is cheaper than arbint_mul_arbint_into(result, a, a)
+
+	if (arbint_is_zero(a))
+	{
+		set_result_zero(result);
+		return;
+	}
+
+	size_t a_length = arbint_highest_digit(a) + 1;
+	size_t length   = 2 * a_length;
+	limb_t* product = product_buffer(result, a, a, length);
+
+	limbs_sqr(product, a->value, a_length);
+
+	store_product(result, product, length, POSITIVE);
+}
+
+static void
+addmul_1_with_sign(arbint a, const limb_t* bp, size_t bn, limb_t c, sign term_sign)
+{
+	// a += {bp, bn} * c, with the sign of the product given separately so that
+	// subtraction can be done by flipping it. Requires bn >= 1 and c != 0.
+	limb_t* copy = NULL;
+	if (bp == a->value)
+	{
+		// The limb functions can't write to their own operands
+		copy = arbint_allocate(bn * sizeof(limb_t));
+		if (copy == NULL)
+		{
+			fprintf(stderr, "arbint_addmul: malloc failed\n");
+			exit(ENOMEM);
+		}
+		memcpy(copy, bp, bn * sizeof(limb_t));
+		bp = copy;
+	}
+	if (arbint_is_zero(a))
+	{
+		a->sign = term_sign;
+	}
+
+	// The digits of a above its value are 0 up to the length of the product
+	size_t an = a->length;
+	size_t n  = an > bn ? an : bn;
+	if (an < n)
+	{
+		arbint_reserve(a, n);
+		memset(a->value + an, 0, (n - an) * sizeof(limb_t));
+	}
+	a->length  = n;
+	limb_t* ap = a->value;
+
+	limb_t top;
+	if (a->sign == term_sign)
+	{
+		// The carry only goes as far up as it has to
+		top = limbs_addmul_1(ap, bp, bn, c);
+		top = limbs_add_1(ap + bn, ap + bn, n - bn, top);
+	}
+	else
+	{
+		// {ap, n} = |a| - |b| * c + borrow * B^n. If something was borrowed,
+		// the product is larger, and the result is borrow * B^n - {ap, n}
+		// with the sign of the product.
+		limb_t borrow = limbs_submul_1(ap, bp, bn, c);
+		borrow        = limbs_sub_1(ap + bn, ap + bn, n - bn, borrow);
+		top           = 0;
+		if (borrow)
+		{
+			limbs_com(ap, ap, n);
+			top     = borrow - 1 + limbs_add_1(ap, ap, n, 1);
+			a->sign = term_sign;
+		}
+	}
+
+	if (top)
+	{
+		arbint_reserve(a, n + 1);
+		a->value[n] = top;
+		n++;
+	}
+	arbint_normalize(a, n);
+	arbint_deallocate(copy, bn * sizeof(limb_t));
+}
+
+static void
+addmul_with_sign(arbint a, arbint b, arbint c, sign term_sign)
+{
+	// a += b * c with the sign of the product given separately
+	if (arbint_is_zero(b) || arbint_is_zero(c))
+	{
+		return;
+	}
 
-	// - 1 because instead of (return n*x) we do (x += (x*(n-1)))
-	uint64_t multiplier_internal = (uint64_t) multiplier - 1;
+	// A factor of one digit is multiplied and added in one pass over a
+	if (c->length == 1)
+	{
+		addmul_1_with_sign(a, b->value, b->length, c->value[0], term_sign);
+		return;
+	}
+	if (b->length == 1)
+	{
+		addmul_1_with_sign(a, c->value, c->length, b->value[0], term_sign);
+		return;
+	}
 
-	// Compute the result of each digit multiplied by the multiplier and store
-	// it in mul_results
-	uint64_t* mul_results = calloc(to_mul->length, sizeof(uint64_t));
-	for (size_t position = 0; position < to_mul->length; position++)
+	// Otherwise the product is computed on its own, so that it can use the
+	// faster multiplication algorithms, and then added to a in place
+	size_t length   = b->length + c->length;
+	limb_t* product = arbint_allocate(length * sizeof(limb_t));
+	if (product == NULL)
 	{
-		// Multiply using 64-bit ints to keep possible overflow
-		temp_result           = (uint64_t) to_mul->value[position] * multiplier_internal;
-		mul_results[position] = temp_result;
+		fprintf(stderr, "arbint_addmul: malloc failed\n");
+		exit(ENOMEM);
 	}
+	if (b->length >= c->length)
+		limbs_mul(product, b->value, b->length, c->value, c->length);
+	else
+		limbs_mul(product, c->value, c->length, b->value, b->length);
+
+	arbint_struct term = {.value = product, .length = limbs_significant(product, length)};
+	term.sign          = term_sign;
+	arbint_add_inplace(a, &term);
+	arbint_deallocate(product, length * sizeof(limb_t));
+}
 
-	/*
-	At this point we have about the following:
-	(imagine that 4 bits were 32 bits)
+void
+arbint_addmul(arbint a, arbint b, arbint c)
+{
+	addmul_with_sign(a, b, c, b->sign == c->sign ? POSITIVE : NEGATIVE);
+}
 
-	      #3   #2   #1   #0
-	     xxxx xxxx xxxx xxxx // original number
-	               xxxx xxxx // digit #0 * (multiplier - 1) \
-	          xxxx xxxx      // digit #1 * (multiplier - 1) | stored in
-	     xxxx xxxx           // digit #2 * (multiplier - 1) | mul_results
-	xxxx xxxx                // digit #3 * (multiplier - 1) /
+void
+arbint_submul(arbint a, arbint b, arbint c)
+{
+	addmul_with_sign(a, b, c, b->sign == c->sign ? NEGATIVE : POSITIVE);
+}
 
-	Now we need to add all the above rows together. If the most significant
-	digit overflowed, add_to_arbint will reallocate to_mul->value to fit an
-	extra digit.
-	*/
+void
+arbint_addmul_ui(arbint a, arbint b, limb_t c)
+{
+	if (c != 0 && !arbint_is_zero(b))
+	{
+		addmul_1_with_sign(a, b->value, b->length, c, b->sign);
+	}
+}
 
-	size_t max_digits = to_mul->length;
-	for (position = 0; position < max_digits; position++)
+void
+arbint_submul_ui(arbint a, arbint b, limb_t c)
+{
+	sign term_sign = b->sign == POSITIVE ? NEGATIVE : POSITIVE;
+	if (c != 0 && !arbint_is_zero(b))
 	{
-		// Add the lower 32 bits to the value at position
-		add_to_arbint(to_mul, (uint32_t) mul_results[position], position);
+		addmul_1_with_sign(a, b->value, b->length, c, term_sign);
+	}
+}
 
-		// Add the upper 32 bits to the next value
-		mul_results[position] >>= 32;
-		add_to_arbint(to_mul, (uint32_t) mul_results[position], position + 1);
+void
+arbint_divmod(arbint quotient, arbint remainder, arbint a, arbint b)
+{
+	// Truncating division: the quotient is rounded towards zero and the
+	// remainder has the sign of a, so that a = quotient * b + remainder
+	size_t a_length = limbs_significant(a->value, a->length);
+	size_t b_length = limbs_significant(b->value, b->length);
+	check_divisor(b_length == 0, "arbint_divmod");
+
+	sign quotient_sign  = a->sign == b->sign ? POSITIVE : NEGATIVE;
+	sign remainder_sign = a_length ? a->sign : POSITIVE;
+
+	if (a_length < b_length)
+	{
+		// |a| < |b|, so the remainder is a. It's copied before the quotient is
+		// set, which may be a as well.
+		if (remainder != a)
+		{
+			size_t length = a_length ? a_length : 1;
+			limb_t* r     = product_buffer(remainder, a, b, length);
+			r[0]          = 0;
+			memcpy(r, a->value, a_length * sizeof(limb_t));
+			store_product(remainder, r, length, remainder_sign);
+		}
+		set_result_zero(quotient);
+		return;
 	}
 
-	free(mul_results);
+	size_t q_length = a_length - b_length + 1;
+	limb_t* q       = product_buffer(quotient, a, b, q_length);
+	limb_t* r       = product_buffer(remainder, a, b, b_length);
+	limbs_div_qr(q, r, a->value, a_length, b->value, b_length);
+
+	if (limbs_significant(q, q_length) == 0)
+		quotient_sign = POSITIVE;
+	if (limbs_significant(r, b_length) == 0)
+		remainder_sign = POSITIVE;
+	store_product(quotient, q, q_length, quotient_sign);
+	store_product(remainder, r, b_length, remainder_sign);
 }
 
 void
 arbint_free(arbint to_free)
 {
-	free(to_free->value);
-	free(to_free);
+	arbint_free_value(to_free);
+	arbint_deallocate(to_free, sizeof(arbint_struct));
 }
 
 void
 arbint_free_value(arbint to_free)
 {
-	free(to_free->value);
-	to_free->value = NULL;
+	// Values inside the struct aren't allocated on their own
+	if (!arbint_value_is_inline(to_free))
+	{
+		arbint_deallocate(to_free->value, to_free->capacity * sizeof(limb_t));
+	}
+	to_free->value    = NULL;
+	to_free->length   = 0;
+	to_free->capacity = 0;
 }
 
 void
 arbint_reset(arbint to_reset)
 {
-	// Reallocate to 1 digit
-	size_t length  = 1;
-	uint32_t* temp = realloc(to_reset->value, length * sizeof(uint32_t));
-	if (temp == NULL)
-	{
-		fprintf(stderr, "arbint_reset: realloc failed\n");
-		exit(ENOMEM);
-	}
+	// Give up the value and go back to 1 digit inside the struct
+	arbint_free_value(to_reset);
+	arbint_init(to_reset);
+}
 
-	// Set to 0
-	memset((void*) temp, 0, length * sizeof(uint32_t));
-	to_reset->value  = temp;
-	to_reset->length = length;
-	to_reset->sign   = POSITIVE;
+void
+arbint_init(arbint to_init)
+{
+	to_init->value    = to_init->inline_value;
+	to_init->value[0] = 0;
+	to_init->length   = 1;
+	to_init->capacity = ARBINT_INLINE_LIMBS;
+	to_init->sign     = POSITIVE;
 }
 
 arbint
@@ -116,11 +443,25 @@ arbint_new(void)
 arbint
 arbint_new_length(size_t length)
 {
-	arbint new_arbint     = calloc(1, sizeof(arbint_struct));
-	uint32_t* value_array = calloc(length, sizeof(arbint_struct));
-	new_arbint->value     = value_array;
-	new_arbint->length    = length;
-	new_arbint->sign      = POSITIVE;
+	// Short values are stored inside the struct
+	arbint new_arbint = arbint_new_empty();
+	if (new_arbint == NULL)
+	{
+		fprintf(stderr, "arbint_new_length: calloc failed\n");
+		exit(ENOMEM);
+	}
+	arbint_init(new_arbint);
+	if (length > ARBINT_INLINE_LIMBS)
+	{
+		new_arbint->value = arbint_allocate(length * sizeof(limb_t));
+		if (new_arbint->value == NULL)
+		{
+			fprintf(stderr, "arbint_new_length: calloc failed\n");
+			exit(ENOMEM);
+		}
+		new_arbint->value[0] = 0;
+		new_arbint->capacity = length;
+	}
 
 	return new_arbint;
 }
@@ -128,16 +469,20 @@ arbint_new_length(size_t length)
 arbint
 arbint_new_empty()
 {
-	return calloc(1, sizeof(arbint_struct));
+	arbint new_arbint = arbint_allocate(sizeof(arbint_struct));
+	if (new_arbint != NULL)
+	{
+		memset(new_arbint, 0, sizeof(arbint_struct));
+	}
+	return new_arbint;
 }
 
 void
 arbint_set_zero(arbint to_reset)
 {
-	for (size_t i = 0; i < to_reset->length; i++)
-	{
-		to_reset->value[i] = 0;
-	}
+	to_reset->value[0] = 0;
+	to_reset->length   = 1;
+	to_reset->sign     = POSITIVE;
 }
 
 void
@@ -155,62 +500,92 @@ str_to_arbint(char* input_str, arbint to_fill, uint32_t base)
 	}
 	// TODO: Trim whitespace
 
-	arbint_set_zero(to_fill);
-
 	// Get the sign
-	// Now we can be sure that to_fill points to something
+	sign new_sign = POSITIVE;
 	if (input_str[0] == '-')
 	{
-		to_fill->sign = NEGATIVE;
+		new_sign = NEGATIVE;
 		input_str++;
 	}
-	else
+	else if (input_str[0] == '+')
 	{
-		to_fill->sign = POSITIVE;
-		if (input_str[0] == '+')
-			input_str++;
+		input_str++;
 	}
 
-	size_t position = 0;
-
-	// Iterate over the string, starting at the most significant digit. Every
-	// time a digit is read, we multiply the accumulated value in to_fill by
-	// 10 and move to the next digit
-	while (input_str[position])
+	// Skip a 0x or 0b prefix in base 16 or 2, where x and b can't be digits.
+	// A prefix without any digits after it is left as an invalid character.
+	if (input_str[0] == '0' && input_str[1] != '\0' && input_str[2] != '\0')
 	{
-		int digit_val = char_to_digit(input_str[position], base);
-
-		if (digit_val == -1)
+		char prefix = input_str[1];
+		if ((base == 16 && (prefix == 'x' || prefix == 'X'))
+		    || (base == 2 && (prefix == 'b' || prefix == 'B')))
 		{
-			fprintf(stderr, "str_to_arbint: Invalid character '%c' for base %d",
-			        input_str[position], base);
-			exit(EINVAL); // 22 Invalid argument
+			input_str += 2;
 		}
+	}
+
+	// Check all characters before touching to_fill. The conversion doesn't
+	// go through the string from left to right, so it can't stop at the first
+	// invalid character.
+	size_t digit_count = strlen(input_str);
+	size_t valid_count = count_valid_digits(input_str, digit_count, base);
+	if (valid_count < digit_count)
+	{
+		fprintf(stderr, "str_to_arbint: Invalid character '%c' for base %d",
+		        input_str[valid_count], base);
+		exit(EINVAL); // 22 Invalid argument
+	}
+
+	// Convert into the value of to_fill if it has room, otherwise make room
+	// first. Short numbers that don't fit are converted on the stack, so that
+	// to_fill only gets room for the digits they actually have.
+	size_t size = limbs_from_str_size(digit_count, base);
+	limb_t small_buffer[8];
+	limb_t* digits = small_buffer;
+	if (to_fill->value != NULL && to_fill->capacity >= size)
+	{
+		digits = to_fill->value;
+	}
+	else if (size > 8)
+	{
+		arbint_resize(to_fill, size);
+		digits = to_fill->value;
+	}
 
-		// - Add the digit to the arbint
-		// - Multiply the arbint by 10
-		add_to_arbint(to_fill, digit_val, 0);
-		if (input_str[position + 1])
+	size_t length = limbs_from_str(digits, input_str, digit_count, base);
+	if (digits == small_buffer)
+	{
+		if (to_fill->value == NULL || to_fill->capacity < length)
 		{
-			arbint_mul(to_fill, base);
+			arbint_resize(to_fill, length);
 		}
-
-		position++;
+		memcpy(to_fill->value, digits, length * sizeof(limb_t));
 	}
+	to_fill->sign = new_sign;
+	arbint_normalize(to_fill, length);
 }
 
 void
 u64_to_arbint(uint64_t value, arbint to_fill)
 {
-	to_fill->sign = POSITIVE;
-
-	uint32_t lower_value  = (uint32_t)(value & 0xFFFFFFFF);
-	uint32_t higher_value = (uint32_t)(value >> (sizeof(uint32_t) * CHAR_BIT));
+	// The value always fits into the limbs inside the struct. Whatever value
+	// to_fill had before is released.
+	arbint_free_value(to_fill);
+	to_fill->value    = to_fill->inline_value;
+	to_fill->capacity = ARBINT_INLINE_LIMBS;
+	to_fill->sign     = POSITIVE;
+
+#if LIMB_BITS == 64
+	// One limb holds the whole value
+	to_fill->length   = 1;
+	to_fill->value[0] = value;
+#else
+	limb_t lower_value  = (limb_t)(value & 0xFFFFFFFF);
+	limb_t higher_value = (limb_t)(value >> (sizeof(limb_t) * CHAR_BIT));
 
 	// If value uses the upper 32 bits, use two digits
 	if (higher_value)
 	{
-		to_fill->value    = calloc(2, sizeof(uint32_t));
 		to_fill->length   = 2;
 		to_fill->value[0] = lower_value;
 		to_fill->value[1] = higher_value;
@@ -218,109 +593,77 @@ u64_to_arbint(uint64_t value, arbint to_fill)
 	// If it only uses the lower 32 bits, use one digit
 	else
 	{
-		to_fill->value    = calloc(1, sizeof(uint32_t));
 		to_fill->length   = 1;
 		to_fill->value[0] = lower_value;
 	}
+#endif
 }
 
 void
-arbint_to_str(arbint to_convert, char** to_fill /*, uint32_t base*/)
+arbint_to_str(arbint to_convert, char** to_fill, uint32_t base)
 {
-	// TODO Check if 2 <= base <= 36
-	// TODO actually support different bases
-	// TODO actually output a string and not a bc program
+	if (base < 2 || base > 36)
+	{
+		fprintf(stderr, "arbint_to_str: Base must be between 2 and 36\n");
+		exit(EINVAL);
+	}
 
-	// xxxxxxxxx * ((2^32)^y) +
-	size_t str_length = to_convert->length * 27;
+	// The number of digits is known up front, so the string is allocated once
+	// with exactly the size it needs
+	size_t length    = limbs_significant(to_convert->value, to_convert->length);
+	bool is_negative = to_convert->sign == NEGATIVE && length > 0;
+	size_t size      = limbs_to_str_size(to_convert->value, length, base);
 
-	*to_fill = calloc(str_length, sizeof(char));
+	char* result = malloc(size + is_negative + 1);
+	if (result == NULL)
+	{
+		fprintf(stderr, "arbint_to_str: malloc failed\n");
+		exit(ENOMEM);
+	}
 
-	char* str = *to_fill;
-	for (size_t i = 0; i < to_convert->length; i++)
+	char* digits = result;
+	if (is_negative)
 	{
-		str += sprintf(str, "%u * ((2^32)^%lu) %s", to_convert->value[i], i,
-		               i + 1 == to_convert->length ? "" : " + ");
+		*digits++ = '-';
 	}
+	size_t digit_count  = limbs_to_str(digits, to_convert->value, length, base);
+	digits[digit_count] = '\0';
+
+	*to_fill = result;
 }
 
-char
-digit_to_hex(uint32_t digit, size_t position)
+size_t
+arbint_to_hex_size(arbint to_convert)
 {
-	// Return the POSITION'th hex digit of DIGIT represented as a char
-	if (position)
-		digit >>= (position * 4);
-
-	uint8_t digit_value = digit & 0xF;
+	// The hex digits are exact, plus a '-' and the terminating '\0'
+	size_t length    = limbs_significant(to_convert->value, to_convert->length);
+	bool is_negative = to_convert->sign == NEGATIVE && length > 0;
+	return limbs_to_str_size(to_convert->value, length, 16) + is_negative + 1;
+}
 
-	if (digit_value < 10)
-	{
-		return (char) digit_value + '0';
-	}
-	else
+size_t
+arbint_to_hex_into(arbint to_convert, char* buffer)
+{
+	size_t length = limbs_significant(to_convert->value, to_convert->length);
+	char* digits  = buffer;
+	if (to_convert->sign == NEGATIVE && length > 0)
 	{
-		return (char) digit_value - 10 + 'A';
+		*digits++ = '-';
 	}
+	digits += limbs_to_str(digits, to_convert->value, length, 16);
+	*digits = '\0';
+	return (size_t)(digits - buffer);
 }
 
 void
 arbint_to_hex(arbint to_convert, char** to_fill)
 {
-	// 1 char for each hex digit, and one more for '\0'
-	size_t hex_digits_per_u32 = 8;
-	size_t str_length         = hex_digits_per_u32 * to_convert->length + 1;
-	if (to_convert->sign == NEGATIVE)
-	{
-		str_length++;
-	}
-
-	char* result = malloc(str_length * sizeof(char));
-
-	// Iterate backwards over the arbint so we can iterate forwards over
-	// the string, and in order to leave out leading zeroes
-	size_t arbint_pos = to_convert->length * hex_digits_per_u32;
-	size_t str_pos    = 0;
-	bool leading_zero = true;
-	char hex_repr;
-
-	if (to_convert->sign == NEGATIVE)
-	{
-		result[str_pos] = '-';
-		str_pos++;
-	}
-	while (arbint_pos--)
+	char* result = malloc(arbint_to_hex_size(to_convert));
+	if (result == NULL)
 	{
-		// Get the ARBINT_POS'th nibble of to_convert as a hex digit
-		size_t which_digit    = arbint_pos / hex_digits_per_u32;
-		size_t where_in_digit = arbint_pos % hex_digits_per_u32;
-		hex_repr = digit_to_hex(to_convert->value[which_digit], where_in_digit);
-
-		// The first digit which isn't 0 will finish the leading zero section
-		if (hex_repr != '0')
-		{
-			leading_zero = false;
-		}
-
-		// Only if we're past that section we need to put the number in the string
-		if (!leading_zero)
-		{
-			result[str_pos] = hex_repr;
-			str_pos++;
-		}
-	}
-
-	// Append a null delimiter
-	result[str_pos++] = '\0';
-
-	// If there were leading zeroes, reallocate the string so that the
-	// space after the number isn't wasted
-	// TODO determine the amount of leading zeroes at the beginning and already
-	// allocate
-	// no more bytes than necessary
-	if (str_pos < str_length)
-	{
-		result = realloc(result, str_pos + 1);
+		fprintf(stderr, "arbint_to_hex: malloc failed\n");
+		exit(ENOMEM);
 	}
-
+	arbint_to_hex_into(to_convert, result);
 	*to_fill = result;
 }
@@ -0,0 +1,338 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "arbint.h"
+#include "datatypes.h"
+#include "helper-functions.h"
+#include "limbs.h"
+
+#include "bitwise.h"
+
+typedef enum
+{
+	BIT_AND,
+	BIT_OR,
+	BIT_XOR,
+} bit_operation;
+
+static bool
+is_negative(arbint a, size_t length)
+{
+	// The sign of zero doesn't count
+	return a->sign == NEGATIVE && length != 0;
+}
+
+static limb_t*
+reserve(arbint result, size_t length)
+{
+	// Make room for at least `length` limbs in result, keeping its value.
+	// Operands that are the same arbint as result have to be read from
+	// result->value after this, because it may have moved.
+	arbint_reserve(result, length);
+	return result->value;
+}
+
+static void
+finish(arbint result, size_t length, sign result_sign)
+{
+	// The first `length` limbs of result are its value, and the sign is
+	// positive for 0
+	result->sign = result_sign;
+	arbint_normalize(result, length);
+}
+
+void
+arbint_shl(arbint result, arbint a, size_t count)
+{
+	size_t n    = limbs_significant(a->value, a->length);
+	sign a_sign = a->sign;
+	if (n == 0)
+	{
+		reserve(result, 1);
+		finish(result, 0, POSITIVE);
+		return;
+	}
+
+	// Whole limbs are moved, and the rest shifted in the same pass. Both go
+	// from the top down, so the shift can be done in place.
+	size_t limbs      = count / LIMB_BITS;
+	unsigned int bits = count % LIMB_BITS;
+	size_t length     = n + limbs + 1;
+	limb_t* rp        = reserve(result, length);
+	const limb_t* ap  = a->value;
+	if (bits)
+	{
+		rp[n + limbs] = limbs_lshift(rp + limbs, ap, n, bits);
+	}
+	else
+	{
+		memmove(rp + limbs, ap, n * sizeof(limb_t));
+		rp[n + limbs] = 0;
+	}
+	memset(rp, 0, limbs * sizeof(limb_t));
+	finish(result, length, a_sign);
+}
+
+void
+arbint_shr(arbint result, arbint a, size_t count)
+{
+	size_t n          = limbs_significant(a->value, a->length);
+	bool negative     = is_negative(a, n);
+	size_t limbs      = count / LIMB_BITS;
+	unsigned int bits = count % LIMB_BITS;
+	if (limbs >= n)
+	{
+		// Everything is shifted out, which leaves 0 or -1
+		limb_t* rp = reserve(result, 1);
+		rp[0]      = negative;
+		finish(result, 1, NEGATIVE);
+		return;
+	}
+
+	// Rounding down means rounding the magnitude of negative numbers up if
+	// any of the bits that are shifted out are set
+	const limb_t* ap = a->value;
+	bool round_up    = negative && (limbs_significant(ap, limbs) != 0 ||
+	                                (bits && ap[limbs] << (LIMB_BITS - bits) != 0));
+
+	size_t length = n - limbs;
+	limb_t* rp    = reserve(result, length + 1);
+	ap            = a->value;
+	if (bits)
+	{
+		limbs_rshift(rp, ap + limbs, length, bits);
+	}
+	else
+	{
+		memmove(rp, ap + limbs, length * sizeof(limb_t));
+	}
+	rp[length] = round_up ? limbs_add_1(rp, rp, length, 1) : 0;
+	finish(result, length + 1, negative ? NEGATIVE : POSITIVE);
+}
+
+static void
+apply(bit_operation operation, limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	switch (operation)
+	{
+		case BIT_AND:
+			limbs_and_n(rp, ap, bp, n);
+			break;
+		case BIT_OR:
+			limbs_ior_n(rp, ap, bp, n);
+			break;
+		case BIT_XOR:
+			limbs_xor_n(rp, ap, bp, n);
+			break;
+	}
+}
+
+static void
+twos_complement(limb_t* rp, const limb_t* ap, size_t an, size_t n, bool negative)
+{
+	// {rp, n} = a mod B^n for a = +-{ap, an}, with an < n so that the top bit
+	// is the sign bit. For negative numbers that is ~|a| + 1.
+	memcpy(rp, ap, an * sizeof(limb_t));
+	memset(rp + an, 0, (n - an) * sizeof(limb_t));
+	if (negative)
+	{
+		limbs_com(rp, rp, n);
+		limbs_add_1(rp, rp, n, 1);
+	}
+}
+
+static void
+bitwise(bit_operation operation, arbint result, arbint a, arbint b)
+{
+	size_t an       = limbs_significant(a->value, a->length);
+	size_t bn       = limbs_significant(b->value, b->length);
+	bool a_negative = is_negative(a, an);
+	bool b_negative = is_negative(b, bn);
+
+	if (!a_negative && !b_negative)
+	{
+		// Above the shorter number there are only zeros, so & stops there,
+		// and | and ^ copy the rest of the longer one
+		if (an < bn)
+		{
+			arbint swap_arbint = a;
+			size_t swap_length = an;
+			a                  = b;
+			an                 = bn;
+			b                  = swap_arbint;
+			bn                 = swap_length;
+		}
+		size_t length = operation == BIT_AND ? bn : an;
+		limb_t* rp    = reserve(result, length ? length : 1);
+		apply(operation, rp, a->value, b->value, bn);
+		if (operation != BIT_AND)
+		{
+			memmove(rp + bn, a->value + bn, (an - bn) * sizeof(limb_t));
+		}
+		finish(result, length, POSITIVE);
+		return;
+	}
+
+	// Otherwise, both numbers are converted to two's complement with one more
+	// limb than the longer one needs, so that the sign bit of the result is
+	// the top bit
+	size_t n   = (an > bn ? an : bn) + 1;
+	limb_t* tp = arbint_allocate(2 * n * sizeof(limb_t));
+	if (tp == NULL)
+	{
+		fprintf(stderr, "arbint bitwise operation: malloc failed\n");
+		exit(ENOMEM);
+	}
+	twos_complement(tp, a->value, an, n, a_negative);
+	twos_complement(tp + n, b->value, bn, n, b_negative);
+
+	limb_t* rp    = reserve(result, n);
+	apply(operation, rp, tp, tp + n, n);
+	bool negative = rp[n - 1] >> (LIMB_BITS - 1);
+	if (negative)
+	{
+		limbs_com(rp, rp, n);
+		limbs_add_1(rp, rp, n, 1);
+	}
+	arbint_deallocate(tp, 2 * n * sizeof(limb_t));
+	finish(result, n, negative ? NEGATIVE : POSITIVE);
+}
+
+void
+arbint_and(arbint result, arbint a, arbint b)
+{
+	bitwise(BIT_AND, result, a, b);
+}
+
+void
+arbint_or(arbint result, arbint a, arbint b)
+{
+	bitwise(BIT_OR, result, a, b);
+}
+
+void
+arbint_xor(arbint result, arbint a, arbint b)
+{
+	bitwise(BIT_XOR, result, a, b);
+}
+
+void
+arbint_not(arbint result, arbint a)
+{
+	// ~a = -a - 1, so ~a = -(|a| + 1) for a >= 0, and ~a = |a| - 1 for a < 0
+	size_t n      = limbs_significant(a->value, a->length);
+	bool negative = is_negative(a, n);
+	limb_t* rp    = reserve(result, n + 1);
+	if (negative)
+	{
+		limbs_sub_1(rp, a->value, n, 1);
+		finish(result, n, POSITIVE);
+	}
+	else
+	{
+		rp[n] = limbs_add_1(rp, a->value, n, 1);
+		finish(result, n + 1, NEGATIVE);
+	}
+}
+
+bool
+arbint_test_bit(arbint a, size_t index)
+{
+	size_t n           = limbs_significant(a->value, a->length);
+	size_t limb        = index / LIMB_BITS;
+	bool magnitude_bit = limb < n && (a->value[limb] >> (index % LIMB_BITS)) & 1;
+	if (!is_negative(a, n))
+		return magnitude_bit;
+
+	// ~|a| + 1 has zeros below the lowest one bit of |a|, the same one bit,
+	// and the complement of |a| above it
+	size_t lowest = arbint_trailing_zeros(a);
+	if (index <= lowest)
+		return index == lowest;
+	return !magnitude_bit;
+}
+
+static void
+change_magnitude(arbint a, size_t index, bool subtract)
+{
+	// |a| += 2^index or |a| -= 2^index, where the subtraction never borrows
+	size_t n    = limbs_significant(a->value, a->length);
+	size_t limb = index / LIMB_BITS;
+	limb_t bit  = (limb_t) 1 << (index % LIMB_BITS);
+	if (subtract)
+	{
+		limbs_sub_1(a->value + limb, a->value + limb, n - limb, bit);
+		arbint_normalize(a, n);
+		return;
+	}
+
+	// The limbs between the value and the new bit are 0
+	size_t length = n > limb + 1 ? n : limb + 1;
+	limb_t* ap    = reserve(a, length);
+	memset(ap + n, 0, (length - n) * sizeof(limb_t));
+	limb_t carry = limbs_add_1(ap + limb, ap + limb, length - limb, bit);
+	if (carry)
+	{
+		ap         = reserve(a, length + 1);
+		ap[length] = carry;
+		length++;
+	}
+	a->length = length;
+}
+
+void
+arbint_set_bit(arbint a, size_t index)
+{
+	// Setting a bit adds 2^index, which takes it away from the magnitude of
+	// negative numbers
+	if (!arbint_test_bit(a, index))
+	{
+		size_t n = limbs_significant(a->value, a->length);
+		change_magnitude(a, index, is_negative(a, n));
+	}
+}
+
+void
+arbint_clear_bit(arbint a, size_t index)
+{
+	// Clearing a bit subtracts 2^index
+	if (arbint_test_bit(a, index))
+	{
+		size_t n = limbs_significant(a->value, a->length);
+		change_magnitude(a, index, !is_negative(a, n));
+	}
+}
+
+size_t
+arbint_popcount(arbint a)
+{
+	size_t n = limbs_significant(a->value, a->length);
+	if (is_negative(a, n))
+		return SIZE_MAX;
+	return limbs_popcount(a->value, n);
+}
+
+size_t
+arbint_bit_length(arbint a)
+{
+	size_t n = limbs_significant(a->value, a->length);
+	if (n == 0)
+		return 0;
+	return n * LIMB_BITS - limb_leading_zeros(a->value[n - 1]);
+}
+
+size_t
+arbint_trailing_zeros(arbint a)
+{
+	for (size_t i = 0; i < a->length; i++)
+	{
+		if (a->value[i] != 0)
+			return i * LIMB_BITS + limb_trailing_zeros(a->value[i]);
+	}
+	return SIZE_MAX;
+}
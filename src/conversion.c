@@ -0,0 +1,746 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "division.h"
+#include "limbs.h"
+#include "multiplication.h"
+
+#include "conversion.h"
+
+/*
+ * A 'big digit' is a chunk of as many digits as fit into one limb, so a number
+ * with digits_per_limb digits in `base` is a single digit in big_base.
+ */
+typedef struct
+{
+	unsigned int base;
+	size_t digits_per_limb;
+	limb_t big_base;   // base ^ digits_per_limb
+	limb_t base_pow_8; // base ^ 8, for parsing 8 digits at once
+} big_digit_info;
+
+/*
+ * powers[i] is big_base^(2^i), which is 1 followed by `digits` zeroes in base
+ * `base`.
+ */
+typedef struct
+{
+	limb_t* value;
+	size_t length;
+	size_t alloc;
+	size_t digits; // digits_per_limb * 2^i
+} base_power;
+
+/*
+ * Value of each character as a digit plus one, 0 for characters that aren't
+ * digits in any base. With the one subtracted again as an unsigned int,
+ * invalid characters become larger than every base.
+ */
+static const unsigned char digit_values[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,  ['5'] = 6,  ['6'] = 7,
+    ['7'] = 8,  ['8'] = 9,  ['9'] = 10, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14,
+    ['e'] = 15, ['f'] = 16, ['g'] = 17, ['h'] = 18, ['i'] = 19, ['j'] = 20, ['k'] = 21,
+    ['l'] = 22, ['m'] = 23, ['n'] = 24, ['o'] = 25, ['p'] = 26, ['q'] = 27, ['r'] = 28,
+    ['s'] = 29, ['t'] = 30, ['u'] = 31, ['v'] = 32, ['w'] = 33, ['x'] = 34, ['y'] = 35,
+    ['z'] = 36, ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['G'] = 17, ['H'] = 18, ['I'] = 19, ['J'] = 20, ['K'] = 21, ['L'] = 22, ['M'] = 23,
+    ['N'] = 24, ['O'] = 25, ['P'] = 26, ['Q'] = 27, ['R'] = 28, ['S'] = 29, ['T'] = 30,
+    ['U'] = 31, ['V'] = 32, ['W'] = 33, ['X'] = 34, ['Y'] = 35, ['Z'] = 36,
+};
+
+static unsigned int
+digit_value(char c)
+{
+	return (unsigned int) digit_values[(unsigned char) c] - 1;
+}
+
+static const char digit_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/*
+ * log_b(2) * 2^32 for each base b, rounded up, so that a number with `bits`
+ * bits has at most bits * log_2_in_base[b] / 2^32 + 1 digits in base b.
+ */
+static const uint64_t log_2_in_base[37] = {
+    [2] = 4294967297,  [3] = 2709822658,  [4] = 2147483649,  [5] = 1849741733,
+    [6] = 1661520156,  [7] = 1529898220,  [8] = 1431655766,  [9] = 1354911329,
+    [10] = 1292913987, [11] = 1241523976, [12] = 1198050830, [13] = 1160664036,
+    [14] = 1128071164, [15] = 1099331346, [16] = 1073741825, [17] = 1050766078,
+    [18] = 1029986702, [19] = 1011073585, [20] = 993761859,  [21] = 977836273,
+    [22] = 963119892,  [23] = 949465784,  [24] = 936750802,  [25] = 924870867,
+    [26] = 913737343,  [27] = 903274220,  [28] = 893415895,  [29] = 884105414,
+    [30] = 875293063,  [31] = 866935226,  [32] = 858993460,  [33] = 851433730,
+    [34] = 844225783,  [35] = 837342624,  [36] = 830760078,
+};
+
+/*
+ * SWAR ("SIMD within a register"): in bases up to 10, all digits are '0'..'9',
+ * so 8 of them can be checked and converted at once as the bytes of one
+ * uint64_t, without any loop over the characters.
+ */
+
+// The byte x repeated in all 8 bytes of a uint64_t
+#define BYTES(x) (UINT64_C(0x0101010101010101) * (uint8_t)(x))
+
+static uint64_t
+load_8_chars(const char* str)
+{
+	// Load 8 characters with the first one in the lowest byte
+	uint64_t chars;
+	memcpy(&chars, str, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	chars = __builtin_bswap64(chars);
+#endif
+	return chars;
+}
+
+static void
+store_8_chars(char* str, uint64_t chars)
+{
+	// Store 8 characters with the first one from the highest byte
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	chars = __builtin_bswap64(chars);
+#endif
+	memcpy(str, &chars, 8);
+}
+
+static bool
+are_8_digits(uint64_t chars, unsigned int base)
+{
+	// '0'..'9' are 0x30..0x39, the only bytes whose upper nibble is 3 both
+	// before and after adding 6
+	uint64_t high = (chars & BYTES(0xF0)) | (((chars + BYTES(0x06)) & BYTES(0xF0)) >> 4);
+	if (high != BYTES(0x33))
+		return false;
+
+	// Adding 0x80 - base to a digit sets its top bit if it's >= base
+	uint64_t digits = chars - BYTES('0');
+	return ((digits + BYTES(0x80 - base)) & BYTES(0x80)) == 0;
+}
+
+static uint64_t
+parse_8_digits(uint64_t chars, unsigned int base)
+{
+	// Combine neighbouring bytes into 16-bit pairs of digits, then those into
+	// 32-bit groups of four, then into the value of all eight. The first
+	// character is the most significant digit, and it's in the lowest byte.
+	uint64_t base_2 = base * base;
+	uint64_t digits = chars - BYTES('0');
+	digits          = (digits * base + (digits >> 8)) & UINT64_C(0x00FF00FF00FF00FF);
+	digits          = (digits * base_2 + (digits >> 16)) & UINT64_C(0x0000FFFF0000FFFF);
+	digits          = (digits * base_2 * base_2 + (digits >> 32)) & UINT64_C(0xFFFFFFFF);
+	return digits;
+}
+
+static void
+write_8_hex_digits(char* str, uint32_t x)
+{
+	// Spread the 8 nibbles of x over the bytes of a uint64_t, the lowest nibble
+	// in the lowest byte. Nibbles from 10 on get 'A' - 10 added instead of '0',
+	// and adding 6 carries into their upper nibble.
+	uint64_t nibbles = x;
+	nibbles          = (nibbles | (nibbles << 16)) & UINT64_C(0x0000FFFF0000FFFF);
+	nibbles          = (nibbles | (nibbles << 8)) & UINT64_C(0x00FF00FF00FF00FF);
+	nibbles          = (nibbles | (nibbles << 4)) & BYTES(0x0F);
+	uint64_t letters = ((nibbles + BYTES(0x06)) >> 4) & BYTES(0x01);
+	store_8_chars(str, nibbles + BYTES('0') + letters * ('A' - '9' - 1));
+}
+
+static void
+big_digit_init(big_digit_info* info, unsigned int base)
+{
+	limb_t limit          = LIMB_MAX / base;
+	info->base            = base;
+	info->digits_per_limb = 1;
+	info->big_base        = base;
+	info->base_pow_8      = 0;
+	while (info->big_base <= limit)
+	{
+		info->big_base *= base;
+		info->digits_per_limb++;
+		if (info->digits_per_limb == 8)
+			info->base_pow_8 = info->big_base;
+	}
+}
+
+static limb_t*
+alloc_limbs(size_t count)
+{
+	limb_t* limbs = arbint_allocate(count * sizeof(limb_t));
+	if (limbs == NULL)
+	{
+		fprintf(stderr, "conversion: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return limbs;
+}
+
+static void
+free_limbs(limb_t* limbs, size_t count)
+{
+	arbint_deallocate(limbs, count * sizeof(limb_t));
+}
+
+static unsigned int
+bits_per_digit(unsigned int base)
+{
+	// log2(base) if base is a power of two, otherwise 0
+	if (base & (base - 1))
+		return 0;
+	unsigned int bits = 0;
+	while ((1u << bits) < base)
+	{
+		bits++;
+	}
+	return bits;
+}
+
+static size_t
+base_powers_init(base_power* powers, size_t count, const big_digit_info* info)
+{
+	// powers[i] = big_base^(2^i), up to the largest one that is needed to
+	// split `count` digits. Returns the number of powers.
+	size_t levels = 1;
+	while ((info->digits_per_limb << levels) < count)
+	{
+		levels++;
+	}
+
+	powers[0].value    = alloc_limbs(1);
+	powers[0].value[0] = info->big_base;
+	powers[0].length   = 1;
+	powers[0].alloc    = 1;
+	powers[0].digits   = info->digits_per_limb;
+	for (size_t i = 1; i < levels; i++)
+	{
+		const base_power* previous = &powers[i - 1];
+
+		powers[i].value = alloc_limbs(2 * previous->length);
+		limbs_sqr(powers[i].value, previous->value, previous->length);
+		powers[i].length = limbs_significant(powers[i].value, 2 * previous->length);
+		powers[i].alloc  = 2 * previous->length;
+		powers[i].digits = 2 * previous->digits;
+	}
+	return levels;
+}
+
+static void
+base_powers_free(base_power* powers, size_t levels)
+{
+	for (size_t i = 0; i < levels; i++)
+	{
+		free_limbs(powers[i].value, powers[i].alloc);
+	}
+}
+
+static size_t
+from_str_size(size_t count, const big_digit_info* info)
+{
+	// Every started chunk of digits_per_limb digits is less than big_base, so
+	// it adds at most one limb. One more limb for the products in from_str_dc.
+	return count / info->digits_per_limb + 2;
+}
+
+static limb_t
+parse_chunk(const char* str, size_t count, const big_digit_info* info)
+{
+	// The value of `count` digits, which must fit into a limb
+	limb_t chunk = 0;
+	size_t i     = 0;
+	if (info->base <= 10)
+	{
+		for (; i + 8 <= count; i += 8)
+		{
+			uint64_t digits = parse_8_digits(load_8_chars(str + i), info->base);
+			chunk           = chunk * info->base_pow_8 + digits;
+		}
+	}
+	for (; i < count; i++)
+	{
+		chunk = chunk * info->base + digit_value(str[i]);
+	}
+	return chunk;
+}
+
+static size_t
+from_str_basecase(limb_t* rp, const char* str, size_t count, const big_digit_info* info)
+{
+	// The first chunk takes the leftover digits, so that all others are full.
+	// While the result is still 0 (n == 0), multiplying it does nothing and
+	// adding the chunk just returns the chunk as the carry.
+	size_t k            = info->digits_per_limb;
+	size_t chunk_length = count % k ? count % k : k;
+	size_t n            = 0;
+	for (size_t position = 0; position < count; position += chunk_length)
+	{
+		if (position)
+			chunk_length = k;
+		limb_t chunk = parse_chunk(str + position, chunk_length, info);
+
+		// rp = rp * big_base + chunk. The result has at most one more limb, so
+		// the carries of both steps fit into that limb together.
+		limb_t carry = limbs_mul_1(rp, rp, n, info->big_base);
+		carry += limbs_add_1(rp, rp, n, chunk);
+		if (carry)
+			rp[n++] = carry;
+	}
+	return n;
+}
+
+static size_t
+from_str_pow2(limb_t* rp, const char* str, size_t count, unsigned int bits)
+{
+	// In a base 2^bits, every digit is a fixed field of `bits` bits, so the
+	// digits are just packed into the limbs from the least significant end. A
+	// digit that doesn't fit into the current limb is continued in the next.
+	size_t n     = 0;
+	limb_t limb  = 0;
+	size_t shift = 0;
+	for (size_t i = count; i-- > 0;)
+	{
+		limb_t digit = digit_value(str[i]);
+		limb |= digit << shift;
+		shift += bits;
+		if (shift >= LIMB_BITS)
+		{
+			rp[n++] = limb;
+			shift -= LIMB_BITS;
+			limb = shift ? digit >> (bits - shift) : 0;
+		}
+	}
+	if (shift)
+	{
+		rp[n++] = limb;
+	}
+	return limbs_significant(rp, n);
+}
+
+static size_t
+from_str_dc(limb_t* rp, const char* str, size_t count, const base_power* powers,
+            size_t level, const big_digit_info* info)
+{
+	if (count < FROM_STR_DC_THRESHOLD * info->digits_per_limb)
+	{
+		return from_str_basecase(rp, str, count, info);
+	}
+
+	// Split off the largest power of the base that leaves some digits in the
+	// upper part, so the lower part has at least half of the digits
+	while (powers[level].digits >= count)
+	{
+		level--;
+	}
+	const base_power* power = &powers[level];
+	size_t low_count        = power->digits;
+	size_t high_count       = count - low_count;
+
+	size_t high_size = from_str_size(high_count, info);
+	limb_t* high     = alloc_limbs(high_size + from_str_size(low_count, info));
+	limb_t* low      = high + high_size;
+
+	const char* low_str = str + high_count;
+	size_t high_length  = from_str_dc(high, str, high_count, powers, level, info);
+	size_t low_length   = from_str_dc(low, low_str, low_count, powers, level, info);
+
+	// rp = high * base^low_count + low, where low < base^low_count has at most
+	// as many limbs as the power
+	size_t length = 0;
+	if (high_length == 0)
+	{
+		memcpy(rp, low, low_length * sizeof(limb_t));
+		length = low_length;
+	}
+	else
+	{
+		length = high_length + power->length;
+		if (high_length >= power->length)
+			limbs_mul(rp, high, high_length, power->value, power->length);
+		else
+			limbs_mul(rp, power->value, power->length, high, high_length);
+
+		if (low_length)
+			limbs_add(rp, rp, length, low, low_length);
+		length = limbs_significant(rp, length);
+	}
+
+	free_limbs(high, high_size + from_str_size(low_count, info));
+	return length;
+}
+
+size_t
+count_valid_digits(const char* str, size_t count, unsigned int base)
+{
+	size_t i = 0;
+	if (base <= 10)
+	{
+		while (i + 8 <= count && are_8_digits(load_8_chars(str + i), base))
+		{
+			i += 8;
+		}
+	}
+	while (i < count && digit_value(str[i]) < base)
+	{
+		i++;
+	}
+	return i;
+}
+
+size_t
+limbs_from_str_size(size_t count, unsigned int base)
+{
+	unsigned int bits = bits_per_digit(base);
+	if (bits)
+	{
+		return (count * bits + LIMB_BITS - 1) / LIMB_BITS;
+	}
+
+	big_digit_info info;
+	big_digit_init(&info, base);
+	return from_str_size(count, &info);
+}
+
+size_t
+limbs_from_str(limb_t* rp, const char* str, size_t count, unsigned int base)
+{
+	unsigned int bits = bits_per_digit(base);
+	if (bits)
+	{
+		return from_str_pow2(rp, str, count, bits);
+	}
+
+	big_digit_info info;
+	big_digit_init(&info, base);
+
+	if (count < FROM_STR_DC_THRESHOLD * info.digits_per_limb)
+	{
+		return from_str_basecase(rp, str, count, &info);
+	}
+
+	base_power powers[8 * sizeof(size_t)];
+	size_t levels = base_powers_init(powers, count, &info);
+	size_t length = from_str_dc(rp, str, count, powers, levels - 1, &info);
+
+	base_powers_free(powers, levels);
+	return length;
+}
+
+static void
+write_chunk(char* end, size_t count, limb_t chunk, unsigned int base)
+{
+	// Write the lowest `count` digits of chunk to the `count` characters before
+	// end. Division by the constant 10 compiles to a multiplication.
+	if (base == 10)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			*--end = (char) ('0' + chunk % 10);
+			chunk /= 10;
+		}
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		*--end = digit_chars[chunk % base];
+		chunk /= base;
+	}
+}
+
+static void
+to_str_basecase(char* str, size_t width, limb_t* up, size_t n, const big_digit_info* info)
+{
+	// Write {up, n} to str as exactly `width` digits, with leading zeroes.
+	// Every division by big_base splits off the lowest digits_per_limb digits.
+	// Overwrites up.
+	limb_divisor big_base;
+	limbs_divisor_init(&big_base, info->big_base);
+
+	char* end = str + width;
+	while (n > 0)
+	{
+		limb_t chunk = limbs_divrem_1_preinv(up, up, n, &big_base);
+		n            = limbs_significant(up, n);
+
+		size_t left  = (size_t)(end - str);
+		size_t count = info->digits_per_limb < left ? info->digits_per_limb : left;
+		write_chunk(end, count, chunk, info->base);
+		end -= count;
+	}
+	memset(str, '0', (size_t)(end - str));
+}
+
+static void
+to_str_dc(char* str, size_t width, const limb_t* up, size_t n, const base_power* powers,
+          size_t level, const big_digit_info* info)
+{
+	// Write {up, n}, which has no leading zero limbs, to str as exactly
+	// `width` digits, with leading zeroes
+	if (n < TO_STR_DC_THRESHOLD)
+	{
+		limb_t copy[TO_STR_DC_THRESHOLD];
+		memcpy(copy, up, n * sizeof(limb_t));
+		to_str_basecase(str, width, copy, n, info);
+		return;
+	}
+
+	// Split by the largest power with at most half as many limbs, so that the
+	// quotient and the remainder are about equally long. The remainder is less
+	// than the power, so it takes exactly power->digits digits with leading
+	// zeroes, and the quotient takes the rest.
+	while (2 * powers[level].length > n)
+	{
+		level--;
+	}
+	const base_power* power = &powers[level];
+	size_t q_size           = n - power->length + 1;
+	limb_t* q               = alloc_limbs(q_size + power->length);
+	limb_t* r               = q + q_size;
+	limbs_div_qr(q, r, up, n, power->value, power->length);
+
+	size_t low_width = power->digits;
+	size_t q_length  = limbs_significant(q, q_size);
+	size_t r_length  = limbs_significant(r, power->length);
+	to_str_dc(str, width - low_width, q, q_length, powers, level, info);
+	to_str_dc(str + width - low_width, low_width, r, r_length, powers, level, info);
+	free_limbs(q, q_size + power->length);
+}
+
+static void
+to_str_pow2(char* str, size_t width, const limb_t* up, size_t n, unsigned int bits)
+{
+	// Every digit is a field of `bits` bits, which can span two limbs. The
+	// last digit is the least significant one.
+	limb_t mask = ((limb_t) 1 << bits) - 1;
+	for (size_t i = 0; i < width; i++)
+	{
+		size_t position = i * bits;
+		size_t limb     = position / LIMB_BITS;
+		size_t offset   = position % LIMB_BITS;
+
+		limb_t digit = limb < n ? up[limb] >> offset : 0;
+		if (offset + bits > LIMB_BITS && limb + 1 < n)
+		{
+			digit |= up[limb + 1] << (LIMB_BITS - offset);
+		}
+		str[width - 1 - i] = digit_chars[digit & mask];
+	}
+}
+
+static void
+to_str_hex(char* str, size_t width, const limb_t* up, size_t n)
+{
+	// All full limbs 8 digits at a time from the end of the string, the digits
+	// of the top limb one by one
+	size_t per_limb = LIMB_BITS / 4;
+	size_t i        = 0;
+	for (; (i + 1) * per_limb <= width; i++)
+	{
+		char* digits = str + width - (i + 1) * per_limb;
+#if LIMB_BITS == 64
+		write_8_hex_digits(digits, (uint32_t)(up[i] >> 32));
+		write_8_hex_digits(digits + 8, (uint32_t) up[i]);
+#else
+		write_8_hex_digits(digits, up[i]);
+#endif
+	}
+	to_str_pow2(str, width - i * per_limb, up + i, n - i, 4);
+}
+
+static uint64_t
+fixed_point_mul(uint64_t x, uint64_t factor)
+{
+	// x * factor / 2^32 for a 32.32 fixed point factor, without overflowing
+	return (x >> 32) * factor + (((x & 0xFFFFFFFF) * factor) >> 32);
+}
+
+/*
+ * A number m * 2^e with 2^31 <= m < 2^32, to bound a power of the base from
+ * below and above without computing it
+ */
+typedef struct
+{
+	uint64_t mantissa;
+	int64_t exponent;
+} scaled;
+
+static scaled
+scaled_mul(scaled a, scaled b, bool round_up)
+{
+	// a * b rounded down or up to 32 significant bits
+	uint64_t product   = a.mantissa * b.mantissa;
+	unsigned int shift = product >> 63 ? 32 : 31;
+	scaled result      = {product >> shift, a.exponent + b.exponent + shift};
+	if (round_up && (product & (((uint64_t) 1 << shift) - 1)))
+		result.mantissa++;
+	if (result.mantissa >> 32)
+	{
+		result.mantissa >>= 1;
+		result.exponent++;
+	}
+	return result;
+}
+
+static bool
+scaled_less(scaled a, scaled b)
+{
+	if (a.exponent != b.exponent)
+		return a.exponent < b.exponent;
+	return a.mantissa < b.mantissa;
+}
+
+static bool
+at_least_power(const limb_t* up, size_t n, uint64_t bits, unsigned int base,
+               size_t exponent)
+{
+	// Whether {up, n} >= base^exponent, for n >= 2. The power is first bounded
+	// with 32 significant bits, which tells the answer unless the number is
+	// about as close to the power as that. Otherwise the power is computed,
+	// with at most n + 1 limbs. Both are built from the top bit of the exponent
+	// down, squaring for every bit and multiplying by the base for the ones
+	// that are set.
+	unsigned int log = 0;
+	while (base >> (log + 1))
+	{
+		log++;
+	}
+	scaled scaled_base = {(uint64_t) base << (31 - log), (int64_t) log - 31};
+	scaled low         = {(uint64_t) 1 << 31, -31};
+	scaled high        = low;
+	size_t top_bit     = 8 * sizeof(size_t);
+	while (top_bit > 0 && !(exponent >> (top_bit - 1)))
+	{
+		top_bit--;
+	}
+	for (size_t bit = top_bit; bit-- > 0;)
+	{
+		low  = scaled_mul(low, low, false);
+		high = scaled_mul(high, high, true);
+		if (exponent >> bit & 1)
+		{
+			low  = scaled_mul(low, scaled_base, false);
+			high = scaled_mul(high, scaled_base, true);
+		}
+	}
+
+	// The top 32 bits of the number, which starts at bit `bits - 1`
+	size_t shift = (size_t) bits - 32;
+	size_t limb  = shift / LIMB_BITS;
+	size_t rest  = shift % LIMB_BITS;
+	uint64_t top = (uint64_t)(up[limb] >> rest);
+	if (rest > 0 && limb + 1 < n)
+		top |= (uint64_t) up[limb + 1] << (LIMB_BITS - rest);
+	scaled number_low  = {top & 0xFFFFFFFF, (int64_t) shift};
+	scaled number_high = {number_low.mantissa + 1, (int64_t) shift};
+	if (number_high.mantissa >> 32)
+	{
+		number_high.mantissa >>= 1;
+		number_high.exponent++;
+	}
+	if (!scaled_less(number_low, high))
+		return true;
+	if (!scaled_less(low, number_high))
+		return false;
+
+	limb_t* power  = alloc_limbs(2 * (n + 2));
+	limb_t* square = power + n + 2;
+	size_t length  = 1;
+	power[0]       = 1;
+	for (size_t bit = top_bit; bit-- > 0;)
+	{
+		limbs_sqr(square, power, length);
+		length = limbs_significant(square, 2 * length);
+		memcpy(power, square, length * sizeof(limb_t));
+		if (exponent >> bit & 1)
+		{
+			limb_t carry = limbs_mul_1(power, power, length, base);
+			if (carry)
+				power[length++] = carry;
+		}
+	}
+
+	bool result = length < n || (length == n && limbs_cmp(up, power, n) >= 0);
+	free_limbs(power, 2 * (n + 2));
+	return result;
+}
+
+size_t
+limbs_to_str_size(const limb_t* up, size_t n, unsigned int base)
+{
+	n = limbs_significant(up, n);
+	if (n == 0)
+	{
+		return 1;
+	}
+	uint64_t bits = (uint64_t) n * LIMB_BITS - limb_leading_zeros(up[n - 1]);
+
+	unsigned int bits_per = bits_per_digit(base);
+	if (bits_per)
+	{
+		return (size_t)((bits + bits_per - 1) / bits_per);
+	}
+
+	// 2^(bits - 1) <= {up, n} < 2^bits, so the number of digits is between
+	// (bits - 1) * log_b(2) + 1 and bits * log_b(2) + 1. log_b(2) is
+	// irrational, so the table entry minus one is it rounded down. If the
+	// bounds differ, the number is compared with the powers of the base in
+	// between.
+	uint64_t factor = log_2_in_base[base];
+	size_t high     = (size_t) fixed_point_mul(bits, factor) + 1;
+	size_t digits   = (size_t) fixed_point_mul(bits - 1, factor - 1) + 1;
+	if (n == 1 && digits < high)
+	{
+		// A single limb is compared with the power directly
+		dlimb_t power = 1;
+		for (size_t i = 0; i < digits; i++)
+		{
+			power *= base;
+		}
+		for (; digits < high && up[0] >= power; digits++)
+		{
+			power *= base;
+		}
+		return digits;
+	}
+	while (digits < high && at_least_power(up, n, bits, base, digits))
+	{
+		digits++;
+	}
+	return digits;
+}
+
+size_t
+limbs_to_str(char* str, const limb_t* up, size_t n, unsigned int base)
+{
+	n            = limbs_significant(up, n);
+	size_t width = limbs_to_str_size(up, n, base);
+
+	// The size is exact, so the top digit isn't 0 and no leading zeroes are
+	// written
+	unsigned int bits = bits_per_digit(base);
+	if (bits)
+	{
+		if (base == 16)
+			to_str_hex(str, width, up, n);
+		else
+			to_str_pow2(str, width, up, n, bits);
+		return width;
+	}
+
+	big_digit_info info;
+	big_digit_init(&info, base);
+	if (n < TO_STR_DC_THRESHOLD)
+	{
+		to_str_dc(str, width, up, n, NULL, 0, &info);
+	}
+	else
+	{
+		base_power powers[8 * sizeof(size_t)];
+		size_t levels = base_powers_init(powers, width, &info);
+		to_str_dc(str, width, up, n, powers, levels - 1, &info);
+		base_powers_free(powers, levels);
+	}
+	return width;
+}
@@ -0,0 +1,391 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "limbs.h"
+#include "multiplication.h"
+
+#include "division.h"
+
+static limb_t
+div_2by1(limb_t* remainder, limb_t u1, limb_t u0, limb_t d, limb_t inverse)
+{
+	// (u1 * 2^LIMB_BITS + u0) / d, for a normalized d and u1 < d. The product
+	// with the inverse gives a quotient candidate that is at most one too
+	// small or too large, which the remainder tells apart.
+	dlimb_t q = (dlimb_t) inverse * u1 + (((dlimb_t) u1 << LIMB_BITS) | u0);
+	limb_t q1 = (limb_t)(q >> LIMB_BITS) + 1;
+	limb_t q0 = (limb_t) q;
+	limb_t r  = u0 - q1 * d;
+	if (r > q0)
+	{
+		q1--;
+		r += d;
+	}
+	if (r >= d)
+	{
+		q1++;
+		r -= d;
+	}
+	*remainder = r;
+	return q1;
+}
+
+static limb_t*
+alloc_limbs(size_t count)
+{
+	limb_t* limbs = arbint_allocate(count * sizeof(limb_t));
+	if (limbs == NULL)
+	{
+		fprintf(stderr, "limbs_div_qr: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return limbs;
+}
+
+static void
+free_limbs(limb_t* limbs, size_t count)
+{
+	arbint_deallocate(limbs, count * sizeof(limb_t));
+}
+
+limb_t
+limbs_invert_limb(limb_t d)
+{
+	// 2^(2*LIMB_BITS) - 1 - d * 2^LIMB_BITS has ~d as its upper limb
+	dlimb_t numerator = ((dlimb_t) ~d << LIMB_BITS) | LIMB_MAX;
+	return (limb_t)(numerator / d);
+}
+
+static limb_t
+mod_2(limb_t high, limb_t low, const limb_divisor* divisor)
+{
+	// (high * 2^LIMB_BITS + low) mod divisor, for any high. The shifted number
+	// has a third limb with the bits shifted out of high, which is less than
+	// the normalized divisor.
+	unsigned int shift = divisor->shift;
+	limb_t d           = divisor->normalized;
+	limb_t r           = 0;
+	if (shift)
+	{
+		r    = high >> (LIMB_BITS - shift);
+		high = (high << shift) | (low >> (LIMB_BITS - shift));
+		low <<= shift;
+	}
+	div_2by1(&r, r, high, d, divisor->inverse);
+	div_2by1(&r, r, low, d, divisor->inverse);
+	return r >> shift;
+}
+
+void
+limbs_divisor_init(limb_divisor* divisor, limb_t d)
+{
+	divisor->divisor    = d;
+	divisor->shift      = limb_leading_zeros(d);
+	divisor->normalized = d << divisor->shift;
+	divisor->inverse    = limbs_invert_limb(divisor->normalized);
+
+	// B^(k+1) mod d = (B^k mod d) * B mod d
+	if (d < MOD_1_FOLD_LIMIT)
+	{
+		limb_t power = 1;
+		for (size_t k = 0; k < 5; k++)
+		{
+			power              = mod_2(power, 0, divisor);
+			divisor->powers[k] = power;
+		}
+	}
+}
+
+limb_t
+limbs_divrem_1(limb_t* qp, const limb_t* up, size_t n, limb_t d)
+{
+	limb_divisor divisor;
+	limbs_divisor_init(&divisor, d);
+	return limbs_divrem_1_preinv(qp, up, n, &divisor);
+}
+
+static limb_t
+divrem_1(limb_t* qp, const limb_t* up, size_t n, const limb_divisor* divisor)
+{
+	// Divide u * 2^shift by d * 2^shift, which has the same quotient. The
+	// shifted limbs of u are put together on the fly, from the top down. The
+	// quotient limbs are only stored if qp isn't NULL.
+	unsigned int shift = divisor->shift;
+	limb_t d           = divisor->normalized;
+	limb_t inverse     = divisor->inverse;
+	unsigned int back  = LIMB_BITS - shift;
+
+	limb_t r = shift ? up[n - 1] >> back : 0;
+	for (size_t i = n; i-- > 0;)
+	{
+		limb_t u0 = up[i] << shift;
+		if (shift && i > 0)
+			u0 |= up[i - 1] >> back;
+		limb_t q = div_2by1(&r, r, u0, d, inverse);
+		if (qp)
+			qp[i] = q;
+	}
+	return r >> shift;
+}
+
+limb_t
+limbs_divrem_1_preinv(limb_t* qp, const limb_t* up, size_t n, const limb_divisor* divisor)
+{
+	return divrem_1(qp, up, n, divisor);
+}
+
+limb_t
+limbs_mod_1(const limb_t* up, size_t n, limb_t d)
+{
+	limb_divisor divisor;
+	limbs_divisor_init(&divisor, d);
+	return limbs_mod_1_preinv(up, n, &divisor);
+}
+
+limb_t
+limbs_mod_1_preinv(const limb_t* up, size_t n, const limb_divisor* divisor)
+{
+	if (n == 0)
+	{
+		return 0;
+	}
+
+	if (divisor->divisor >= MOD_1_FOLD_LIMIT)
+	{
+		// One division per limb, each of which waits for the last remainder
+		return divrem_1(NULL, up, n, divisor);
+	}
+
+	// The residue r1 * B + r0 is congruent to the limbs that were folded in so
+	// far. Folding in four more multiplies it by B^4 and adds them, which only
+	// needs the powers of B mod d.
+	const limb_t* powers = divisor->powers;
+	size_t i             = n - 1;
+	limb_t r1            = 0;
+	limb_t r0            = up[i];
+	if (i > 0)
+	{
+		r1 = r0;
+		r0 = up[--i];
+	}
+	for (; i >= 4; i -= 4)
+	{
+		dlimb_t sum = (dlimb_t) r0 * powers[3] + (dlimb_t) r1 * powers[4];
+		sum += (dlimb_t) up[i - 1] * powers[2] + (dlimb_t) up[i - 2] * powers[1];
+		sum += (dlimb_t) up[i - 3] * powers[0] + up[i - 4];
+		r1 = (limb_t)(sum >> LIMB_BITS);
+		r0 = (limb_t) sum;
+	}
+	for (; i > 0; i--)
+	{
+		dlimb_t sum = (dlimb_t) r0 * powers[0] + (dlimb_t) r1 * powers[1] + up[i - 1];
+		r1          = (limb_t)(sum >> LIMB_BITS);
+		r0          = (limb_t) sum;
+	}
+	return mod_2(r1, r0, divisor);
+}
+
+static void
+div_basecase(limb_t* qp, limb_t* up, size_t un, const limb_t* dp, size_t dn)
+{
+	// Knuth's Algorithm D for a normalized divisor {dp, dn}, dn >= 2, and
+	// {up, un} with up[un - 1] < dp[dn - 1]. Each step estimates one quotient
+	// limb from the top limbs, which is at most one too large after checking
+	// it against the second divisor limb, and subtracts that multiple of d
+	// from the top of u. The remainder is left in the lower dn limbs of u.
+	limb_t d1      = dp[dn - 1];
+	limb_t d0      = dp[dn - 2];
+	limb_t inverse = limbs_invert_limb(d1);
+
+	for (size_t j = un - dn; j-- > 0;)
+	{
+		limb_t* u = up + j;
+		limb_t u2 = u[dn];
+		limb_t u1 = u[dn - 1];
+		limb_t u0 = u[dn - 2];
+
+		// q_hat = (u2 * 2^LIMB_BITS + u1) / d1 with remainder r_hat, where
+		// u2 <= d1. If r_hat overflows, q_hat * d0 can't be too large anymore.
+		limb_t q_hat;
+		limb_t r_hat;
+		bool overflow;
+		if (u2 == d1)
+		{
+			q_hat    = LIMB_MAX;
+			r_hat    = u1 + d1;
+			overflow = r_hat < d1;
+		}
+		else
+		{
+			q_hat    = div_2by1(&r_hat, u2, u1, d1, inverse);
+			overflow = false;
+		}
+		while (!overflow && (dlimb_t) q_hat * d0 > (((dlimb_t) r_hat << LIMB_BITS) | u0))
+		{
+			q_hat--;
+			r_hat += d1;
+			overflow = r_hat < d1;
+		}
+
+		// If q_hat was still one too large, u went negative, so d is added back
+		limb_t borrow = limbs_submul_1(u, dp, dn, q_hat);
+		limb_t top    = u[dn];
+		u[dn]         = top - borrow;
+		if (top < borrow)
+		{
+			q_hat--;
+			u[dn] += limbs_add_n(u, u, dp, dn);
+		}
+		qp[j] = q_hat;
+	}
+}
+
+static limb_t
+div_basecase_qh(limb_t* qp, limb_t* np, size_t nn, const limb_t* dp, size_t dn)
+{
+	// div_basecase for any {np, nn}. If the top dn limbs of n aren't less than
+	// d, the quotient has a high limb, which is 1 and returned.
+	limb_t qh = limbs_cmp(np + nn - dn, dp, dn) >= 0;
+	if (qh)
+	{
+		limbs_sub_n(np + nn - dn, np + nn - dn, dp, dn);
+	}
+	div_basecase(qp, np, nn, dp, dn);
+	return qh;
+}
+
+static limb_t
+div_dc_n(limb_t* qp, limb_t* np, const limb_t* dp, size_t n, limb_t* scratch)
+{
+	/*
+	 * Burnikel-Ziegler: divide {np, 2n} by the normalized {dp, n}. Writes n
+	 * quotient limbs to qp, returns the high quotient limb like
+	 * div_basecase_qh and leaves the remainder in {np, n}. scratch needs n
+	 * limbs.
+	 *
+	 * The upper half of the quotient is the quotient of the top limbs of n
+	 * divided by the upper half of d, which is computed recursively. That
+	 * can only be too large, which shows after subtracting the upper half of
+	 * the quotient times the lower half of d. Then the same for the lower
+	 * half. The multiplications take the time, so dividing costs a small
+	 * multiple of multiplying.
+	 */
+	if (n < DIV_DC_THRESHOLD)
+	{
+		return div_basecase_qh(qp, np, 2 * n, dp, n);
+	}
+
+	size_t low  = n / 2;
+	size_t high = n - low;
+
+	limb_t qh = div_dc_n(qp + low, np + 2 * low, dp + low, high, scratch);
+	limbs_mul(scratch, qp + low, high, dp, low);
+	limb_t borrow = limbs_sub_n(np + low, np + low, scratch, n);
+	if (qh)
+	{
+		borrow += limbs_sub_n(np + n, np + n, dp, low);
+	}
+	while (borrow)
+	{
+		qh -= limbs_sub_1(qp + low, qp + low, high, 1);
+		borrow -= limbs_add_n(np + low, np + low, dp, n);
+	}
+
+	limb_t ql = div_dc_n(qp, np + high, dp + high, low, scratch);
+	limbs_mul(scratch, dp, high, qp, low);
+	borrow = limbs_sub_n(np, np, scratch, n);
+	if (ql)
+	{
+		borrow += limbs_sub_n(np + low, np + low, dp, high);
+	}
+	while (borrow)
+	{
+		limbs_sub_1(qp, qp, low, 1);
+		borrow -= limbs_add_n(np, np, dp, n);
+	}
+	return qh;
+}
+
+static void
+div_dc(limb_t* qp, limb_t* np, size_t nn, const limb_t* dp, size_t dn, limb_t* scratch)
+{
+	// Divide {np, nn} by the normalized {dp, dn}, where the top dn limbs of n
+	// are less than d, in blocks of dn quotient limbs from the top down.
+	// scratch needs dn limbs.
+	size_t qn = nn - dn;
+	while (qn >= dn)
+	{
+		qn -= dn;
+		div_dc_n(qp + qn, np + qn, dp, dn, scratch);
+	}
+	if (qn < DIV_DC_THRESHOLD)
+	{
+		div_basecase(qp, np, dn + qn, dp, dn);
+		return;
+	}
+
+	// The last qn < dn quotient limbs are estimated from the top limbs of
+	// {np, dn + qn} and the top qn limbs of d, and then corrected like in
+	// div_dc_n with the lower dn - qn limbs of d
+	size_t rest = dn - qn;
+	limb_t qh   = div_dc_n(qp, np + rest, dp + rest, qn, scratch);
+
+	if (qn >= rest)
+		limbs_mul(scratch, qp, qn, dp, rest);
+	else
+		limbs_mul(scratch, dp, rest, qp, qn);
+	limb_t borrow = limbs_sub_n(np, np, scratch, dn);
+	if (qh)
+	{
+		borrow += limbs_sub_n(np + qn, np + qn, dp, rest);
+	}
+	while (borrow)
+	{
+		qh -= limbs_sub_1(qp, qp, qn, 1);
+		borrow -= limbs_add_n(np, np, dp, dn);
+	}
+}
+
+void
+limbs_div_qr(limb_t* qp, limb_t* rp, const limb_t* np, size_t nn, const limb_t* dp,
+             size_t dn)
+{
+	if (dn == 1)
+	{
+		rp[0] = limbs_divrem_1(qp, np, nn, dp[0]);
+		return;
+	}
+
+	// Normalize both operands by the same shift, which doesn't change the
+	// quotient. n gets one more limb so that its top limb is below d's.
+	unsigned int shift = limb_leading_zeros(dp[dn - 1]);
+	limb_t* un         = alloc_limbs(nn + 1 + 2 * dn);
+	limb_t* vn         = un + nn + 1;
+	limb_t* scratch    = vn + dn;
+	if (shift)
+	{
+		limbs_lshift(vn, dp, dn, shift);
+		un[nn] = limbs_lshift(un, np, nn, shift);
+	}
+	else
+	{
+		memcpy(vn, dp, dn * sizeof(limb_t));
+		memcpy(un, np, nn * sizeof(limb_t));
+		un[nn] = 0;
+	}
+
+	if (dn < DIV_DC_THRESHOLD || nn + 1 - dn < DIV_DC_THRESHOLD)
+		div_basecase(qp, un, nn + 1, vn, dn);
+	else
+		div_dc(qp, un, nn + 1, vn, dn, scratch);
+
+	if (shift)
+		limbs_rshift(rp, un, dn, shift);
+	else
+		memcpy(rp, un, dn * sizeof(limb_t));
+	free_limbs(un, nn + 1 + 2 * dn);
+}
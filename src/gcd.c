@@ -0,0 +1,842 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "arbint.h"
+#include "datatypes.h"
+#include "division.h"
+#include "helper-functions.h"
+#include "limbs.h"
+#include "multiplication.h"
+
+#include "gcd.h"
+
+/*
+ * All algorithms here reduce a pair of numbers (a, b) with a matrix
+ * M = (m00 m01; m10 m11) of nonnegative entries and determinant 1, with
+ * (a; b) = M (a'; b'), so that
+ *
+ *   a' = m11 a - m01 b
+ *   b' = m00 b - m10 a
+ *
+ * M is a product of the steps of the Euclidean algorithm, (1 q; 0 1) for
+ * a -= q b and (1 0; q 1) for b -= q a, so gcd(a', b') = gcd(a, b).
+ *
+ * Such a matrix can be computed from the top parts of a and b alone. If it
+ * leaves the top parts at least 2^k and its entries are less than 2^k, then
+ * applying it to the whole numbers leaves them positive as well, because the
+ * low parts change them by less than the entries times the size of the low
+ * parts. So no step ever has to be undone:
+ *
+ *  - Lehmer's algorithm computes a matrix with single-limb entries from the
+ *  top two limbs of a and b (hgcd2), and applies it to the whole numbers,
+ *  which takes them about one limb closer to their gcd.
+ *  - The half-gcd algorithm computes a matrix that takes n-limb numbers
+ *  down to about n/2 limbs, from the matrices of the top halves of the
+ *  numbers (Moller, "On Schonhage's algorithm and subquadratic integer gcd
+ *  computation", 2008).
+ */
+
+// From HGCD_THRESHOLD limbs on, half-gcds are computed from the half-gcds of
+// the top parts instead of with Lehmer steps, and from GCD_DC_THRESHOLD limbs
+// on, gcds reduce the numbers with half-gcds
+#if LIMB_BITS == 64
+#define HGCD_THRESHOLD 70
+#define GCD_DC_THRESHOLD 250
+#else
+#define HGCD_THRESHOLD 120
+#define GCD_DC_THRESHOLD 400
+#endif
+
+/*
+ * A matrix as above with multi-limb entries. All of them have `length`
+ * limbs, and are zero from there up to `alloc` limbs. `temp` is space for one
+ * more entry.
+ */
+typedef struct
+{
+	limb_t* entry[2][2];
+	limb_t* temp;
+	size_t length;
+	size_t alloc;
+} gcd_matrix;
+
+/*
+ * The cofactors of the extended gcd, with a = u[0] * A and b = -u[1] * A
+ * modulo the second original number B, for the first original number A.
+ * Both are kept as magnitudes, as every step adds a multiple of one to the
+ * other. Like the matrix entries, both have `length` limbs.
+ */
+typedef struct
+{
+	limb_t* u[2];
+	limb_t* temp;
+	size_t length;
+	size_t alloc;
+} gcd_cofactors;
+
+static limb_t*
+alloc_limbs(size_t count)
+{
+	limb_t* limbs = arbint_allocate(count * sizeof(limb_t));
+	if (limbs == NULL)
+	{
+		fprintf(stderr, "arbint_gcd: malloc failed\n");
+		exit(ENOMEM);
+	}
+	memset(limbs, 0, count * sizeof(limb_t));
+	return limbs;
+}
+
+static void
+free_limbs(limb_t* limbs, size_t count)
+{
+	arbint_deallocate(limbs, count * sizeof(limb_t));
+}
+
+static size_t
+max_size(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+static void
+mul_any(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	// {rp, an + bn} = {ap, an} * {bp, bn} for any lengths, including 0
+	if (an == 0 || bn == 0)
+		memset(rp, 0, (an + bn) * sizeof(limb_t));
+	else if (an >= bn)
+		limbs_mul(rp, ap, an, bp, bn);
+	else
+		limbs_mul(rp, bp, bn, ap, an);
+}
+
+static void
+add_product(limb_t* rp, size_t rn, const limb_t* product, size_t pn)
+{
+	// {rp, rn} += {product, pn}, where rp has room for the sum and is zero
+	// above rn
+	pn = limbs_significant(product, pn);
+	if (pn > rn)
+	{
+		limbs_add(rp, product, pn, rp, rn);
+	}
+	else
+	{
+		limb_t carry = limbs_add(rp, rp, rn, product, pn);
+		rp[rn] += carry;
+	}
+}
+
+/*
+ * Matrices
+ */
+
+static void
+matrix_init(gcd_matrix* matrix, size_t alloc)
+{
+	limb_t* limbs          = alloc_limbs(5 * alloc);
+	matrix->entry[0][0]    = limbs;
+	matrix->entry[0][1]    = limbs + alloc;
+	matrix->entry[1][0]    = limbs + 2 * alloc;
+	matrix->entry[1][1]    = limbs + 3 * alloc;
+	matrix->temp           = limbs + 4 * alloc;
+	matrix->entry[0][0][0] = 1;
+	matrix->entry[1][1][0] = 1;
+	matrix->length         = 1;
+	matrix->alloc          = alloc;
+}
+
+static void
+matrix_free(gcd_matrix* matrix)
+{
+	free_limbs(matrix->entry[0][0], 5 * matrix->alloc);
+}
+
+static void
+matrix_normalize(gcd_matrix* matrix, size_t length)
+{
+	size_t max = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		max = max_size(max, limbs_significant(matrix->entry[i / 2][i % 2], length));
+	}
+	matrix->length = max;
+}
+
+static void
+matrix_mul_1(gcd_matrix* matrix, limb_t m[2][2])
+{
+	// matrix = matrix * m for a matrix m of single limbs below 2^(LIMB_BITS - 1),
+	// so that the sum of two products of an entry and a limb never carries
+	size_t n = matrix->length;
+	for (int row = 0; row < 2; row++)
+	{
+		limb_t* r0 = matrix->entry[row][0];
+		limb_t* r1 = matrix->entry[row][1];
+		memcpy(matrix->temp, r0, n * sizeof(limb_t));
+		r0[n] = limbs_mul_1(r0, r0, n, m[0][0]);
+		r0[n] += limbs_addmul_1(r0, r1, n, m[1][0]);
+		r1[n] = limbs_mul_1(r1, r1, n, m[1][1]);
+		r1[n] += limbs_addmul_1(r1, matrix->temp, n, m[0][1]);
+	}
+	matrix_normalize(matrix, n + 1);
+}
+
+static void
+matrix_add_quotient(gcd_matrix* matrix, const limb_t* qp, size_t qn, int reduced)
+{
+	// matrix = matrix * (1 q; 0 1) if a was reduced, matrix * (1 0; q 1) if b
+	// was, which adds q times one column to the other
+	size_t n        = matrix->length;
+	limb_t* product = alloc_limbs(n + qn);
+	int source      = reduced;
+	for (int row = 0; row < 2; row++)
+	{
+		mul_any(product, matrix->entry[row][source], n, qp, qn);
+		add_product(matrix->entry[row][1 - source], n, product, n + qn);
+	}
+	free_limbs(product, n + qn);
+	matrix_normalize(matrix, n + qn + 1 < matrix->alloc ? n + qn + 1 : matrix->alloc);
+}
+
+static void
+matrix_mul(gcd_matrix* matrix, const gcd_matrix* m)
+{
+	// matrix = matrix * m, where the entries of the product fit into matrix
+	size_t n        = matrix->length;
+	size_t mn       = m->length;
+	limb_t* product = alloc_limbs(3 * (n + mn + 1));
+	limb_t* sum[2]  = {product + n + mn + 1, product + 2 * (n + mn + 1)};
+	for (int row = 0; row < 2; row++)
+	{
+		for (int column = 0; column < 2; column++)
+		{
+			mul_any(sum[column], matrix->entry[row][0], n, m->entry[0][column], mn);
+			mul_any(product, matrix->entry[row][1], n, m->entry[1][column], mn);
+			sum[column][n + mn] = limbs_add_n(sum[column], sum[column], product, n + mn);
+		}
+		for (int column = 0; column < 2; column++)
+		{
+			size_t length = limbs_significant(sum[column], n + mn + 1);
+			memcpy(matrix->entry[row][column], sum[column], length * sizeof(limb_t));
+			memset(matrix->entry[row][column] + length, 0,
+			       (matrix->alloc - length) * sizeof(limb_t));
+		}
+	}
+	free_limbs(product, 3 * (n + mn + 1));
+	matrix_normalize(matrix, matrix->alloc);
+}
+
+/*
+ * Cofactors
+ */
+
+static void
+cofactors_init(gcd_cofactors* cofactors, size_t alloc)
+{
+	limb_t* limbs      = alloc_limbs(3 * alloc);
+	cofactors->u[0]    = limbs;
+	cofactors->u[1]    = limbs + alloc;
+	cofactors->temp    = limbs + 2 * alloc;
+	cofactors->u[0][0] = 1;
+	cofactors->length  = 1;
+	cofactors->alloc   = alloc;
+}
+
+static void
+cofactors_normalize(gcd_cofactors* cofactors, size_t length)
+{
+	cofactors->length = max_size(limbs_significant(cofactors->u[0], length),
+	                             limbs_significant(cofactors->u[1], length));
+}
+
+static void
+cofactors_mul_1(gcd_cofactors* cofactors, limb_t m[2][2])
+{
+	// (u0; u1) = (m11 u0 + m01 u1; m00 u1 + m10 u0), which follows a and b
+	// through a reduction by m
+	size_t n   = cofactors->length;
+	limb_t* u0 = cofactors->u[0];
+	limb_t* u1 = cofactors->u[1];
+	memcpy(cofactors->temp, u0, n * sizeof(limb_t));
+	u0[n] = limbs_mul_1(u0, u0, n, m[1][1]);
+	u0[n] += limbs_addmul_1(u0, u1, n, m[0][1]);
+	u1[n] = limbs_mul_1(u1, u1, n, m[0][0]);
+	u1[n] += limbs_addmul_1(u1, cofactors->temp, n, m[1][0]);
+	cofactors_normalize(cofactors, n + 1);
+}
+
+static void
+cofactors_mul(gcd_cofactors* cofactors, const gcd_matrix* m)
+{
+	// The same as cofactors_mul_1 for a matrix with multi-limb entries
+	size_t n        = cofactors->length;
+	size_t mn       = m->length;
+	size_t length   = n + mn + 1;
+	limb_t* product = alloc_limbs(3 * length);
+	limb_t* sum[2]  = {product + length, product + 2 * length};
+	for (int i = 0; i < 2; i++)
+	{
+		// u[i] from u[i] with the diagonal entry and u[1 - i] with the other one
+		mul_any(sum[i], cofactors->u[i], n, m->entry[1 - i][1 - i], mn);
+		mul_any(product, cofactors->u[1 - i], n, m->entry[i][1 - i], mn);
+		sum[i][n + mn] = limbs_add_n(sum[i], sum[i], product, n + mn);
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		size_t sum_length = limbs_significant(sum[i], length);
+		memcpy(cofactors->u[i], sum[i], sum_length * sizeof(limb_t));
+		memset(cofactors->u[i] + sum_length, 0,
+		       (cofactors->alloc - sum_length) * sizeof(limb_t));
+	}
+	free_limbs(product, 3 * length);
+	cofactors_normalize(cofactors, cofactors->alloc);
+}
+
+static void
+cofactors_add_quotient(gcd_cofactors* cofactors, const limb_t* qp, size_t qn, int reduced)
+{
+	// a -= q b means u0 += q u1, b -= q a means u1 += q u0
+	size_t n        = cofactors->length;
+	limb_t* product = alloc_limbs(n + qn);
+	mul_any(product, cofactors->u[1 - reduced], n, qp, qn);
+	add_product(cofactors->u[reduced], n, product, n + qn);
+	free_limbs(product, n + qn);
+	cofactors_normalize(cofactors, max_size(n, n + qn) + 1);
+}
+
+/*
+ * Steps
+ */
+
+static bool
+hgcd2(limb_t ah, limb_t al, limb_t bh, limb_t bl, limb_t m[2][2])
+{
+	// Reduce the two-limb numbers a and b like the Euclidean algorithm, but
+	// stop before either of them gets below 2^(LIMB_BITS + 1), and collect the
+	// steps in m. The entries of m then stay below 2^(LIMB_BITS - 1), so that m
+	// can be applied to any numbers that a and b are the top limbs of.
+	// Returns false if no step is possible.
+	dlimb_t a           = ((dlimb_t) ah << LIMB_BITS) | al;
+	dlimb_t b           = ((dlimb_t) bh << LIMB_BITS) | bl;
+	const dlimb_t limit = (dlimb_t) 2 << LIMB_BITS;
+	m[0][0]             = 1;
+	m[0][1]             = 0;
+	m[1][0]             = 0;
+	m[1][1]             = 1;
+	if (a < limit || b < limit)
+		return false;
+
+	bool progress = false;
+	for (;;)
+	{
+		// Reduce the larger number x by q times the smaller one y, where q is
+		// the quotient x / y, or one less if the remainder would be too small
+		bool a_larger = a > b;
+		dlimb_t* x    = a_larger ? &a : &b;
+		dlimb_t y     = a_larger ? b : a;
+		if (*x - y < limit)
+			break;
+
+		// Quotients of 1 are the most common by far, and need no division
+		*x -= y;
+		dlimb_t q = 1;
+		bool last = false;
+		if (*x >= y)
+		{
+			q += *x / y;
+			*x %= y;
+			if (*x < limit)
+			{
+				q--;
+				*x += y;
+				last = true;
+			}
+		}
+
+		if (a_larger)
+		{
+			m[0][1] += (limb_t) q * m[0][0];
+			m[1][1] += (limb_t) q * m[1][0];
+		}
+		else
+		{
+			m[0][0] += (limb_t) q * m[0][1];
+			m[1][0] += (limb_t) q * m[1][1];
+		}
+		progress = true;
+		if (last)
+			break;
+	}
+	return progress;
+}
+
+static void
+top_limbs(limb_t* high, limb_t* low, const limb_t* xp, size_t n, unsigned int shift)
+{
+	// The two limbs of {xp, n} that start `shift` bits below its top limb
+	limb_t x2 = xp[n - 1];
+	limb_t x1 = n >= 2 ? xp[n - 2] : 0;
+	limb_t x0 = n >= 3 ? xp[n - 3] : 0;
+	if (shift == 0)
+	{
+		*high = x2;
+		*low  = x1;
+		return;
+	}
+	*high = (x2 << shift) | (x1 >> (LIMB_BITS - shift));
+	*low  = (x1 << shift) | (x0 >> (LIMB_BITS - shift));
+}
+
+static size_t
+apply_1(limb_t m[2][2], limb_t* ap, limb_t* bp, size_t n, limb_t* scratch)
+{
+	// Reduce {ap, n} and {bp, n} by m, returns their new size. The products
+	// are larger than n limbs, but their differences aren't.
+	memcpy(scratch, ap, n * sizeof(limb_t));
+	limbs_mul_1(ap, ap, n, m[1][1]);
+	limbs_submul_1(ap, bp, n, m[0][1]);
+	limbs_mul_1(bp, bp, n, m[0][0]);
+	limbs_submul_1(bp, scratch, n, m[1][0]);
+	return max_size(limbs_significant(ap, n), limbs_significant(bp, n));
+}
+
+static size_t
+subdiv_step(limb_t* ap, limb_t* bp, size_t n, size_t s, limb_t* qp, size_t* qn,
+            int* reduced, limb_t* scratch)
+{
+	// One step of the Euclidean algorithm, which reduces the larger number x
+	// modulo the smaller one y, while keeping both of them at least B^s.
+	// For s = 0, they may get down to 0 instead.
+	//  - Returns the new size, or 0 if no step is possible, which for s = 0
+	//  means that one number is 0 or both are equal
+	//  - Writes the quotient to {qp, *qn} and sets *reduced to 0 if a was
+	//  reduced and to 1 if b was
+	//  - Needs n limbs of scratch space, and n + 1 for the quotient
+	size_t an = limbs_significant(ap, n);
+	size_t bn = limbs_significant(bp, n);
+	int order = an != bn ? (an > bn ? 1 : -1) : limbs_cmp(ap, bp, an);
+	if (order == 0)
+		return 0;
+
+	*reduced   = order > 0 ? 0 : 1;
+	limb_t* xp = order > 0 ? ap : bp;
+	limb_t* yp = order > 0 ? bp : ap;
+	size_t xn  = order > 0 ? an : bn;
+	size_t yn  = order > 0 ? bn : an;
+	if (yn <= s && (s > 0 || yn == 0))
+		return 0;
+
+	// Subtract y once first, which is the whole step for quotients of 1, and
+	// shows whether there's room for a step at all
+	limbs_sub(xp, xp, xn, yp, yn);
+	size_t rn = limbs_significant(xp, xn);
+	if (s > 0 && rn <= s)
+	{
+		limbs_add(xp, xp, xn, yp, yn);
+		return 0;
+	}
+
+	qp[0] = 1;
+	*qn   = 1;
+	if (rn > yn || (rn == yn && limbs_cmp(xp, yp, yn) >= 0))
+	{
+		limbs_div_qr(qp, scratch, xp, rn, yp, yn);
+		*qn = rn - yn + 1;
+		memcpy(xp, scratch, yn * sizeof(limb_t));
+		memset(xp + yn, 0, (rn - yn) * sizeof(limb_t));
+
+		if (s > 0 && limbs_significant(xp, yn) <= s)
+		{
+			// Take one y less, which leaves the remainder plus y
+			limb_t carry = limbs_add_n(xp, xp, yp, yn);
+			if (carry)
+				xp[yn] = carry;
+		}
+		else
+		{
+			// Count the subtraction from before
+			qp[*qn] = limbs_add_1(qp, qp, *qn, 1);
+			(*qn)++;
+		}
+		*qn = limbs_significant(qp, *qn);
+	}
+	return max_size(limbs_significant(ap, n), limbs_significant(bp, n));
+}
+
+static size_t
+hgcd_step(limb_t* ap, limb_t* bp, size_t n, size_t s, gcd_matrix* matrix,
+          limb_t* scratch)
+{
+	// One Lehmer step, or one step of the Euclidean algorithm if Lehmer's
+	// doesn't work, that keeps both numbers at least B^s. Their top two
+	// limbs are taken from where the larger one starts, unless n = s + 1, where
+	// that could take them below B^s. Returns the new size, or 0.
+	limb_t mask = ap[n - 1] | bp[n - 1];
+	limb_t ah, al, bh, bl;
+	limb_t m[2][2];
+	bool lehmer = n > s + 1 || mask >= 4;
+	if (lehmer)
+	{
+		unsigned int shift = n > s + 1 ? limb_leading_zeros(mask) : 0;
+		top_limbs(&ah, &al, ap, n, shift);
+		top_limbs(&bh, &bl, bp, n, shift);
+		lehmer = hgcd2(ah, al, bh, bl, m);
+	}
+	if (lehmer)
+	{
+		matrix_mul_1(matrix, m);
+		return apply_1(m, ap, bp, n, scratch);
+	}
+
+	limb_t* qp = scratch + n;
+	size_t qn;
+	int reduced;
+	size_t new_size = subdiv_step(ap, bp, n, s, qp, &qn, &reduced, scratch);
+	if (new_size)
+	{
+		matrix_add_quotient(matrix, qp, qn, reduced);
+	}
+	return new_size;
+}
+
+/*
+ * Half-gcd
+ */
+
+static size_t
+hgcd_adjust(const gcd_matrix* matrix, limb_t* ap, limb_t* bp, size_t p, size_t nn)
+{
+	// The top parts {ap + p, nn} and {bp + p, nn} have been reduced by
+	// `matrix`, the low parts {ap, p} and {bp, p} are still the original
+	// ones. Reduce the low parts as well and add them in:
+	//   a' = a'_top B^p + m11 a_low - m01 b_low
+	//   b' = b'_top B^p + m00 b_low - m10 a_low
+	// Returns the new size of the whole numbers, which is at most p + nn + 1.
+	size_t mn       = matrix->length;
+	size_t length   = p + mn;
+	limb_t* product = alloc_limbs(4 * length);
+	mul_any(product, matrix->entry[1][1], mn, ap, p);
+	mul_any(product + length, matrix->entry[0][1], mn, bp, p);
+	mul_any(product + 2 * length, matrix->entry[0][0], mn, bp, p);
+	mul_any(product + 3 * length, matrix->entry[1][0], mn, ap, p);
+
+	size_t n = p + nn;
+	memset(ap, 0, p * sizeof(limb_t));
+	memset(bp, 0, p * sizeof(limb_t));
+	ap[n] = 0;
+	bp[n] = 0;
+	limbs_add(ap, ap, n + 1, product, length);
+	limbs_sub(ap, ap, n + 1, product + length, length);
+	limbs_add(bp, bp, n + 1, product + 2 * length, length);
+	limbs_sub(bp, bp, n + 1, product + 3 * length, length);
+	free_limbs(product, 4 * length);
+	return max_size(limbs_significant(ap, n + 1), limbs_significant(bp, n + 1));
+}
+
+static size_t
+hgcd(limb_t* ap, limb_t* bp, size_t n, gcd_matrix* matrix, limb_t* scratch)
+{
+	// Reduce {ap, n} and {bp, n} until another step would take one of them
+	// below B^s, s = n/2 + 1, and store the reduction in `matrix`, which must
+	// be the identity. Returns the new size, or 0 if no step was possible.
+	//  - ap and bp need room for n + 1 limbs, and the scratch space for 2n + 1
+	//  - Large numbers are first reduced by the half-gcd of their top half,
+	//  which takes n limbs to about 3n/4, and then by the half-gcd of the top
+	//  of what's left, which takes them the rest of the way
+	size_t s     = n / 2 + 1;
+	bool reduced = false;
+	if (n <= s)
+		return 0;
+
+	if (n >= HGCD_THRESHOLD)
+	{
+		size_t p  = n / 2;
+		size_t nn = hgcd(ap + p, bp + p, n - p, matrix, scratch);
+		if (nn)
+		{
+			n       = hgcd_adjust(matrix, ap, bp, p, nn);
+			reduced = true;
+		}
+
+		size_t n2 = 3 * n / 4 + 1;
+		while (n > n2)
+		{
+			nn = hgcd_step(ap, bp, n, s, matrix, scratch);
+			if (!nn)
+				return reduced ? n : 0;
+			n       = nn;
+			reduced = true;
+		}
+
+		if (n > s + 2)
+		{
+			// The top part starts where its own s is just above ours, so
+			// that its reduction keeps the whole numbers at least B^s
+			gcd_matrix top;
+			p = 2 * s - n + 1;
+			matrix_init(&top, (n - p) / 2 + 2);
+			nn = hgcd(ap + p, bp + p, n - p, &top, scratch);
+			if (nn)
+			{
+				n = hgcd_adjust(&top, ap, bp, p, nn);
+				matrix_mul(matrix, &top);
+				reduced = true;
+			}
+			matrix_free(&top);
+		}
+	}
+
+	for (;;)
+	{
+		size_t nn = hgcd_step(ap, bp, n, s, matrix, scratch);
+		if (!nn)
+			return reduced ? n : 0;
+		n       = nn;
+		reduced = true;
+	}
+}
+
+/*
+ * Gcd
+ */
+
+static size_t
+gcd_limbs(limb_t* ap, limb_t* bp, size_t n, gcd_cofactors* cofactors, sign* cofactor_sign)
+{
+	// Computes the gcd of {ap, n} and {bp, n}, which must not be zero, and
+	// leaves it in ap. Returns its size.
+	//  - ap and bp need room for n + 1 limbs, with zero from n on
+	//  - If `cofactors` isn't NULL, it follows the numbers, and u[0] ends up as
+	//  the cofactor of the gcd with the sign in *cofactor_sign
+	size_t scratch_size = 2 * n + 2;
+	limb_t* scratch     = alloc_limbs(scratch_size);
+	limb_t* qp          = scratch + n;
+	size_t qn;
+	int reduced;
+
+	// Half-gcd steps. The top 2/3 of the numbers are reduced to about half
+	// their size, which takes the whole numbers down by about n/3 limbs.
+	bool done = false;
+	while (!done && n >= GCD_DC_THRESHOLD)
+	{
+		size_t p = 2 * n / 3;
+		gcd_matrix matrix;
+		matrix_init(&matrix, (n - p) / 2 + 2);
+		size_t nn = hgcd(ap + p, bp + p, n - p, &matrix, scratch);
+		if (nn)
+		{
+			n = hgcd_adjust(&matrix, ap, bp, p, nn);
+			if (cofactors)
+				cofactors_mul(cofactors, &matrix);
+		}
+		else
+		{
+			nn = subdiv_step(ap, bp, n, 0, qp, &qn, &reduced, scratch);
+			if (nn && cofactors)
+				cofactors_add_quotient(cofactors, qp, qn, reduced);
+			done = nn == 0;
+			n    = nn ? nn : n;
+		}
+		matrix_free(&matrix);
+	}
+
+	// Lehmer steps with the top two limbs
+	while (!done && n >= 2)
+	{
+		limb_t ah, al, bh, bl;
+		limb_t m[2][2];
+		unsigned int shift = limb_leading_zeros(ap[n - 1] | bp[n - 1]);
+		top_limbs(&ah, &al, ap, n, shift);
+		top_limbs(&bh, &bl, bp, n, shift);
+		if (hgcd2(ah, al, bh, bl, m))
+		{
+			n = apply_1(m, ap, bp, n, scratch);
+			if (cofactors)
+				cofactors_mul_1(cofactors, m);
+			continue;
+		}
+
+		size_t nn = subdiv_step(ap, bp, n, 0, qp, &qn, &reduced, scratch);
+		if (nn && cofactors)
+			cofactors_add_quotient(cofactors, qp, qn, reduced);
+		done = nn == 0;
+		n    = nn ? nn : n;
+	}
+
+	// The Euclidean algorithm on single limbs
+	while (!done && ap[0] != 0 && bp[0] != 0)
+	{
+		reduced  = ap[0] > bp[0] ? 0 : 1;
+		limb_t x = reduced ? bp[0] : ap[0];
+		limb_t y = reduced ? ap[0] : bp[0];
+		limb_t q = x / y;
+		if (reduced)
+			bp[0] = x % y;
+		else
+			ap[0] = x % y;
+		if (cofactors)
+			cofactors_add_quotient(cofactors, &q, 1, reduced);
+	}
+	free_limbs(scratch, scratch_size);
+
+	// One number is 0 and the other one the gcd, or both are equal to it
+	size_t an = limbs_significant(ap, n);
+	size_t bn = limbs_significant(bp, n);
+	if (cofactors)
+	{
+		// a has the positive cofactor and b the negative one. If both are the
+		// gcd, take the smaller one.
+		bool take_b = an == 0;
+		if (an != 0 && bn != 0)
+		{
+			limb_t* u0 = cofactors->u[0];
+			limb_t* u1 = cofactors->u[1];
+			take_b     = limbs_cmp(u1, u0, cofactors->length) < 0;
+		}
+		if (take_b)
+		{
+			memcpy(cofactors->u[0], cofactors->u[1], cofactors->length * sizeof(limb_t));
+		}
+		*cofactor_sign = take_b ? NEGATIVE : POSITIVE;
+	}
+	if (an == 0)
+	{
+		memcpy(ap, bp, bn * sizeof(limb_t));
+		return bn;
+	}
+	return an;
+}
+
+static void
+store_limbs(arbint result, const limb_t* up, size_t n, sign result_sign)
+{
+	// Only reallocate result if it has room for fewer than n digits
+	arbint_reserve(result, max_size(n, 1));
+	memcpy(result->value, up, n * sizeof(limb_t));
+	result->sign = result_sign;
+	arbint_normalize(result, n);
+}
+
+static limb_t*
+copy_operands(arbint a, arbint b, size_t n)
+{
+	// |a| and |b| with n + 1 limbs each, one after the other
+	limb_t* ap     = alloc_limbs(2 * (n + 1));
+	size_t a_limbs = limbs_significant(a->value, a->length);
+	size_t b_limbs = limbs_significant(b->value, b->length);
+	memcpy(ap, a->value, a_limbs * sizeof(limb_t));
+	memcpy(ap + n + 1, b->value, b_limbs * sizeof(limb_t));
+	return ap;
+}
+
+void
+arbint_gcd(arbint result, arbint a, arbint b)
+{
+	size_t an = limbs_significant(a->value, a->length);
+	size_t bn = limbs_significant(b->value, b->length);
+	if (an == 0 || bn == 0)
+	{
+		// gcd(a, 0) = |a|
+		arbint other = an == 0 ? b : a;
+		store_limbs(result, other->value, an + bn, POSITIVE);
+		return;
+	}
+
+	size_t n   = max_size(an, bn);
+	limb_t* ap = copy_operands(a, b, n);
+	size_t gn  = gcd_limbs(ap, ap + n + 1, n, NULL, NULL);
+	store_limbs(result, ap, gn, POSITIVE);
+	free_limbs(ap, 2 * (n + 1));
+}
+
+void
+arbint_gcdext(arbint g, arbint s, arbint t, arbint a, arbint b)
+{
+	size_t an     = limbs_significant(a->value, a->length);
+	size_t bn     = limbs_significant(b->value, b->length);
+	arbint a_copy = arbint_copy(a);
+	arbint b_copy = arbint_copy(b);
+	limb_t one    = 1;
+
+	if (an == 0 || bn == 0)
+	{
+		// gcd(a, 0) = |a| = sign(a) * a + 0 * b
+		arbint other = an == 0 ? b_copy : a_copy;
+		store_limbs(g, other->value, an + bn, POSITIVE);
+		store_limbs(s, &one, an != 0, a_copy->sign);
+		if (t)
+			store_limbs(t, &one, an == 0 && bn != 0, b_copy->sign);
+		arbint_free(a_copy);
+		arbint_free(b_copy);
+		return;
+	}
+
+	size_t n   = max_size(an, bn);
+	limb_t* ap = copy_operands(a, b, n);
+	gcd_cofactors cofactors;
+	cofactors_init(&cofactors, n + 2);
+	sign s_sign;
+	size_t gn = gcd_limbs(ap, ap + n + 1, n, &cofactors, &s_sign);
+
+	// The cofactor belongs to |a|
+	if (a_copy->sign == NEGATIVE)
+		s_sign = s_sign == POSITIVE ? NEGATIVE : POSITIVE;
+	store_limbs(g, ap, gn, POSITIVE);
+	store_limbs(s, cofactors.u[0], cofactors.length, s_sign);
+	free_limbs(ap, 2 * (n + 1));
+	free_limbs(cofactors.u[0], 3 * cofactors.alloc);
+
+	if (t)
+	{
+		// t = (g - s * a) / b, which is exact
+		arbint product   = arbint_mul_arbint(s, a_copy);
+		arbint remainder = arbint_new();
+		arbint_sub_into(product, g, product);
+		arbint_divmod(t, remainder, product, b_copy);
+		arbint_free(product);
+		arbint_free(remainder);
+	}
+	arbint_free(a_copy);
+	arbint_free(b_copy);
+}
+
+bool
+arbint_invert(arbint result, arbint a, arbint m)
+{
+	size_t mn = limbs_significant(m->value, m->length);
+	if (mn == 0)
+	{
+		fprintf(stderr, "arbint_invert: Division by zero\n");
+		exit(EDOM); // 33 Numerical argument out of domain
+	}
+
+	arbint g       = arbint_new();
+	arbint inverse = arbint_new();
+	arbint modulus = arbint_copy(m);
+	modulus->sign  = POSITIVE;
+	arbint_gcdext(g, inverse, NULL, a, modulus);
+
+	bool invertible = limbs_significant(g->value, g->length) == 1 && g->value[0] == 1;
+	if (invertible)
+	{
+		// |s| <= |m|, so one addition makes it nonnegative, and only s = |m|
+		// for |m| = 1 is too large
+		if (inverse->sign == NEGATIVE)
+			arbint_add_into(inverse, inverse, modulus);
+		if (!arbint_lt(inverse, modulus))
+			arbint_set_zero(inverse);
+		size_t length = limbs_significant(inverse->value, inverse->length);
+		store_limbs(result, inverse->value, length, POSITIVE);
+	}
+
+	arbint_free(g);
+	arbint_free(inverse);
+	arbint_free(modulus);
+	return invertible;
+}
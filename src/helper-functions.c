@@ -1,11 +1,14 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocation.h"
 #include "arbint.h"
 #include "datatypes.h"
+#include "limbs.h"
 
 #include "helper-functions.h"
 
@@ -89,11 +92,23 @@ arbint
 arbint_copy(arbint src)
 {
 	// Allocate struct
-	arbint dest = calloc(1, sizeof(arbint_struct));
+	arbint dest = arbint_new_empty();
+	if (dest == NULL)
+	{
+		fprintf(stderr, "arbint_copy: calloc returned null\n");
+		exit(ENOMEM);
+	}
 
-	// Copy the value over
-	size_t bytes_to_copy = src->length * sizeof(uint32_t);
-	uint32_t* dest_value = malloc(bytes_to_copy);
+	// Copy the value over, into the struct if it fits. The copy only gets
+	// room for the digits of the value, not the whole capacity of src.
+	size_t bytes_to_copy = src->length * sizeof(limb_t);
+	limb_t* dest_value   = dest->inline_value;
+	size_t capacity      = ARBINT_INLINE_LIMBS;
+	if (src->length > ARBINT_INLINE_LIMBS)
+	{
+		dest_value = arbint_allocate(bytes_to_copy);
+		capacity   = src->length;
+	}
 	if (dest_value == NULL)
 	{
 		fprintf(stderr, "arbint_copy: malloc returned null\n");
@@ -104,7 +119,8 @@ arbint_copy(arbint src)
 		memcpy(dest_value, src->value, bytes_to_copy);
 	}
 
-	dest->value = dest_value;
+	dest->value    = dest_value;
+	dest->capacity = capacity;
 
 	// Copy the rest
 	dest->sign   = src->sign;
@@ -113,27 +129,157 @@ arbint_copy(arbint src)
 	return dest;
 }
 
+void
+arbint_copy_into(arbint dest, arbint src)
+{
+	// Like arbint_copy, but into an existing arbint that keeps its capacity
+	if (dest == src)
+		return;
+	arbint_reserve(dest, src->length);
+	memcpy(dest->value, src->value, src->length * sizeof(limb_t));
+	dest->length = src->length;
+	dest->sign   = src->sign;
+}
+
+void
+arbint_swap(arbint a, arbint b)
+{
+	// Swap the structs. Values inside them move along, so their pointers have
+	// to be set to the struct they are in now.
+	bool a_inline      = arbint_value_is_inline(a);
+	bool b_inline      = arbint_value_is_inline(b);
+	arbint_struct swap = *a;
+	*a                 = *b;
+	*b                 = swap;
+	if (b_inline)
+		a->value = a->inline_value;
+	if (a_inline)
+		b->value = b->inline_value;
+}
+
 size_t
 arbint_highest_digit(arbint input)
 {
-	// Returns the position of the most significant non-zero digit
-	size_t position = input->length - 1;
-	while (input->value[position] == 0)
-		position--;
-	return position;
+	// Returns the position of the most significant non-zero digit, or 0 for 0.
+	// The value is normalized, so that's its top digit.
+	return input->length - 1;
+}
+
+bool
+arbint_value_is_inline(arbint a)
+{
+	return a->value == a->inline_value;
+}
+
+void
+arbint_resize(arbint to_resize, size_t capacity)
+{
+	// Reallocate the value to room for `capacity` digits, keeping as much of
+	// it as fits
+	if (to_resize->value == NULL)
+	{
+		arbint_init(to_resize);
+	}
+	if (capacity == 0)
+	{
+		capacity = 1;
+	}
+
+	limb_t* new_value = to_resize->value;
+	if (!arbint_value_is_inline(to_resize))
+	{
+		size_t old_size = to_resize->capacity * sizeof(limb_t);
+		new_value       = arbint_reallocate(to_resize->value, old_size,
+		                                    capacity * sizeof(limb_t));
+	}
+	else if (capacity > ARBINT_INLINE_LIMBS)
+	{
+		// Move to the heap
+		new_value = arbint_allocate(capacity * sizeof(limb_t));
+		if (new_value != NULL)
+		{
+			memcpy(new_value, to_resize->value, to_resize->length * sizeof(limb_t));
+		}
+	}
+	else
+	{
+		// Stay in the struct, which always has room for the same number
+		capacity = ARBINT_INLINE_LIMBS;
+	}
+	if (new_value == NULL)
+	{
+		fprintf(stderr, "arbint_resize: realloc failed\n");
+		exit(ENOMEM);
+	}
+
+	to_resize->value    = new_value;
+	to_resize->capacity = capacity;
+	if (to_resize->length > capacity)
+	{
+		arbint_normalize(to_resize, capacity);
+	}
+}
+
+void
+arbint_reserve(arbint to_grow, size_t capacity)
+{
+	// Grow by at least half the current capacity, so that a number that
+	// grows a digit at a time is only reallocated O(log n) times
+	if (to_grow->value == NULL)
+	{
+		arbint_init(to_grow);
+	}
+	if (to_grow->capacity < capacity)
+	{
+		size_t grown = to_grow->capacity + to_grow->capacity / 2;
+		arbint_resize(to_grow, grown > capacity ? grown : capacity);
+	}
+}
+
+void
+arbint_normalize(arbint a, size_t length)
+{
+	// Strip the leading zeros of the first `length` digits, and make 0 a
+	// single positive digit
+	length = limbs_significant(a->value, length);
+	if (length == 0)
+	{
+		a->value[0] = 0;
+		a->sign     = POSITIVE;
+		length      = 1;
+	}
+	a->length = length;
 }
 
 void
 arbint_trim(arbint to_trim)
 {
-	// Remove all leading zeroes
-	size_t last_leading_zero = 1 + arbint_highest_digit(to_trim);
-	size_t bytes_to_keep     = last_leading_zero * sizeof(uint32_t);
-	uint32_t* new_value      = realloc(to_trim->value, bytes_to_keep);
+	// Give up the capacity above the value. Values that are short enough move
+	// into the struct.
+	if (arbint_value_is_inline(to_trim) || to_trim->capacity == to_trim->length)
+	{
+		return;
+	}
+
+	size_t bytes_to_keep = to_trim->length * sizeof(limb_t);
+	size_t old_size      = to_trim->capacity * sizeof(limb_t);
+	limb_t* new_value    = to_trim->inline_value;
+	size_t capacity      = ARBINT_INLINE_LIMBS;
+	if (to_trim->length <= ARBINT_INLINE_LIMBS)
+	{
+		memcpy(new_value, to_trim->value, bytes_to_keep);
+		arbint_deallocate(to_trim->value, old_size);
+	}
+	else
+	{
+		new_value = arbint_reallocate(to_trim->value, old_size, bytes_to_keep);
+		capacity  = to_trim->length;
+	}
+
 	if (new_value)
 	{
-		to_trim->value  = new_value;
-		to_trim->length = last_leading_zero;
+		to_trim->value    = new_value;
+		to_trim->capacity = capacity;
 	}
 	else
 	{
@@ -175,7 +321,7 @@ print_arbint_verbose(arbint to_print)
 		printf("arbint a = arbint_new_length(%lu);\n", to_print->length);
 		for (size_t i = 0; i < to_print->length; i++)
 		{
-			printf("a->value[%lu] = %u;\n", i, to_print->value[i]);
+			printf("a->value[%lu] = %" PRIu64 ";\n", i, (uint64_t) to_print->value[i]);
 		}
 		printf("a->sign = ");
 		switch (to_print->sign)
@@ -0,0 +1,590 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "limbs.h"
+
+// On x86-64, the carry chains of add_n, sub_n, mul_1 and addmul_1 and the
+// schoolbook multiplication are written in assembly (see the end of the file).
+// They need GNU inline assembly, and the ifunc attribute of ELF to pick them
+// when the library is loaded.
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__) && LIMB_BITS == 64
+#define LIMBS_X86_64_ASM
+#include <cpuid.h>
+#endif
+
+/*
+ * All carries are kept in local variables, which the compiler keeps in
+ * registers. Products of two limbs are computed in a dlimb_t of twice the
+ * limb width, so the upper half of a product directly becomes the carry into
+ * the next limb.
+ */
+
+#ifndef LIMBS_X86_64_ASM
+limb_t
+limbs_add_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		limb_t a      = ap[i];
+		limb_t sum    = a + bp[i];
+		limb_t result = sum + carry;
+		carry         = (sum < a) | (result < sum);
+		rp[i]         = result;
+	}
+	return carry;
+}
+#endif
+
+limb_t
+limbs_add(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	limb_t carry = limbs_add_n(rp, ap, bp, bn);
+	return limbs_add_1(rp + bn, ap + bn, an - bn, carry);
+}
+
+limb_t
+limbs_add_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	size_t i     = 0;
+	limb_t carry = b;
+	for (; i < n && carry; i++)
+	{
+		limb_t sum = ap[i] + carry;
+		carry      = sum < carry;
+		rp[i]      = sum;
+	}
+
+	// Without a carry the rest is a plain copy, which is a no-op in place
+	if (rp != ap)
+	{
+		for (; i < n; i++)
+		{
+			rp[i] = ap[i];
+		}
+	}
+	return carry;
+}
+
+#ifndef LIMBS_X86_64_ASM
+limb_t
+limbs_sub_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	limb_t borrow = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		limb_t a          = ap[i];
+		limb_t difference = a - bp[i];
+		limb_t result     = difference - borrow;
+		borrow            = (difference > a) | (result > difference);
+		rp[i]             = result;
+	}
+	return borrow;
+}
+#endif
+
+limb_t
+limbs_sub(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	limb_t borrow = limbs_sub_n(rp, ap, bp, bn);
+	return limbs_sub_1(rp + bn, ap + bn, an - bn, borrow);
+}
+
+limb_t
+limbs_sub_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	size_t i      = 0;
+	limb_t borrow = b;
+	for (; i < n && borrow; i++)
+	{
+		limb_t limb = ap[i];
+		rp[i]       = limb - borrow;
+		borrow      = limb < borrow;
+	}
+
+	if (rp != ap)
+	{
+		for (; i < n; i++)
+		{
+			rp[i] = ap[i];
+		}
+	}
+	return borrow;
+}
+
+static limb_t
+mul_1_generic(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		dlimb_t product = (dlimb_t) ap[i] * b + carry;
+		rp[i]           = (limb_t) product;
+		carry           = (limb_t)(product >> LIMB_BITS);
+	}
+	return carry;
+}
+
+static limb_t
+addmul_1_generic(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	// ap[i] * b + rp[i] + carry < 2^(2 * LIMB_BITS), so this can't overflow
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		dlimb_t product = (dlimb_t) ap[i] * b + rp[i] + carry;
+		rp[i]           = (limb_t) product;
+		carry           = (limb_t)(product >> LIMB_BITS);
+	}
+	return carry;
+}
+
+static void
+mul_basecase_generic(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp,
+                     size_t bn)
+{
+	// Each limb of b adds one shifted row (a * b[i] * (2^LIMB_BITS)^i) to the result
+	rp[an] = mul_1_generic(rp, ap, an, bp[0]);
+	for (size_t i = 1; i < bn; i++)
+	{
+		rp[an + i] = addmul_1_generic(rp + i, ap, an, bp[i]);
+	}
+}
+
+#ifndef LIMBS_X86_64_ASM
+limb_t
+limbs_mul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	return mul_1_generic(rp, ap, n, b);
+}
+
+limb_t
+limbs_addmul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	return addmul_1_generic(rp, ap, n, b);
+}
+
+void
+limbs_mul_basecase(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	mul_basecase_generic(rp, ap, an, bp, bn);
+}
+#endif
+
+limb_t
+limbs_submul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	limb_t borrow = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		dlimb_t product = (dlimb_t) ap[i] * b + borrow;
+		limb_t low      = (limb_t) product;
+		borrow          = (limb_t)(product >> LIMB_BITS) + (rp[i] < low);
+		rp[i] -= low;
+	}
+	return borrow;
+}
+
+limb_t
+limbs_lshift(limb_t* rp, const limb_t* ap, size_t n, unsigned int count)
+{
+	// Go from the top down, so that rp == ap works
+	unsigned int back = LIMB_BITS - count;
+	limb_t out        = ap[n - 1] >> back;
+	for (size_t i = n - 1; i > 0; i--)
+	{
+		rp[i] = (ap[i] << count) | (ap[i - 1] >> back);
+	}
+	rp[0] = ap[0] << count;
+	return out;
+}
+
+limb_t
+limbs_rshift(limb_t* rp, const limb_t* ap, size_t n, unsigned int count)
+{
+	unsigned int back = LIMB_BITS - count;
+	limb_t out        = ap[0] << back;
+	for (size_t i = 0; i + 1 < n; i++)
+	{
+		rp[i] = (ap[i] >> count) | (ap[i + 1] << back);
+	}
+	rp[n - 1] = ap[n - 1] >> count;
+	return out;
+}
+
+/*
+ * The bitwise operations are plain loops over the limbs. They only do one
+ * operation per load and store, so for numbers that don't fit into the cache
+ * they are limited by memory bandwidth either way, and the compiler can
+ * vectorize them where that pays off (with -O3 or -march).
+ */
+
+void
+limbs_and_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		rp[i] = ap[i] & bp[i];
+	}
+}
+
+void
+limbs_ior_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		rp[i] = ap[i] | bp[i];
+	}
+}
+
+void
+limbs_xor_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		rp[i] = ap[i] ^ bp[i];
+	}
+}
+
+void
+limbs_com(limb_t* rp, const limb_t* ap, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		rp[i] = ~ap[i];
+	}
+}
+
+// Unless the popcnt instruction is enabled at build time (-mpopcnt or
+// -march), __builtin_popcount counts bits in software, which is less than half
+// as fast. On x86-64 the function is then compiled a second time with popcnt,
+// and the version that the CPU supports is picked when the library is loaded.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__POPCNT__)
+__attribute__((target_clones("popcnt", "default")))
+#endif
+size_t
+limbs_popcount(const limb_t* ap, size_t n)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+#if LIMB_BITS == 64
+		count += __builtin_popcountll(ap[i]);
+#else
+		count += __builtin_popcount(ap[i]);
+#endif
+	}
+	return count;
+}
+
+int
+limbs_cmp(const limb_t* ap, const limb_t* bp, size_t n)
+{
+	while (n--)
+	{
+		if (ap[n] != bp[n])
+			return ap[n] > bp[n] ? +1 : -1;
+	}
+	return 0;
+}
+
+size_t
+limbs_significant(const limb_t* ap, size_t n)
+{
+	while (n > 0 && ap[n - 1] == 0)
+	{
+		n--;
+	}
+	return n;
+}
+
+unsigned int
+limb_leading_zeros(limb_t x)
+{
+	if (x == 0)
+		return LIMB_BITS;
+#if LIMB_BITS == 64
+	return __builtin_clzll(x);
+#else
+	return __builtin_clz(x);
+#endif
+}
+
+unsigned int
+limb_trailing_zeros(limb_t x)
+{
+	if (x == 0)
+		return LIMB_BITS;
+#if LIMB_BITS == 64
+	return __builtin_ctzll(x);
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+#ifdef LIMBS_X86_64_ASM
+
+/*
+ * x86-64 kernels
+ *
+ * C has no access to the carry flag, so the compiler turns the carry chains
+ * above into compares and extra additions. These loops keep the carry in the
+ * flags from one limb to the next instead, four limbs per iteration, after
+ * the n % 4 limbs that don't fill a block. Only instructions that leave the
+ * flags alone (lea, mov, mulx, jrcxz, and dec for CF alone) run between the
+ * additions.
+ *
+ * add_n and sub_n only need adc and sbb, which every x86-64 CPU has. mul_1
+ * needs mulx (BMI2), which multiplies without touching the flags, and
+ * addmul_1 and the basecase also need adcx and adox (ADX), which add with
+ * the carry in CF and OF respectively. With two carry flags, the high limbs
+ * of the products and the limbs of rp are added in two separate chains
+ * that don't wait for each other. CPUs without these extensions use the
+ * C versions. Which one runs is decided once, when the library is loaded.
+ */
+
+limb_t
+limbs_add_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	size_t rest   = n % 4;
+	size_t blocks = n / 4;
+	limb_t carry, t0, t1, t2, t3;
+	__asm__("	xor	%k[carry], %k[carry]\n"
+	        "	mov	%[rest], %%rcx\n"
+	        "	jrcxz	2f\n"
+	        "1:	mov	(%[ap]), %[t0]\n"
+	        "	adc	(%[bp]), %[t0]\n"
+	        "	mov	%[t0], (%[rp])\n"
+	        "	lea	8(%[ap]), %[ap]\n"
+	        "	lea	8(%[bp]), %[bp]\n"
+	        "	lea	8(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	1b\n"
+	        "2:	mov	%[blocks], %%rcx\n"
+	        "	jrcxz	4f\n"
+	        "3:	mov	(%[ap]), %[t0]\n"
+	        "	mov	8(%[ap]), %[t1]\n"
+	        "	mov	16(%[ap]), %[t2]\n"
+	        "	mov	24(%[ap]), %[t3]\n"
+	        "	adc	(%[bp]), %[t0]\n"
+	        "	adc	8(%[bp]), %[t1]\n"
+	        "	adc	16(%[bp]), %[t2]\n"
+	        "	adc	24(%[bp]), %[t3]\n"
+	        "	mov	%[t0], (%[rp])\n"
+	        "	mov	%[t1], 8(%[rp])\n"
+	        "	mov	%[t2], 16(%[rp])\n"
+	        "	mov	%[t3], 24(%[rp])\n"
+	        "	lea	32(%[ap]), %[ap]\n"
+	        "	lea	32(%[bp]), %[bp]\n"
+	        "	lea	32(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	3b\n"
+	        "4:	setc	%b[carry]\n"
+	        : [rp] "+r"(rp), [ap] "+r"(ap), [bp] "+r"(bp), [carry] "=&r"(carry),
+	          [t0] "=&r"(t0), [t1] "=&r"(t1), [t2] "=&r"(t2), [t3] "=&r"(t3)
+	        : [rest] "r"(rest), [blocks] "r"(blocks)
+	        : "rcx", "cc", "memory");
+	return carry;
+}
+
+limb_t
+limbs_sub_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n)
+{
+	size_t rest   = n % 4;
+	size_t blocks = n / 4;
+	limb_t borrow, t0, t1, t2, t3;
+	__asm__("	xor	%k[borrow], %k[borrow]\n"
+	        "	mov	%[rest], %%rcx\n"
+	        "	jrcxz	2f\n"
+	        "1:	mov	(%[ap]), %[t0]\n"
+	        "	sbb	(%[bp]), %[t0]\n"
+	        "	mov	%[t0], (%[rp])\n"
+	        "	lea	8(%[ap]), %[ap]\n"
+	        "	lea	8(%[bp]), %[bp]\n"
+	        "	lea	8(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	1b\n"
+	        "2:	mov	%[blocks], %%rcx\n"
+	        "	jrcxz	4f\n"
+	        "3:	mov	(%[ap]), %[t0]\n"
+	        "	mov	8(%[ap]), %[t1]\n"
+	        "	mov	16(%[ap]), %[t2]\n"
+	        "	mov	24(%[ap]), %[t3]\n"
+	        "	sbb	(%[bp]), %[t0]\n"
+	        "	sbb	8(%[bp]), %[t1]\n"
+	        "	sbb	16(%[bp]), %[t2]\n"
+	        "	sbb	24(%[bp]), %[t3]\n"
+	        "	mov	%[t0], (%[rp])\n"
+	        "	mov	%[t1], 8(%[rp])\n"
+	        "	mov	%[t2], 16(%[rp])\n"
+	        "	mov	%[t3], 24(%[rp])\n"
+	        "	lea	32(%[ap]), %[ap]\n"
+	        "	lea	32(%[bp]), %[bp]\n"
+	        "	lea	32(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	3b\n"
+	        "4:	setc	%b[borrow]\n"
+	        : [rp] "+r"(rp), [ap] "+r"(ap), [bp] "+r"(bp), [borrow] "=&r"(borrow),
+	          [t0] "=&r"(t0), [t1] "=&r"(t1), [t2] "=&r"(t2), [t3] "=&r"(t3)
+	        : [rest] "r"(rest), [blocks] "r"(blocks)
+	        : "rcx", "cc", "memory");
+	return borrow;
+}
+
+static limb_t
+mul_1_adx(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	// rp[i] = low(a[i] * b) + high(a[i - 1] * b) + CF. b is in rdx for mulx.
+	size_t rest   = n % 4;
+	size_t blocks = n / 4;
+	limb_t carry, low, high;
+	__asm__("	xor	%k[carry], %k[carry]\n"
+	        "	mov	%[rest], %%rcx\n"
+	        "	jrcxz	2f\n"
+	        "1:	mulx	(%[ap]), %[low], %[high]\n"
+	        "	adc	%[carry], %[low]\n"
+	        "	mov	%[low], (%[rp])\n"
+	        "	mov	%[high], %[carry]\n"
+	        "	lea	8(%[ap]), %[ap]\n"
+	        "	lea	8(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	1b\n"
+	        "2:	mov	%[blocks], %%rcx\n"
+	        "	jrcxz	4f\n"
+	        "3:	mulx	(%[ap]), %[low], %[high]\n"
+	        "	adc	%[carry], %[low]\n"
+	        "	mov	%[low], (%[rp])\n"
+	        "	mulx	8(%[ap]), %[low], %[carry]\n"
+	        "	adc	%[high], %[low]\n"
+	        "	mov	%[low], 8(%[rp])\n"
+	        "	mulx	16(%[ap]), %[low], %[high]\n"
+	        "	adc	%[carry], %[low]\n"
+	        "	mov	%[low], 16(%[rp])\n"
+	        "	mulx	24(%[ap]), %[low], %[carry]\n"
+	        "	adc	%[high], %[low]\n"
+	        "	mov	%[low], 24(%[rp])\n"
+	        "	lea	32(%[ap]), %[ap]\n"
+	        "	lea	32(%[rp]), %[rp]\n"
+	        "	dec	%%rcx\n"
+	        "	jnz	3b\n"
+	        "4:	adc	$0, %[carry]\n"
+	        : [rp] "+r"(rp), [ap] "+r"(ap), [carry] "=&r"(carry), [low] "=&r"(low),
+	          [high] "=&r"(high)
+	        : [rest] "r"(rest), [blocks] "r"(blocks), "d"(b)
+	        : "rcx", "cc", "memory");
+	return carry;
+}
+
+static limb_t
+addmul_1_adx(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+{
+	// rp[i] += low(a[i] * b) + high(a[i - 1] * b), with the carries of the
+	// products in CF and those of the additions to rp in OF. dec would change
+	// OF, so the loops count with lea and jrcxz.
+	size_t rest   = n % 4;
+	size_t blocks = n / 4;
+	limb_t carry, low, high;
+	__asm__("	xor	%k[carry], %k[carry]\n"
+	        "	mov	%[rest], %%rcx\n"
+	        "	jrcxz	2f\n"
+	        "1:	mulx	(%[ap]), %[low], %[high]\n"
+	        "	adcx	%[carry], %[low]\n"
+	        "	adox	(%[rp]), %[low]\n"
+	        "	mov	%[low], (%[rp])\n"
+	        "	mov	%[high], %[carry]\n"
+	        "	lea	8(%[ap]), %[ap]\n"
+	        "	lea	8(%[rp]), %[rp]\n"
+	        "	lea	-1(%%rcx), %%rcx\n"
+	        "	jrcxz	2f\n"
+	        "	jmp	1b\n"
+	        "2:	mov	%[blocks], %%rcx\n"
+	        "	jrcxz	4f\n"
+	        "3:	mulx	(%[ap]), %[low], %[high]\n"
+	        "	adcx	%[carry], %[low]\n"
+	        "	adox	(%[rp]), %[low]\n"
+	        "	mov	%[low], (%[rp])\n"
+	        "	mulx	8(%[ap]), %[low], %[carry]\n"
+	        "	adcx	%[high], %[low]\n"
+	        "	adox	8(%[rp]), %[low]\n"
+	        "	mov	%[low], 8(%[rp])\n"
+	        "	mulx	16(%[ap]), %[low], %[high]\n"
+	        "	adcx	%[carry], %[low]\n"
+	        "	adox	16(%[rp]), %[low]\n"
+	        "	mov	%[low], 16(%[rp])\n"
+	        "	mulx	24(%[ap]), %[low], %[carry]\n"
+	        "	adcx	%[high], %[low]\n"
+	        "	adox	24(%[rp]), %[low]\n"
+	        "	mov	%[low], 24(%[rp])\n"
+	        "	lea	32(%[ap]), %[ap]\n"
+	        "	lea	32(%[rp]), %[rp]\n"
+	        "	lea	-1(%%rcx), %%rcx\n"
+	        "	jrcxz	4f\n"
+	        "	jmp	3b\n"
+	        "4:	mov	$0, %k[low]\n"
+	        "	adcx	%[low], %[carry]\n"
+	        "	adox	%[low], %[carry]\n"
+	        : [rp] "+r"(rp), [ap] "+r"(ap), [carry] "=&r"(carry), [low] "=&r"(low),
+	          [high] "=&r"(high)
+	        : [rest] "r"(rest), [blocks] "r"(blocks), "d"(b)
+	        : "rcx", "cc", "memory");
+	return carry;
+}
+
+static void
+mul_basecase_adx(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	// The rows of the schoolbook multiplication call the kernels directly,
+	// where the compiler can inline them, instead of through the dispatch
+	rp[an] = mul_1_adx(rp, ap, an, bp[0]);
+	for (size_t i = 1; i < bn; i++)
+	{
+		rp[an + i] = addmul_1_adx(rp + i, ap, an, bp[i]);
+	}
+}
+
+static bool
+cpu_has_adx(void)
+{
+	// Leaf 7 of cpuid lists BMI2 and ADX in EBX. The resolvers below run
+	// before the program starts, so this must not need anything set up.
+	unsigned int eax, ebx, ecx, edx;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	(void) eax;
+	(void) ecx;
+	(void) edx;
+	return (ebx & bit_BMI2) && (ebx & bit_ADX);
+}
+
+typedef limb_t (*mul_1_function)(limb_t* rp, const limb_t* ap, size_t n, limb_t b);
+typedef void (*mul_basecase_function)(limb_t* rp, const limb_t* ap, size_t an,
+                                      const limb_t* bp, size_t bn);
+
+static mul_1_function
+resolve_mul_1(void)
+{
+	return cpu_has_adx() ? mul_1_adx : mul_1_generic;
+}
+
+static mul_1_function
+resolve_addmul_1(void)
+{
+	return cpu_has_adx() ? addmul_1_adx : addmul_1_generic;
+}
+
+static mul_basecase_function
+resolve_mul_basecase(void)
+{
+	return cpu_has_adx() ? mul_basecase_adx : mul_basecase_generic;
+}
+
+limb_t limbs_mul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+    __attribute__((ifunc("resolve_mul_1")));
+limb_t limbs_addmul_1(limb_t* rp, const limb_t* ap, size_t n, limb_t b)
+    __attribute__((ifunc("resolve_addmul_1")));
+void limbs_mul_basecase(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp,
+                        size_t bn) __attribute__((ifunc("resolve_mul_basecase")));
+
+#endif
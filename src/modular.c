@@ -0,0 +1,574 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "arbint.h"
+#include "datatypes.h"
+#include "division.h"
+#include "helper-functions.h"
+#include "limbs.h"
+#include "multiplication.h"
+
+#include "modular.h"
+
+/*
+ * Layout of the scratch space of a context with an n-limb modulus. The
+ * operands are copied into it with exactly n limbs, so that the limb
+ * functions don't have to care about their lengths.
+ *
+ * a, b:     n limbs each, the operands
+ * product:  2n limbs, a * b
+ * residue:  n + 1 limbs, the reduced product
+ * estimate: up to 2n + 3 limbs, Barrett's quotient estimate times the
+ *           reciprocal
+ * multiple: 2n + 1 limbs, the quotient estimate times m
+ *
+ * Montgomery reduction of large numbers uses the space from 4n on for its
+ * 2n-limb quotient and multiple of m instead.
+ */
+#define SCRATCH_LIMBS(n) (9 * (n) + 6)
+
+// Below this many limbs, Barrett reduction computes only the halves of its
+// products that it needs, with basecase multiplication. Above it, full
+// products with the faster algorithms take less time.
+#define BARRETT_SHORT_THRESHOLD (4 * KARATSUBA_THRESHOLD)
+
+// From this many limbs on, Montgomery reduction multiplies by -1 / m mod R
+// instead of clearing one limb at a time. Its two full products only beat
+// the quadratic loop once they're done with Toom-3 or transforms.
+#define REDC_MUL_THRESHOLD (2 * TOOM3_THRESHOLD)
+
+// Largest window of exponent bits in arbint_powm, which needs a table of
+// 2^(POWM_MAX_WINDOW - 1) powers of the base
+#define POWM_MAX_WINDOW 10
+
+static limb_t*
+alloc_limbs(size_t count)
+{
+	limb_t* limbs = arbint_allocate(count * sizeof(limb_t));
+	if (limbs == NULL)
+	{
+		fprintf(stderr, "arbint_mod_ctx_new: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return limbs;
+}
+
+static void
+free_limbs(limb_t* limbs, size_t count)
+{
+	arbint_deallocate(limbs, count * sizeof(limb_t));
+}
+
+static void
+check_exponent(arbint exp, const char* function)
+{
+	if (exp->sign == NEGATIVE && limbs_significant(exp->value, exp->length) != 0)
+	{
+		fprintf(stderr, "%s: Negative exponent\n", function);
+		exit(EDOM); // 33 Numerical argument out of domain
+	}
+}
+
+static limb_t
+limb_inverse(limb_t x)
+{
+	// 1 / x mod 2^LIMB_BITS for odd x by Newton's iteration, which doubles the
+	// number of correct bits each time. Every odd x is its own inverse mod 8,
+	// so five steps give 96 bits.
+	limb_t inverse = x;
+	for (int i = 0; i < 5; i++)
+	{
+		inverse *= 2 - x * inverse;
+	}
+	return inverse;
+}
+
+arbint_mod_ctx
+arbint_mod_ctx_new(arbint modulus)
+{
+	size_t n = limbs_significant(modulus->value, modulus->length);
+	if (n == 0)
+	{
+		fprintf(stderr, "arbint_mod_ctx_new: Modulus is zero\n");
+		exit(EDOM); // 33 Numerical argument out of domain
+	}
+
+	arbint_mod_ctx ctx = arbint_allocate(sizeof(arbint_mod_ctx_struct));
+	if (ctx == NULL)
+	{
+		fprintf(stderr, "arbint_mod_ctx_new: malloc failed\n");
+		exit(ENOMEM);
+	}
+
+	// The constants share one allocation with the modulus
+	ctx->length     = n;
+	ctx->modulus    = alloc_limbs(4 * n + 2);
+	ctx->r_squared  = ctx->modulus + n;
+	ctx->reciprocal = ctx->r_squared + n;
+	ctx->inverse_n  = ctx->reciprocal + n + 2;
+	ctx->scratch    = alloc_limbs(SCRATCH_LIMBS(n));
+	memcpy(ctx->modulus, modulus->value, n * sizeof(limb_t));
+
+	// Both forms get their constant from dividing R^2 = 2^(2n * LIMB_BITS) by m:
+	// the quotient is Barrett's reciprocal and the remainder is what converts
+	// numbers into Montgomery form
+	limb_t* r_power = ctx->scratch;
+	memset(r_power, 0, 2 * n * sizeof(limb_t));
+	r_power[2 * n] = 1;
+	limbs_div_qr(ctx->reciprocal, ctx->r_squared, r_power, 2 * n + 1, ctx->modulus, n);
+	ctx->reciprocal_length = limbs_significant(ctx->reciprocal, n + 2);
+
+	ctx->montgomery = ctx->modulus[0] & 1;
+	ctx->inverse    = ctx->montgomery ? -limb_inverse(ctx->modulus[0]) : 0;
+	if (ctx->montgomery && n >= REDC_MUL_THRESHOLD)
+	{
+		// -1 / m mod R is the multiple of m that the word by word REDC adds
+		// to 1. Only the low n limbs of that sum matter.
+		limb_t* sum = ctx->scratch;
+		memset(sum, 0, n * sizeof(limb_t));
+		sum[0] = 1;
+		for (size_t i = 0; i < n; i++)
+		{
+			ctx->inverse_n[i] = sum[i] * ctx->inverse;
+			limbs_addmul_1(sum + i, ctx->modulus, n - i, ctx->inverse_n[i]);
+		}
+	}
+	return ctx;
+}
+
+void
+arbint_mod_ctx_free(arbint_mod_ctx ctx)
+{
+	free_limbs(ctx->modulus, 4 * ctx->length + 2);
+	free_limbs(ctx->scratch, SCRATCH_LIMBS(ctx->length));
+	arbint_deallocate(ctx, sizeof(arbint_mod_ctx_struct));
+}
+
+static void
+redc_mul(limb_t* rp, const limb_t* tp, arbint_mod_ctx ctx)
+{
+	// redc with the whole multiple of m at once: q = t * (-1 / m) mod R makes
+	// t + q * m divisible by R. Both products use the subquadratic
+	// multiplication algorithms, while the word by word REDC is quadratic.
+	size_t n         = ctx->length;
+	const limb_t* mp = ctx->modulus;
+	limb_t* quotient = ctx->scratch + 4 * n;
+	limb_t* multiple = quotient + 2 * n;
+	limbs_mul(quotient, tp, n, ctx->inverse_n, n);
+	limbs_mul(multiple, quotient, n, mp, n);
+
+	// The low halves of t and q * m add up to either 0 or R
+	limb_t low_carry = limbs_significant(tp, n) != 0;
+	limb_t carry     = limbs_add_n(rp, tp + n, multiple + n, n);
+	carry += limbs_add_1(rp, rp, n, low_carry);
+	if (carry || limbs_cmp(rp, mp, n) >= 0)
+	{
+		limbs_sub_n(rp, rp, mp, n);
+	}
+}
+
+static void
+redc(limb_t* rp, limb_t* tp, arbint_mod_ctx ctx)
+{
+	// {rp, n} = {tp, 2n} / R mod m for {tp, 2n} < m * R, destroys tp.
+	// Each step adds the multiple of m that clears the lowest limb of t. That
+	// limb is then free to hold the carry out of the addition, and all of the
+	// carries are added to the upper half at the end.
+	size_t n         = ctx->length;
+	const limb_t* mp = ctx->modulus;
+	limb_t inverse   = ctx->inverse;
+	if (n >= REDC_MUL_THRESHOLD)
+	{
+		redc_mul(rp, tp, ctx);
+		return;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		limb_t q = tp[i] * inverse;
+		tp[i]    = limbs_addmul_1(tp + i, mp, n, q);
+	}
+
+	// t / R < 2m, so one subtraction is enough
+	limb_t carry = limbs_add_n(rp, tp + n, tp, n);
+	if (carry || limbs_cmp(rp, mp, n) >= 0)
+	{
+		limbs_sub_n(rp, rp, mp, n);
+	}
+}
+
+static void
+mul_high(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn, size_t cut)
+{
+	// {rp, an + bn - cut} = the limbs from `cut` on of {ap, an} * {bp, bn},
+	// without the partial products below column cut. Those add up to less
+	// than (cut + 1) * B^(cut + 1), so limbs from cut + 2 on are at most one
+	// too small.
+	memset(rp, 0, (an + bn - cut) * sizeof(limb_t));
+	for (size_t j = 0; j < bn; j++)
+	{
+		if (an + j <= cut)
+			continue;
+		size_t i         = cut > j ? cut - j : 0;
+		rp[an + j - cut] = limbs_addmul_1(rp + i + j - cut, ap + i, an - i, bp[j]);
+	}
+}
+
+static void
+mul_low(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t bn, size_t n)
+{
+	// {rp, n} = {ap, n} * {bp, bn} mod B^n, for bn <= n
+	memset(rp, 0, n * sizeof(limb_t));
+	for (size_t j = 0; j < bn; j++)
+	{
+		limbs_addmul_1(rp + j, ap, n - j, bp[j]);
+	}
+}
+
+static void
+barrett(limb_t* rp, const limb_t* tp, arbint_mod_ctx ctx)
+{
+	// {rp, n} = {tp, 2n} mod m for {tp, 2n} < m^2. The quotient is estimated
+	// from the top n + 1 limbs of t times the reciprocal, which is at most
+	// two too small (Handbook of Applied Cryptography, 14.42). So only the
+	// low n + 1 limbs of t and of the estimate times m are needed.
+	size_t n         = ctx->length;
+	const limb_t* mp = ctx->modulus;
+	limb_t* residue  = ctx->scratch + 4 * n;
+	limb_t* estimate = residue + n + 1;
+	limb_t* multiple = estimate + 2 * n + 3;
+	limb_t* quotient;
+
+	if (n < BARRETT_SHORT_THRESHOLD)
+	{
+		// Only compute the parts of the products that are used. Leaving out
+		// the low partial products of the estimate makes it at most one
+		// smaller still.
+		mul_high(estimate, ctx->reciprocal, ctx->reciprocal_length, tp + n - 1, n + 1,
+		         n - 1);
+		quotient = estimate + 2;
+		mul_low(multiple, quotient, mp, n, n + 1);
+	}
+	else
+	{
+		limbs_mul(estimate, ctx->reciprocal, ctx->reciprocal_length, tp + n - 1, n + 1);
+		quotient = estimate + n + 1;
+		limbs_mul(multiple, quotient, n + 1, mp, n);
+	}
+	limbs_sub_n(residue, tp, multiple, n + 1);
+
+	// The residue is less than 4m and fits into n + 1 limbs
+	while (residue[n] || limbs_cmp(residue, mp, n) >= 0)
+	{
+		residue[n] -= limbs_sub_n(residue, residue, mp, n);
+	}
+	memcpy(rp, residue, n * sizeof(limb_t));
+}
+
+static void
+reduce(limb_t* rp, limb_t* tp, arbint_mod_ctx ctx)
+{
+	if (ctx->montgomery)
+		redc(rp, tp, ctx);
+	else
+		barrett(rp, tp, ctx);
+}
+
+static void
+load_operand(limb_t* dst, arbint a, size_t n)
+{
+	// Copy a, which is less than m, into exactly n limbs
+	size_t count = a->length < n ? a->length : n;
+	memcpy(dst, a->value, count * sizeof(limb_t));
+	memset(dst + count, 0, (n - count) * sizeof(limb_t));
+}
+
+static void
+store_residue(arbint result, const limb_t* rp, size_t n)
+{
+	// Only reallocate result if it has room for fewer than n digits
+	arbint_reserve(result, n);
+	memcpy(result->value, rp, n * sizeof(limb_t));
+	result->sign = POSITIVE;
+	arbint_normalize(result, n);
+}
+
+void
+arbint_to_mod(arbint result, arbint a, arbint_mod_ctx ctx)
+{
+	size_t n         = ctx->length;
+	const limb_t* mp = ctx->modulus;
+	limb_t* residue  = ctx->scratch;
+	limb_t* product  = residue + 2 * n;
+
+	// Numbers that aren't already less than m are reduced with a division,
+	// which only happens once for every number that enters the context
+	size_t length = limbs_significant(a->value, a->length);
+	if (length > n || (length == n && limbs_cmp(a->value, mp, n) >= 0))
+	{
+		limb_t* quotient = alloc_limbs(length - n + 1);
+		limbs_div_qr(quotient, residue, a->value, length, mp, n);
+		free_limbs(quotient, length - n + 1);
+	}
+	else
+	{
+		load_operand(residue, a, n);
+	}
+
+	if (a->sign == NEGATIVE && limbs_significant(residue, n) != 0)
+	{
+		limbs_sub_n(residue, mp, residue, n);
+	}
+
+	if (ctx->montgomery)
+	{
+		// a * R = REDC(a * R^2)
+		limbs_mul(product, residue, n, ctx->r_squared, n);
+		redc(residue, product, ctx);
+	}
+	store_residue(result, residue, n);
+}
+
+void
+arbint_from_mod(arbint result, arbint a, arbint_mod_ctx ctx)
+{
+	size_t n        = ctx->length;
+	limb_t* product = ctx->scratch + 2 * n;
+	load_operand(product, a, n);
+	if (ctx->montgomery)
+	{
+		// a = REDC(a * R)
+		memset(product + n, 0, n * sizeof(limb_t));
+		redc(product, product, ctx);
+	}
+	store_residue(result, product, n);
+}
+
+static void
+mod_mul(limb_t* rp, const limb_t* ap, const limb_t* bp, arbint_mod_ctx ctx)
+{
+	// {rp, n} = {ap, n} * {bp, n} mod m in the form of the context. The
+	// product goes to the scratch space after the operands, so rp, ap and bp
+	// may be the same, but must not be in the scratch space from 2n on.
+	size_t n        = ctx->length;
+	limb_t* product = ctx->scratch + 2 * n;
+	limbs_mul(product, ap, n, bp, n);
+	reduce(rp, product, ctx);
+}
+
+static void
+mod_sqr(limb_t* rp, const limb_t* ap, arbint_mod_ctx ctx)
+{
+	size_t n        = ctx->length;
+	limb_t* product = ctx->scratch + 2 * n;
+	limbs_sqr(product, ap, n);
+	reduce(rp, product, ctx);
+}
+
+void
+arbint_mulmod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx)
+{
+	if (a == b)
+	{
+		arbint_sqrmod(result, a, ctx);
+		return;
+	}
+
+	size_t n   = ctx->length;
+	limb_t* ap = ctx->scratch;
+	limb_t* bp = ap + n;
+	load_operand(ap, a, n);
+	load_operand(bp, b, n);
+	mod_mul(ap, ap, bp, ctx);
+	store_residue(result, ap, n);
+}
+
+void
+arbint_sqrmod(arbint result, arbint a, arbint_mod_ctx ctx)
+{
+	size_t n   = ctx->length;
+	limb_t* ap = ctx->scratch;
+	load_operand(ap, a, n);
+	mod_sqr(ap, ap, ctx);
+	store_residue(result, ap, n);
+}
+
+void
+arbint_addmod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx)
+{
+	// Both forms are linear, so a sum is reduced by subtracting m at most once
+	size_t n         = ctx->length;
+	const limb_t* mp = ctx->modulus;
+	limb_t* ap       = ctx->scratch;
+	limb_t* bp       = ap + n;
+	load_operand(ap, a, n);
+	load_operand(bp, b, n);
+	limb_t carry = limbs_add_n(ap, ap, bp, n);
+	if (carry || limbs_cmp(ap, mp, n) >= 0)
+	{
+		limbs_sub_n(ap, ap, mp, n);
+	}
+	store_residue(result, ap, n);
+}
+
+void
+arbint_submod(arbint result, arbint a, arbint b, arbint_mod_ctx ctx)
+{
+	size_t n   = ctx->length;
+	limb_t* ap = ctx->scratch;
+	limb_t* bp = ap + n;
+	load_operand(ap, a, n);
+	load_operand(bp, b, n);
+	if (limbs_sub_n(ap, ap, bp, n))
+	{
+		limbs_add_n(ap, ap, ctx->modulus, n);
+	}
+	store_residue(result, ap, n);
+}
+
+static bool
+exponent_bit(const limb_t* ep, size_t bit)
+{
+	return (ep[bit / LIMB_BITS] >> (bit % LIMB_BITS)) & 1;
+}
+
+static limb_t
+exponent_bits(const limb_t* ep, size_t high, size_t low)
+{
+	// Bits low..high of the exponent as a number, for high - low < LIMB_BITS
+	size_t limb        = low / LIMB_BITS;
+	unsigned int shift = low % LIMB_BITS;
+	limb_t bits        = ep[limb] >> shift;
+	if (high / LIMB_BITS != limb)
+	{
+		bits |= ep[limb + 1] << (LIMB_BITS - shift);
+	}
+	return bits & (((limb_t) 2 << (high - low)) - 1);
+}
+
+static unsigned int
+window_size(size_t bits)
+{
+	// With windows of k bits, the odd powers of the base up to 2^k - 1 take
+	// 2^(k - 1) multiplications up front, and the exponent takes about
+	// bits / (k + 1) more. Pick the k for which the sum is smallest.
+	unsigned int k = 1;
+	while (k < POWM_MAX_WINDOW)
+	{
+		size_t cost      = ((size_t) 1 << (k - 1)) + bits / (k + 1);
+		size_t next_cost = ((size_t) 1 << k) + bits / (k + 2);
+		if (next_cost >= cost)
+			break;
+		k++;
+	}
+	return k;
+}
+
+void
+arbint_powm_ctx(arbint result, arbint base, arbint exp, arbint_mod_ctx ctx)
+{
+	check_exponent(exp, "arbint_powm_ctx");
+	size_t n             = ctx->length;
+	size_t exp_length    = limbs_significant(exp->value, exp->length);
+	const limb_t* ep     = exp->value;
+	size_t bits          = exp_length * LIMB_BITS;
+	bits                 = exp_length ? bits - limb_leading_zeros(ep[exp_length - 1]) : 0;
+	unsigned int k       = window_size(bits);
+	size_t table_size    = (size_t) 1 << (k - 1);
+	limb_t* powers       = alloc_limbs((table_size + 2) * n);
+	limb_t* base_squared = powers + table_size * n;
+	limb_t* power        = base_squared + n;
+
+	// powers holds base^1, base^3, ..., base^(2^k - 1)
+	load_operand(powers, base, n);
+	if (table_size > 1)
+	{
+		mod_sqr(base_squared, powers, ctx);
+		for (size_t i = 1; i < table_size; i++)
+		{
+			mod_mul(powers + i * n, powers + (i - 1) * n, base_squared, ctx);
+		}
+	}
+
+	// Go through the exponent from the top. Zero bits take one squaring. A
+	// one bit starts a window of up to k bits that ends in a one bit, and
+	// takes one squaring per bit and a single multiplication with the odd
+	// power of the base that the window stands for.
+	if (bits == 0)
+	{
+		// base^0 = 1, which is R mod m in Montgomery form
+		memset(power, 0, n * sizeof(limb_t));
+		power[0] = 1;
+		if (ctx->montgomery)
+			mod_mul(power, power, ctx->r_squared, ctx);
+	}
+	size_t bit = bits;
+	while (bit > 0)
+	{
+		if (!exponent_bit(ep, bit - 1))
+		{
+			mod_sqr(power, power, ctx);
+			bit--;
+			continue;
+		}
+
+		size_t low = bit > k ? bit - k : 0;
+		while (!exponent_bit(ep, low))
+		{
+			low++;
+		}
+		const limb_t* odd_power = powers + (exponent_bits(ep, bit - 1, low) >> 1) * n;
+
+		// The first window starts with its power of the base instead of
+		// squaring 1
+		if (bit == bits)
+		{
+			memcpy(power, odd_power, n * sizeof(limb_t));
+		}
+		else
+		{
+			for (size_t i = low; i < bit; i++)
+			{
+				mod_sqr(power, power, ctx);
+			}
+			mod_mul(power, power, odd_power, ctx);
+		}
+		bit = low;
+	}
+
+	store_residue(result, power, n);
+	free_limbs(powers, (table_size + 2) * n);
+}
+
+void
+arbint_powm(arbint result, arbint base, arbint exp, arbint mod)
+{
+	arbint_mod_ctx ctx = arbint_mod_ctx_new(mod);
+	arbint power       = arbint_new_length(ctx->length);
+
+	// |exp| as a view of the limbs of exp, which isn't changed before the end
+	arbint_struct exponent = {.value = exp->value, .length = exp->length};
+	exponent.sign          = POSITIVE;
+	if (exp->sign == NEGATIVE && limbs_significant(exp->value, exp->length) != 0)
+	{
+		// base^-e = (1 / base)^e
+		if (!arbint_invert(power, base, mod))
+		{
+			fprintf(stderr, "arbint_powm: Base is not invertible\n");
+			exit(EDOM); // 33 Numerical argument out of domain
+		}
+		arbint_to_mod(power, power, ctx);
+	}
+	else
+	{
+		arbint_to_mod(power, base, ctx);
+	}
+	arbint_powm_ctx(power, power, &exponent, ctx);
+	arbint_from_mod(result, power, ctx);
+	arbint_free(power);
+	arbint_mod_ctx_free(ctx);
+}
@@ -0,0 +1,636 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "limbs.h"
+#include "multiplication.h"
+#include "ntt.h"
+#include "thread-pool.h"
+
+/*
+ * Helpers for the evaluation and interpolation steps
+ */
+
+static bool
+abs_diff(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	// {rp, an} = |{ap, an} - {bp, bn}|, requires an >= bn
+	// Returns true if a < b, i.e. if the difference is negative
+	bool a_is_larger = false;
+	for (size_t i = bn; i < an; i++)
+	{
+		if (ap[i])
+		{
+			a_is_larger = true;
+			break;
+		}
+	}
+
+	if (a_is_larger || limbs_cmp(ap, bp, bn) >= 0)
+	{
+		limbs_sub(rp, ap, an, bp, bn);
+		return false;
+	}
+	else
+	{
+		// The upper an - bn limbs of a are zero, and so is the difference
+		limbs_sub_n(rp, bp, ap, bn);
+		memset(rp + bn, 0, (an - bn) * sizeof(limb_t));
+		return true;
+	}
+}
+
+static void
+divexact_by3(limb_t* rp, const limb_t* ap, size_t n)
+{
+	// {rp, n} = {ap, n} / 3, where the division must not leave a remainder.
+	// An exact quotient is a times the inverse of 3 modulo 2^LIMB_BITS, so this
+	// works from the bottom up with multiplications instead of divisions. The
+	// borrow is what the limbs of q * 3 carry into the next limb.
+	const limb_t inverse = LIMB_MAX / 3 * 2 + 1;
+	limb_t borrow        = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		limb_t limb       = ap[i];
+		limb_t difference = limb - borrow;
+		limb_t q          = difference * inverse;
+		dlimb_t q_times_3 = (dlimb_t) q * 3;
+		rp[i]             = q;
+		borrow            = (difference > limb) + (limb_t)(q_times_3 >> LIMB_BITS);
+	}
+}
+
+/*
+ * Multiplication algorithms
+ */
+
+static size_t
+mul_n_scratch(size_t n)
+{
+	// Number of limbs of scratch space mul_n needs for n-limb operands.
+	// Karatsuba uses 4 * ceil(n/2) + 1 limbs and Toom-3 12 * (ceil(n/3) + 1)
+	// limbs on each level; 6n + 100 covers that plus all recursive calls, and
+	// unlike the exact sum it grows monotonically with n.
+	if (n < KARATSUBA_THRESHOLD)
+		return 0;
+	return 6 * n + 100;
+}
+
+static size_t sqr_n_scratch(size_t n);
+static void mul_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n,
+                  limb_t* scratch);
+static void sqr_n(limb_t* rp, const limb_t* ap, size_t n, limb_t* scratch);
+
+/*
+ * The products that Karatsuba and Toom-3 recurse on are independent of each
+ * other. For operands above the thread threshold, all but the last one go to
+ * the thread pool with scratch space of their own, and the last one uses the
+ * scratch space of the caller.
+ */
+
+typedef struct
+{
+	limb_t* rp;
+	const limb_t* ap;
+	const limb_t* bp; // NULL to square ap
+	size_t n;
+} sub_product;
+
+static void
+compute_sub_product(sub_product* product, limb_t* scratch)
+{
+	if (product->bp == NULL)
+		sqr_n(product->rp, product->ap, product->n, scratch);
+	else
+		mul_n(product->rp, product->ap, product->bp, product->n, scratch);
+}
+
+static void
+sub_product_task(void* argument)
+{
+	sub_product* product = argument;
+	size_t n             = product->n;
+	size_t size          = product->bp ? mul_n_scratch(n) : sqr_n_scratch(n);
+	limb_t* scratch      = arbint_allocate(size * sizeof(limb_t));
+	if (scratch == NULL && size > 0)
+	{
+		fprintf(stderr, "limbs_mul: malloc failed\n");
+		exit(ENOMEM);
+	}
+	compute_sub_product(product, scratch);
+	arbint_deallocate(scratch, size * sizeof(limb_t));
+}
+
+static void
+compute_sub_products(sub_product* products, size_t count, size_t n, limb_t* scratch)
+{
+	// At most five products, for operands of n limbs
+	thread_pool_task tasks[4];
+	size_t spawned = thread_pool_active(n) ? count - 1 : 0;
+	for (size_t i = 0; i < spawned; i++)
+	{
+		thread_pool_spawn(&tasks[i], sub_product_task, &products[i]);
+	}
+	for (size_t i = spawned; i < count; i++)
+	{
+		compute_sub_product(&products[i], scratch);
+	}
+	for (size_t i = 0; i < spawned; i++)
+	{
+		thread_pool_join(&tasks[i]);
+	}
+}
+
+static void
+mul_karatsuba(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n,
+              limb_t* scratch)
+{
+	/*
+	Split a = a1 * x + a0 and b = b1 * x + b0, where x = (2^LIMB_BITS)^low. Then
+
+	a * b = a1*b1 * x^2 + (a0*b0 + a1*b1 - (a0 - a1)*(b0 - b1)) * x + a0*b0
+
+	which needs three multiplications of half the size instead of four.
+	*/
+	size_t high = n / 2;
+	size_t low  = n - high;
+
+	const limb_t* a0 = ap;
+	const limb_t* a1 = ap + low;
+	const limb_t* b0 = bp;
+	const limb_t* b1 = bp + low;
+
+	// Scratch layout: product of differences (2 * low), middle term
+	// (2 * low + 1, also holds the differences at first), then space for the
+	// recursive calls
+	limb_t* diff_product = scratch;
+	limb_t* middle       = scratch + 2 * low;
+	limb_t* a_diff       = middle;
+	limb_t* b_diff       = middle + low;
+	limb_t* next_scratch = scratch + 4 * low + 1;
+
+	bool negative = abs_diff(a_diff, a0, low, a1, high);
+	negative ^= abs_diff(b_diff, b0, low, b1, high);
+
+	sub_product products[3] = {{diff_product, a_diff, b_diff, low},
+	                           {rp, a0, b0, low},
+	                           {rp + 2 * low, a1, b1, high}};
+	compute_sub_products(products, 3, n, next_scratch);
+
+	// middle = a0*b0 + a1*b1 - (a0 - a1)*(b0 - b1), which is never negative
+	middle[2 * low] = limbs_add(middle, rp, 2 * low, rp + 2 * low, 2 * high);
+	if (negative)
+	{
+		limbs_add(middle, middle, 2 * low + 1, diff_product, 2 * low);
+	}
+	else
+	{
+		limbs_sub(middle, middle, 2 * low + 1, diff_product, 2 * low);
+	}
+
+	// The middle term is a0*b1 + a1*b0 < 2 * (2^LIMB_BITS)^n, so its limbs above
+	// n + 1 are zero and it fits into the rest of rp
+	size_t rest_length   = 2 * n - low;
+	size_t middle_length = 2 * low + 1 < rest_length ? 2 * low + 1 : rest_length;
+	limbs_add(rp + low, rp + low, rest_length, middle, middle_length);
+}
+
+static void
+toom3_eval_2(limb_t* rp, const limb_t* ap, size_t part, size_t top)
+{
+	// {rp, part + 1} = a0 + 2a1 + 4a2, the value of a at the point 2
+	memcpy(rp, ap, part * sizeof(limb_t));
+	rp[part]     = limbs_addmul_1(rp, ap + part, part, 2);
+	limb_t carry = limbs_addmul_1(rp, ap + 2 * part, top, 4);
+	limbs_add_1(rp + top, rp + top, part + 1 - top, carry);
+}
+
+static void
+toom3_interpolate(limb_t* rp, size_t n, size_t part, size_t top, limb_t* v1,
+                  limb_t* vm1, bool vm1_negative, limb_t* v2)
+{
+	/*
+	Recover the coefficients c1, c2, c3 of the product from the values at 1, -1
+	and 2 (2 * part + 2 limbs each) and add them to rp, which already holds
+	v0 = c0 and vinf = c4 at their final places. The steps are ordered so that
+	every intermediate value except vm1 is non-negative.
+	*/
+	size_t product_length = 2 * part + 2;
+	limb_t* v0            = rp;
+	limb_t* vinf          = rp + 4 * part;
+
+	// v2 = (v2 - vm1) / 3 = c1 + c2 + 3c3 + 5c4
+	if (vm1_negative)
+		limbs_add_n(v2, v2, vm1, product_length);
+	else
+		limbs_sub_n(v2, v2, vm1, product_length);
+	divexact_by3(v2, v2, product_length);
+
+	// vm1 = (v1 - vm1) / 2 = c1 + c3
+	if (vm1_negative)
+		limbs_add_n(vm1, v1, vm1, product_length);
+	else
+		limbs_sub_n(vm1, v1, vm1, product_length);
+	limbs_rshift(vm1, vm1, product_length, 1);
+
+	// v1 = v1 - (c1 + c3) - v0 - vinf = c2
+	limbs_sub_n(v1, v1, vm1, product_length);
+	limbs_sub(v1, v1, product_length, v0, 2 * part);
+	limbs_sub(v1, v1, product_length, vinf, 2 * top);
+
+	// v2 = (v2 - c2 - (c1 + c3) - 5 * vinf) / 2 = c3
+	limbs_sub_n(v2, v2, v1, product_length);
+	limbs_sub_n(v2, v2, vm1, product_length);
+	limb_t borrow = limbs_submul_1(v2, vinf, 2 * top, 5);
+	limbs_sub_1(v2 + 2 * top, v2 + 2 * top, product_length - 2 * top, borrow);
+	limbs_rshift(v2, v2, product_length, 1);
+
+	// vm1 = (c1 + c3) - c3 = c1
+	limbs_sub_n(vm1, vm1, v2, product_length);
+
+	// Add c1 * x, c2 * x^2 and c3 * x^3 to c0 + c4 * x^4. Limbs of c1..c3
+	// beyond the end of rp are zero.
+	limb_t* coefficients[3] = {vm1, v1, v2};
+	for (size_t i = 1; i <= 3; i++)
+	{
+		size_t offset      = i * part;
+		size_t rest_length = 2 * n - offset;
+		size_t length      = product_length < rest_length ? product_length : rest_length;
+		limbs_add(rp + offset, rp + offset, rest_length, coefficients[i - 1], length);
+	}
+}
+
+static void
+mul_toom3(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n,
+          limb_t* scratch)
+{
+	/*
+	Split both numbers into three parts, a = a2 * x^2 + a1 * x + a0 with
+	x = (2^LIMB_BITS)^part, and view them as polynomials in x. The product c(x) has
+	degree 4, so it is determined by its values at five points. We evaluate
+	at 0, 1, -1, 2 and infinity, which needs five multiplications of a third
+	of the size:
+
+	  v0   = a0 * b0                               = c0
+	  v1   = (a0 + a1 + a2) * (b0 + b1 + b2)       = c0 + c1 + c2 + c3 + c4
+	  vm1  = (a0 - a1 + a2) * (b0 - b1 + b2)       = c0 - c1 + c2 - c3 + c4
+	  v2   = (a0 + 2a1 + 4a2) * (b0 + 2b1 + 4b2)   = c0 + 2c1 + 4c2 + 8c3 + 16c4
+	  vinf = a2 * b2                               = c4
+
+	The interpolation below is ordered so that every intermediate value except
+	vm1 is non-negative.
+	*/
+	size_t part = (n + 2) / 3;
+	size_t top  = n - 2 * part; // Length of a2 and b2
+
+	const limb_t* a0 = ap;
+	const limb_t* a1 = ap + part;
+	const limb_t* a2 = ap + 2 * part;
+	const limb_t* b0 = bp;
+	const limb_t* b1 = bp + part;
+	const limb_t* b2 = bp + 2 * part;
+
+	// Evaluated operands have part + 1 limbs, their products 2 * part + 2. All
+	// of them get their own space, so that the five products are independent.
+	size_t eval_length    = part + 1;
+	size_t product_length = 2 * part + 2;
+
+	limb_t* a_at_1       = scratch;
+	limb_t* b_at_1       = a_at_1 + eval_length;
+	limb_t* a_at_m1      = b_at_1 + eval_length;
+	limb_t* b_at_m1      = a_at_m1 + eval_length;
+	limb_t* a_at_2       = b_at_m1 + eval_length;
+	limb_t* b_at_2       = a_at_2 + eval_length;
+	limb_t* v1           = b_at_2 + eval_length;
+	limb_t* vm1          = v1 + product_length;
+	limb_t* v2           = vm1 + product_length;
+	limb_t* next_scratch = v2 + product_length;
+
+	// a0 + a2, then |a0 + a2 - a1| for vm1 and a0 + a2 + a1 for v1
+	a_at_1[part] = limbs_add(a_at_1, a0, part, a2, top);
+	b_at_1[part] = limbs_add(b_at_1, b0, part, b2, top);
+
+	bool vm1_negative = abs_diff(a_at_m1, a_at_1, eval_length, a1, part);
+	vm1_negative ^= abs_diff(b_at_m1, b_at_1, eval_length, b1, part);
+
+	a_at_1[part] += limbs_add_n(a_at_1, a_at_1, a1, part);
+	b_at_1[part] += limbs_add_n(b_at_1, b_at_1, b1, part);
+
+	// a0 + 2a1 + 4a2
+	toom3_eval_2(a_at_2, ap, part, top);
+	toom3_eval_2(b_at_2, bp, part, top);
+
+	// v0 and vinf go directly to their final place in rp
+	sub_product products[5] = {{vm1, a_at_m1, b_at_m1, eval_length},
+	                           {v1, a_at_1, b_at_1, eval_length},
+	                           {v2, a_at_2, b_at_2, eval_length},
+	                           {rp, a0, b0, part},
+	                           {rp + 4 * part, a2, b2, top}};
+	compute_sub_products(products, 5, n, next_scratch);
+	memset(rp + 2 * part, 0, 2 * part * sizeof(limb_t));
+
+	toom3_interpolate(rp, n, part, top, v1, vm1, vm1_negative, v2);
+}
+
+static void
+mul_n(limb_t* rp, const limb_t* ap, const limb_t* bp, size_t n, limb_t* scratch)
+{
+	// Multiply two numbers of n limbs each into 2n limbs at rp
+	if (n < KARATSUBA_THRESHOLD)
+	{
+		limbs_mul_basecase(rp, ap, n, bp, n);
+	}
+	else if (n < TOOM3_THRESHOLD)
+	{
+		mul_karatsuba(rp, ap, bp, n, scratch);
+	}
+	else
+	{
+		mul_toom3(rp, ap, bp, n, scratch);
+	}
+}
+
+/*
+ * Squaring algorithms
+ *
+ * These mirror the multiplication algorithms above, but use that the two
+ * operands are equal: the basecase computes each cross product a[i] * a[j]
+ * only once and doubles the sum, and the recursive algorithms only ever need
+ * squares of smaller numbers, which are never negative.
+ */
+
+static void
+sqr_basecase(limb_t* rp, const limb_t* ap, size_t n)
+{
+	// Schoolbook squaring, about n^2 / 2 limb products
+	if (n == 1)
+	{
+		dlimb_t square = (dlimb_t) ap[0] * ap[0];
+		rp[0]          = (limb_t) square;
+		rp[1]          = (limb_t)(square >> LIMB_BITS);
+		return;
+	}
+
+	// The sum of a[i] * a[j] * (2^LIMB_BITS)^(i + j) over all i < j. Row i starts at
+	// limb 2i + 1 and its carry goes to limb n + i.
+	rp[0]  = 0;
+	rp[n]  = limbs_mul_1(rp + 1, ap + 1, n - 1, ap[0]);
+	for (size_t i = 1; i + 1 < n; i++)
+	{
+		rp[n + i] = limbs_addmul_1(rp + 2 * i + 1, ap + i + 1, n - i - 1, ap[i]);
+	}
+	rp[2 * n - 1] = 0;
+
+	// Double the cross products and add the squares a[i]^2 on the diagonal
+	limbs_lshift(rp, rp, 2 * n, 1);
+	dlimb_t carry = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		dlimb_t square = (dlimb_t) ap[i] * ap[i];
+
+		carry += (dlimb_t) rp[2 * i] + (limb_t) square;
+		rp[2 * i] = (limb_t) carry;
+		carry >>= LIMB_BITS;
+
+		carry += (dlimb_t) rp[2 * i + 1] + (limb_t)(square >> LIMB_BITS);
+		rp[2 * i + 1] = (limb_t) carry;
+		carry >>= LIMB_BITS;
+	}
+}
+
+static size_t
+sqr_n_scratch(size_t n)
+{
+	// Same bound as mul_n_scratch, squaring never needs more
+	if (n < SQR_KARATSUBA_THRESHOLD)
+		return 0;
+	return 6 * n + 100;
+}
+
+static void
+sqr_karatsuba(limb_t* rp, const limb_t* ap, size_t n, limb_t* scratch)
+{
+	// a^2 = a1^2 * x^2 + (a0^2 + a1^2 - (a0 - a1)^2) * x + a0^2
+	size_t high = n / 2;
+	size_t low  = n - high;
+
+	const limb_t* a0 = ap;
+	const limb_t* a1 = ap + low;
+
+	limb_t* diff_square  = scratch;
+	limb_t* middle       = scratch + 2 * low;
+	limb_t* diff         = middle;
+	limb_t* next_scratch = scratch + 4 * low + 1;
+
+	abs_diff(diff, a0, low, a1, high);
+	sub_product products[3] = {{diff_square, diff, NULL, low},
+	                           {rp, a0, NULL, low},
+	                           {rp + 2 * low, a1, NULL, high}};
+	compute_sub_products(products, 3, n, next_scratch);
+
+	middle[2 * low] = limbs_add(middle, rp, 2 * low, rp + 2 * low, 2 * high);
+	limbs_sub(middle, middle, 2 * low + 1, diff_square, 2 * low);
+
+	size_t rest_length   = 2 * n - low;
+	size_t middle_length = 2 * low + 1 < rest_length ? 2 * low + 1 : rest_length;
+	limbs_add(rp + low, rp + low, rest_length, middle, middle_length);
+}
+
+static void
+sqr_toom3(limb_t* rp, const limb_t* ap, size_t n, limb_t* scratch)
+{
+	// Same evaluation points as mul_toom3, with five squarings
+	size_t part = (n + 2) / 3;
+	size_t top  = n - 2 * part;
+
+	const limb_t* a0 = ap;
+	const limb_t* a1 = ap + part;
+	const limb_t* a2 = ap + 2 * part;
+
+	size_t eval_length    = part + 1;
+	size_t product_length = 2 * part + 2;
+
+	limb_t* a_at_1       = scratch;
+	limb_t* a_at_m1      = a_at_1 + eval_length;
+	limb_t* a_at_2       = a_at_m1 + eval_length;
+	limb_t* v1           = a_at_2 + eval_length;
+	limb_t* vm1          = v1 + product_length;
+	limb_t* v2           = vm1 + product_length;
+	limb_t* next_scratch = v2 + product_length;
+
+	a_at_1[part] = limbs_add(a_at_1, a0, part, a2, top);
+	abs_diff(a_at_m1, a_at_1, eval_length, a1, part);
+	a_at_1[part] += limbs_add_n(a_at_1, a_at_1, a1, part);
+	toom3_eval_2(a_at_2, ap, part, top);
+
+	sub_product products[5] = {{vm1, a_at_m1, NULL, eval_length},
+	                           {v1, a_at_1, NULL, eval_length},
+	                           {v2, a_at_2, NULL, eval_length},
+	                           {rp, a0, NULL, part},
+	                           {rp + 4 * part, a2, NULL, top}};
+	compute_sub_products(products, 5, n, next_scratch);
+	memset(rp + 2 * part, 0, 2 * part * sizeof(limb_t));
+
+	toom3_interpolate(rp, n, part, top, v1, vm1, false, v2);
+}
+
+static void
+sqr_n(limb_t* rp, const limb_t* ap, size_t n, limb_t* scratch)
+{
+	// Square a number of n limbs into 2n limbs at rp
+	if (n < SQR_KARATSUBA_THRESHOLD)
+	{
+		sqr_basecase(rp, ap, n);
+	}
+	else if (n < SQR_TOOM3_THRESHOLD)
+	{
+		sqr_karatsuba(rp, ap, n, scratch);
+	}
+	else
+	{
+		sqr_toom3(rp, ap, n, scratch);
+	}
+}
+
+void
+limbs_sqr(limb_t* rp, const limb_t* ap, size_t n)
+{
+	if (n < SQR_KARATSUBA_THRESHOLD)
+	{
+		sqr_basecase(rp, ap, n);
+		return;
+	}
+	else if (n >= SQR_NTT_THRESHOLD)
+	{
+		limbs_sqr_ntt(rp, ap, n);
+		return;
+	}
+
+	limb_t* scratch = arbint_allocate(sqr_n_scratch(n) * sizeof(limb_t));
+	if (scratch == NULL)
+	{
+		fprintf(stderr, "limbs_sqr: malloc failed\n");
+		exit(ENOMEM);
+	}
+	sqr_n(rp, ap, n, scratch);
+	arbint_deallocate(scratch, sqr_n_scratch(n) * sizeof(limb_t));
+}
+
+typedef struct
+{
+	limb_t* rp;
+	limb_t* odd;
+	const limb_t* ap;
+	size_t an;
+	const limb_t* bp;
+	size_t bn;
+} piece_products;
+
+static void
+multiply_pieces(void* argument, size_t begin, size_t end)
+{
+	// Multiply b by the pieces begin .. end - 1 of a, which are bn limbs long
+	// except for the last one. The products of the even pieces go to rp, and
+	// those of the odd ones to `odd`, which starts bn limbs further up, so that
+	// they don't overlap.
+	piece_products* job = argument;
+	size_t bn           = job->bn;
+	size_t size         = mul_n_scratch(bn);
+	limb_t* scratch     = arbint_allocate(size * sizeof(limb_t));
+	if (scratch == NULL && size > 0)
+	{
+		fprintf(stderr, "limbs_mul: malloc failed\n");
+		exit(ENOMEM);
+	}
+
+	for (size_t i = begin; i < end; i++)
+	{
+		size_t offset       = i * bn;
+		size_t piece_length = job->an - offset < bn ? job->an - offset : bn;
+		limb_t* rp          = i % 2 ? job->odd + offset - bn : job->rp + offset;
+		if (piece_length == bn)
+			mul_n(rp, job->ap + offset, job->bp, bn, scratch);
+		else
+			limbs_mul(rp, job->bp, bn, job->ap + offset, piece_length);
+	}
+	arbint_deallocate(scratch, size * sizeof(limb_t));
+}
+
+static void
+mul_pieces_threaded(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	// Like the loop over the pieces of a in limbs_mul, with the products of the
+	// pieces computed in parallel and added up at the end. Requires an >= 2bn.
+	size_t count = (an + bn - 1) / bn;
+	limb_t* odd  = arbint_allocate(an * sizeof(limb_t));
+	if (odd == NULL)
+	{
+		fprintf(stderr, "limbs_mul: malloc failed\n");
+		exit(ENOMEM);
+	}
+	piece_products job = {rp, odd, ap, an, bp, bn};
+	size_t grain       = arbint_get_thread_threshold() / bn;
+	thread_pool_for(count, grain ? grain : 1, multiply_pieces, &job);
+
+	// The products of each kind end where the last piece of that kind does.
+	// The second to last piece is always a full one.
+	size_t even_end = count % 2 ? an + bn : count * bn;
+	size_t odd_end  = count % 2 ? count * bn : an + bn;
+	memset(rp + even_end, 0, (an + bn - even_end) * sizeof(limb_t));
+	limbs_add(rp + bn, rp + bn, an, odd, odd_end - bn);
+	arbint_deallocate(odd, an * sizeof(limb_t));
+}
+
+void
+limbs_mul(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	if (bn < KARATSUBA_THRESHOLD)
+	{
+		limbs_mul_basecase(rp, ap, an, bp, bn);
+		return;
+	}
+	else if (bn >= NTT_THRESHOLD)
+	{
+		limbs_mul_ntt(rp, ap, an, bp, bn);
+		return;
+	}
+	else if (an >= 2 * bn && thread_pool_active(an))
+	{
+		mul_pieces_threaded(rp, ap, an, bp, bn);
+		return;
+	}
+
+	// The balanced algorithms need operands of equal length. If a is longer,
+	// multiply b by pieces of a that are as long as b and add the results up.
+	size_t product_length = an == bn ? 0 : 2 * bn;
+	size_t scratch_size   = (product_length + mul_n_scratch(bn)) * sizeof(limb_t);
+	limb_t* scratch       = arbint_allocate(scratch_size);
+	if (scratch == NULL)
+	{
+		fprintf(stderr, "limbs_mul: malloc failed\n");
+		exit(ENOMEM);
+	}
+	limb_t* piece_product = scratch;
+	limb_t* mul_scratch   = scratch + product_length;
+
+	mul_n(rp, ap, bp, bn, mul_scratch);
+
+	for (size_t offset = bn; offset < an; offset += bn)
+	{
+		size_t piece_length = an - offset < bn ? an - offset : bn;
+		if (piece_length == bn)
+			mul_n(piece_product, ap + offset, bp, bn, mul_scratch);
+		else
+			limbs_mul(piece_product, bp, bn, ap + offset, piece_length);
+
+		// The lower bn limbs overlap with the previous product
+		memcpy(rp + offset + bn, piece_product + bn, piece_length * sizeof(limb_t));
+		limbs_add(rp + offset, rp + offset, bn + piece_length, piece_product, bn);
+	}
+
+	arbint_deallocate(scratch, scratch_size);
+}
@@ -0,0 +1,623 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocation.h"
+#include "limbs.h"
+#include "thread-pool.h"
+
+#include "ntt.h"
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+/*
+ * Arithmetic modulo a prime p < 2^61, using Montgomery multiplication with
+ * R = 2^64. Values in the transforms are kept in Montgomery form (x * R mod p)
+ * so that every multiplication only needs two 64x64 bit products and no
+ * division.
+ */
+typedef struct
+{
+	uint64_t p;    // The prime, k * 2^e + 1
+	uint64_t pinv; // p^-1 mod 2^64
+	uint64_t r2;   // R^2 mod p, to convert into Montgomery form
+	uint64_t one;  // R mod p, i.e. 1 in Montgomery form
+	uint64_t root; // Generator of the multiplicative group mod p
+} ntt_prime;
+
+// The three primes, with 2^50, 2^49 and 2^48 dividing p - 1
+static const uint64_t primes[3] = {0x1E6C000000000001, 0x1FEA000000000001,
+                                   0x1FED000000000001};
+static const uint64_t generators[3] = {13, 3, 3};
+
+// Each 64-bit coefficient holds this many limbs
+#define LIMBS_PER_WORD (64 / LIMB_BITS)
+
+// With threads, the transforms are split into about this many blocks per
+// thread, so that the ones that are done early can take over blocks of others
+#define BLOCKS_PER_THREAD 4
+
+static uint64_t
+mont_reduce(uint128_t t, const ntt_prime* prime)
+{
+	// Returns t * R^-1 mod p, for t < p * R
+	uint64_t m    = (uint64_t) t * prime->pinv;
+	uint64_t high = (uint64_t)(t >> 64);
+	uint64_t mp   = (uint64_t)(((uint128_t) m * prime->p) >> 64);
+
+	// The low halves of t and m * p are equal, so only the high halves remain
+	return high >= mp ? high - mp : high - mp + prime->p;
+}
+
+static uint64_t
+mont_mul(uint64_t a, uint64_t b, const ntt_prime* prime)
+{
+	return mont_reduce((uint128_t) a * b, prime);
+}
+
+static uint64_t
+add_mod(uint64_t a, uint64_t b, uint64_t p)
+{
+	uint64_t sum = a + b;
+	return sum >= p ? sum - p : sum;
+}
+
+static uint64_t
+sub_mod(uint64_t a, uint64_t b, uint64_t p)
+{
+	return a >= b ? a - b : a - b + p;
+}
+
+static uint64_t
+pow_mod(uint64_t base, uint64_t exponent, const ntt_prime* prime)
+{
+	// base and the result are in Montgomery form
+	uint64_t result = prime->one;
+	while (exponent)
+	{
+		if (exponent & 1)
+			result = mont_mul(result, base, prime);
+		base = mont_mul(base, base, prime);
+		exponent >>= 1;
+	}
+	return result;
+}
+
+static void
+ntt_prime_init(ntt_prime* prime, uint64_t p, uint64_t root)
+{
+	prime->p = p;
+
+	// Newton iteration for p^-1 mod 2^64, each step doubles the correct bits
+	uint64_t inverse = p; // Correct to 3 bits because p is odd
+	for (int i = 0; i < 5; i++)
+	{
+		inverse *= 2 - p * inverse;
+	}
+	prime->pinv = inverse;
+
+	uint128_t r = ((uint128_t) 1 << 64) % p;
+	prime->one  = (uint64_t) r;
+	prime->r2   = (uint64_t)((r * r) % p);
+	prime->root = mont_mul(root, prime->r2, prime);
+}
+
+static uint64_t*
+alloc_words(size_t count)
+{
+	uint64_t* words = arbint_allocate(count * sizeof(uint64_t));
+	if (words == NULL)
+	{
+		fprintf(stderr, "limbs_mul_ntt: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return words;
+}
+
+static void
+free_words(uint64_t* words, size_t count)
+{
+	arbint_deallocate(words, count * sizeof(uint64_t));
+}
+
+/*
+ * The transforms
+ *
+ * The forward transform uses decimation in frequency, which takes its input in
+ * natural order and leaves the result in bit-reversed order. The inverse
+ * transform uses decimation in time, which takes bit-reversed input and
+ * produces natural order. The pointwise product in between doesn't care
+ * about the order, so no bit reversal permutation is ever needed.
+ *
+ * Both use the same table of twiddle factors w^0 .. w^(n/2 - 1), where w is a
+ * primitive n-th root of unity. The inverse powers come from the identity
+ * w^-j = -w^(n/2 - j).
+ *
+ * After the first stage of the forward transform, and before the last stage
+ * of the inverse one, the two halves of the array are transforms of half the
+ * length of their own, which use every second twiddle factor. With threads,
+ * the halves are transformed in parallel, and so are the butterflies of the
+ * stage over the whole array.
+ */
+
+typedef struct
+{
+	const ntt_prime* prime;
+	const uint64_t* twiddles;
+	size_t n;     // Length of the whole transform
+	size_t grain; // Shorter blocks and loops stay on one thread
+} ntt_context;
+
+typedef struct
+{
+	uint64_t* a;
+	size_t length;
+	size_t stride; // The block uses every stride-th twiddle factor
+	const ntt_context* context;
+} ntt_block;
+
+static void
+ntt_forward(uint64_t* a, size_t n, size_t stride, const uint64_t* twiddles,
+            const ntt_prime* prime)
+{
+	// Transform a block of n coefficients of a transform of length n * stride
+	uint64_t p = prime->p;
+	for (size_t len = n / 2; len >= 1; len /= 2, stride *= 2)
+	{
+		for (size_t i = 0; i < n; i += 2 * len)
+		{
+			for (size_t j = 0; j < len; j++)
+			{
+				uint64_t u = a[i + j];
+				uint64_t v = a[i + j + len];
+
+				a[i + j]       = add_mod(u, v, p);
+				a[i + j + len] = mont_mul(sub_mod(u, v, p), twiddles[j * stride], prime);
+			}
+		}
+	}
+}
+
+static void
+ntt_inverse(uint64_t* a, size_t n, size_t stride, const uint64_t* twiddles,
+            const ntt_prime* prime)
+{
+	uint64_t p  = prime->p;
+	size_t half = n * stride / 2;
+	for (size_t len = 1, s = n / 2 * stride; len < n; len *= 2, s /= 2)
+	{
+		for (size_t i = 0; i < n; i += 2 * len)
+		{
+			// w^0 = 1
+			uint64_t u = a[i];
+			uint64_t v = a[i + len];
+			a[i]       = add_mod(u, v, p);
+			a[i + len] = sub_mod(u, v, p);
+
+			for (size_t j = 1; j < len; j++)
+			{
+				// v = -(a[i + j + len] * w^-(j * s))
+				u = a[i + j];
+				v = mont_mul(a[i + j + len], twiddles[half - j * s], prime);
+
+				a[i + j]       = sub_mod(u, v, p);
+				a[i + j + len] = add_mod(u, v, p);
+			}
+		}
+	}
+}
+
+static void
+forward_butterflies(void* argument, size_t begin, size_t end)
+{
+	// The butterflies begin .. end - 1 of the first stage of a block
+	ntt_block* block         = argument;
+	const ntt_prime* prime   = block->context->prime;
+	const uint64_t* twiddles = block->context->twiddles;
+	uint64_t* a              = block->a;
+	uint64_t p               = prime->p;
+	size_t len               = block->length / 2;
+	size_t stride            = block->stride;
+	for (size_t j = begin; j < end; j++)
+	{
+		uint64_t u = a[j];
+		uint64_t v = a[j + len];
+
+		a[j]       = add_mod(u, v, p);
+		a[j + len] = mont_mul(sub_mod(u, v, p), twiddles[j * stride], prime);
+	}
+}
+
+static void
+inverse_butterflies(void* argument, size_t begin, size_t end)
+{
+	// The butterflies begin .. end - 1 of the last stage of a block
+	ntt_block* block         = argument;
+	const ntt_prime* prime   = block->context->prime;
+	const uint64_t* twiddles = block->context->twiddles;
+	uint64_t* a              = block->a;
+	uint64_t p               = prime->p;
+	size_t len               = block->length / 2;
+	size_t stride            = block->stride;
+	size_t half              = block->context->n / 2;
+	for (size_t j = begin; j < end; j++)
+	{
+		uint64_t u = a[j];
+		uint64_t v = a[j + len];
+		if (j == 0)
+		{
+			a[j]       = add_mod(u, v, p);
+			a[j + len] = sub_mod(u, v, p);
+			continue;
+		}
+
+		v          = mont_mul(v, twiddles[half - j * stride], prime);
+		a[j]       = sub_mod(u, v, p);
+		a[j + len] = add_mod(u, v, p);
+	}
+}
+
+static void
+ntt_forward_threaded(void* argument)
+{
+	ntt_block* block           = argument;
+	const ntt_context* context = block->context;
+	if (block->length <= context->grain)
+	{
+		ntt_forward(block->a, block->length, block->stride, context->twiddles,
+		            context->prime);
+		return;
+	}
+
+	size_t half = block->length / 2;
+	thread_pool_for(half, context->grain, forward_butterflies, block);
+
+	ntt_block low  = {block->a, half, 2 * block->stride, context};
+	ntt_block high = {block->a + half, half, 2 * block->stride, context};
+	thread_pool_task task;
+	thread_pool_spawn(&task, ntt_forward_threaded, &high);
+	ntt_forward_threaded(&low);
+	thread_pool_join(&task);
+}
+
+static void
+ntt_inverse_threaded(void* argument)
+{
+	ntt_block* block           = argument;
+	const ntt_context* context = block->context;
+	if (block->length <= context->grain)
+	{
+		ntt_inverse(block->a, block->length, block->stride, context->twiddles,
+		            context->prime);
+		return;
+	}
+
+	size_t half    = block->length / 2;
+	ntt_block low  = {block->a, half, 2 * block->stride, context};
+	ntt_block high = {block->a + half, half, 2 * block->stride, context};
+	thread_pool_task task;
+	thread_pool_spawn(&task, ntt_inverse_threaded, &high);
+	ntt_inverse_threaded(&low);
+	thread_pool_join(&task);
+
+	thread_pool_for(half, context->grain, inverse_butterflies, block);
+}
+
+/*
+ * The loops over all coefficients, in pieces for thread_pool_for
+ */
+
+typedef struct
+{
+	uint64_t* twiddles;
+	uint64_t w;
+	const ntt_prime* prime;
+} twiddle_job;
+
+typedef struct
+{
+	uint64_t* coefficients;
+	const limb_t* limbs;
+	size_t length;
+	const ntt_prime* prime;
+} load_job;
+
+typedef struct
+{
+	uint64_t* a;
+	const uint64_t* b; // NULL to multiply by `factor` instead
+	uint64_t factor;
+	const ntt_prime* prime;
+} pointwise_job;
+
+static void
+compute_twiddles(void* argument, size_t begin, size_t end)
+{
+	// twiddles[i] = w^i, starting from a power instead of the one before it
+	twiddle_job* job = argument;
+	uint64_t power   = pow_mod(job->w, begin, job->prime);
+	for (size_t i = begin; i < end; i++)
+	{
+		job->twiddles[i] = power;
+		power            = mont_mul(power, job->w, job->prime);
+	}
+}
+
+static void
+load_coefficients(void* argument, size_t begin, size_t end)
+{
+	// Cut the limbs into 64-bit coefficients in Montgomery form, zero-padded to
+	// the transform length
+	load_job* job = argument;
+	size_t length = job->length;
+	for (size_t i = begin; i < end; i++)
+	{
+		uint64_t c = 0;
+		for (size_t k = 0; k < LIMBS_PER_WORD && LIMBS_PER_WORD * i + k < length; k++)
+		{
+			c |= (uint64_t) job->limbs[LIMBS_PER_WORD * i + k] << (k * LIMB_BITS);
+		}
+		job->coefficients[i] = mont_mul(c, job->prime->r2, job->prime);
+	}
+}
+
+static void
+multiply_pointwise(void* argument, size_t begin, size_t end)
+{
+	pointwise_job* job = argument;
+	for (size_t i = begin; i < end; i++)
+	{
+		uint64_t factor = job->b ? job->b[i] : job->factor;
+		job->a[i]       = mont_mul(job->a[i], factor, job->prime);
+	}
+}
+
+typedef struct
+{
+	const limb_t* ap;
+	size_t an;
+	const limb_t* bp; // NULL to square a
+	size_t bn;
+	size_t n;
+	size_t grain;
+	ntt_prime prime;
+	uint64_t* residues;
+} convolution;
+
+static void
+convolve_mod_prime(void* argument)
+{
+	// Computes the n coefficients of the cyclic convolution of a and b mod p,
+	// in natural order and not in Montgomery form
+	convolution* job       = argument;
+	const ntt_prime* prime = &job->prime;
+	size_t n               = job->n;
+	uint64_t* twiddles     = alloc_words(n / 2);
+	twiddle_job powers     = {twiddles, pow_mod(prime->root, (prime->p - 1) / n, prime),
+	                          prime};
+	thread_pool_for(n / 2, job->grain, compute_twiddles, &powers);
+	ntt_context context = {prime, twiddles, n, job->grain};
+
+	uint64_t* a_coefficients = alloc_words(n);
+	load_job a_load          = {a_coefficients, job->ap, job->an, prime};
+	ntt_block a_block        = {a_coefficients, n, 1, &context};
+	thread_pool_for(n, job->grain, load_coefficients, &a_load);
+	ntt_forward_threaded(&a_block);
+
+	uint64_t* b_coefficients = NULL;
+	pointwise_job product    = {a_coefficients, a_coefficients, 0, prime};
+	if (job->bp != NULL)
+	{
+		b_coefficients    = alloc_words(n);
+		load_job b_load   = {b_coefficients, job->bp, job->bn, prime};
+		ntt_block b_block = {b_coefficients, n, 1, &context};
+		thread_pool_for(n, job->grain, load_coefficients, &b_load);
+		ntt_forward_threaded(&b_block);
+		product.b = b_coefficients;
+	}
+	thread_pool_for(n, job->grain, multiply_pointwise, &product);
+	ntt_inverse_threaded(&a_block);
+
+	// Divide by n and leave Montgomery form at the same time
+	uint64_t n_inverse  = pow_mod(mont_mul(n, prime->r2, prime), prime->p - 2, prime);
+	pointwise_job scale = {a_coefficients, NULL, mont_reduce(n_inverse, prime), prime};
+	thread_pool_for(n, job->grain, multiply_pointwise, &scale);
+
+	if (b_coefficients != NULL)
+		free_words(b_coefficients, n);
+	free_words(twiddles, n / 2);
+	job->residues = a_coefficients;
+}
+
+/*
+ * Garner's algorithm: with r0, r1, r2 the residues of a coefficient x,
+ *
+ *   x = r0 + p0 * t1 + p0 * p1 * t2
+ *
+ * where t1 = (r1 - r0) / p0 mod p1 and t2 = (r2 - (r0 + p0 * t1)) / (p0 * p1)
+ * mod p2. The constants are multiplied by R here, so that a Montgomery
+ * multiplication with a plain value gives a plain result.
+ *
+ * The coefficients are added up in chunks of 64-bit words, each with its own
+ * carry starting at 0. The carry out of every chunk is added to the next one
+ * at the end, which rarely goes further than a few limbs.
+ */
+
+typedef struct
+{
+	const convolution* convolutions;
+	uint64_t p0;
+	uint128_t p0p1;
+	uint64_t inv_p0_p1;
+	uint64_t p0_mod_p2;
+	uint64_t inv_p0p1_p2;
+	size_t coefficient_count;
+	limb_t* rp;
+	size_t rn;
+	size_t chunk;      // Words per chunk
+	uint64_t* carries; // Two words per chunk
+} garner_job;
+
+static void
+recombine(void* argument, size_t begin, size_t end)
+{
+	// Recombine the words of the chunks begin .. end - 1 into rp
+	garner_job* job     = argument;
+	const ntt_prime* p1 = &job->convolutions[1].prime;
+	const ntt_prime* p2 = &job->convolutions[2].prime;
+	uint64_t p0         = job->p0;
+	size_t rn           = job->rn;
+	size_t words        = (rn + LIMBS_PER_WORD - 1) / LIMBS_PER_WORD;
+
+	for (size_t chunk = begin; chunk < end; chunk++)
+	{
+		// Running carry into the next coefficient, 128 bits
+		uint64_t carry_low  = 0;
+		uint64_t carry_high = 0;
+		size_t chunk_end    = (chunk + 1) * job->chunk;
+		for (size_t i = chunk * job->chunk; i < chunk_end && i < words; i++)
+		{
+			uint64_t t1 = 0;
+			uint64_t t2 = 0;
+			uint64_t r0 = 0;
+			if (i < job->coefficient_count)
+			{
+				r0          = job->convolutions[0].residues[i];
+				uint64_t r1 = job->convolutions[1].residues[i];
+				uint64_t r2 = job->convolutions[2].residues[i];
+
+				// p0 < p1 < p2, so r0 is already reduced mod p1 and p2
+				t1           = mont_mul(sub_mod(r1, r0, p1->p), job->inv_p0_p1, p1);
+				uint64_t x_2 = add_mod(mont_mul(t1, job->p0_mod_p2, p2), r0, p2->p);
+				t2           = mont_mul(sub_mod(r2, x_2, p2->p), job->inv_p0p1_p2, p2);
+			}
+
+			// The coefficient is r0 + p0 * t1 + p0 * p1 * t2 < p0 * p1 * p2, which
+			// lies between 2^182 and 2^183 (see ntt.h for why it doesn't wrap).
+			// Add the carry from the previous coefficient and emit the low 64 bits.
+			uint128_t x    = (uint128_t) p0 * t1 + r0;
+			uint128_t low  = (uint128_t)(uint64_t) job->p0p1 * t2;
+			uint128_t high = (uint128_t)(uint64_t)(job->p0p1 >> 64) * t2;
+
+			uint128_t sum = (uint128_t)(uint64_t) low + (uint64_t) x + carry_low;
+			uint64_t word = (uint64_t) sum;
+
+			uint128_t upper = high + (low >> 64) + (x >> 64) + carry_high + (sum >> 64);
+			carry_low       = (uint64_t) upper;
+			carry_high      = (uint64_t)(upper >> 64);
+
+			for (size_t k = 0; k < LIMBS_PER_WORD && LIMBS_PER_WORD * i + k < rn; k++)
+			{
+				job->rp[LIMBS_PER_WORD * i + k] = (limb_t)(word >> (k * LIMB_BITS));
+			}
+		}
+		job->carries[2 * chunk]     = carry_low;
+		job->carries[2 * chunk + 1] = carry_high;
+	}
+}
+
+static void
+ntt_multiply(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	// Shared by limbs_mul_ntt and limbs_sqr_ntt, which passes bp = NULL
+	// The product has at most this many nonzero 64-bit coefficients
+	size_t a_words           = (an + LIMBS_PER_WORD - 1) / LIMBS_PER_WORD;
+	size_t b_words           = (bn + LIMBS_PER_WORD - 1) / LIMBS_PER_WORD;
+	size_t coefficient_count = a_words + b_words - 1;
+	size_t n                 = 2;
+	while (n < coefficient_count)
+	{
+		n *= 2;
+	}
+
+	// Without threads, every loop and transform runs in one piece. With them,
+	// the pieces are at least as long as the threshold, but there are only a
+	// few per thread.
+	bool threaded = thread_pool_active(an);
+	size_t grain  = SIZE_MAX;
+	if (threaded)
+	{
+		size_t per_thread = n / (BLOCKS_PER_THREAD * arbint_get_threads());
+		grain             = arbint_get_thread_threshold() / LIMBS_PER_WORD;
+		grain             = grain > per_thread ? grain : per_thread;
+		grain             = grain ? grain : 1;
+	}
+
+	// The convolutions for the three primes are independent of each other
+	convolution convolutions[3];
+	for (int i = 0; i < 3; i++)
+	{
+		convolution job = {ap, an, bp, bn, n, grain, {0, 0, 0, 0, 0}, NULL};
+		ntt_prime_init(&job.prime, primes[i], generators[i]);
+		convolutions[i] = job;
+	}
+	thread_pool_task tasks[2];
+	for (int i = 0; i < 2 && threaded; i++)
+	{
+		thread_pool_spawn(&tasks[i], convolve_mod_prime, &convolutions[i]);
+	}
+	for (int i = threaded ? 2 : 0; i < 3; i++)
+	{
+		convolve_mod_prime(&convolutions[i]);
+	}
+	for (int i = 0; i < 2 && threaded; i++)
+	{
+		thread_pool_join(&tasks[i]);
+	}
+
+	const ntt_prime* p1 = &convolutions[1].prime;
+	const ntt_prime* p2 = &convolutions[2].prime;
+	uint64_t p0         = convolutions[0].prime.p;
+	uint128_t p0p1      = (uint128_t) p0 * p1->p;
+
+	uint64_t p0_mod_p1   = mont_mul(p0 % p1->p, p1->r2, p1);
+	uint64_t inv_p0_p1   = pow_mod(p0_mod_p1, p1->p - 2, p1);
+	uint64_t p0_mod_p2   = mont_mul(p0 % p2->p, p2->r2, p2);
+	uint64_t p0p1_mod_p2 = mont_mul((uint64_t)(p0p1 % p2->p), p2->r2, p2);
+	uint64_t inv_p0p1_p2 = pow_mod(p0p1_mod_p2, p2->p - 2, p2);
+
+	size_t rn          = an + bn;
+	size_t words       = (rn + LIMBS_PER_WORD - 1) / LIMBS_PER_WORD;
+	size_t chunk       = threaded ? grain : words;
+	size_t chunk_count = (words + chunk - 1) / chunk;
+	uint64_t* carries  = alloc_words(2 * chunk_count);
+
+	garner_job job = {convolutions, p0, p0p1, inv_p0_p1, p0_mod_p2, inv_p0p1_p2,
+	                  coefficient_count, rp, rn, chunk, carries};
+	thread_pool_for(chunk_count, 1, recombine, &job);
+
+	// The carry out of the last chunk is 0, and the one out of every other
+	// chunk fits into the rest of rp
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		limb_t carry[128 / LIMB_BITS];
+		uint128_t value = (uint128_t) carries[2 * i - 1] << 64 | carries[2 * i - 2];
+		for (size_t k = 0; k < 128 / LIMB_BITS; k++)
+		{
+			carry[k] = (limb_t)(value >> (k * LIMB_BITS));
+		}
+		size_t start  = LIMBS_PER_WORD * i * chunk;
+		size_t length = rn - start < 128 / LIMB_BITS ? rn - start : 128 / LIMB_BITS;
+		limbs_add(rp + start, rp + start, rn - start, carry, length);
+	}
+
+	free_words(carries, 2 * chunk_count);
+	for (int i = 0; i < 3; i++)
+	{
+		free_words(convolutions[i].residues, n);
+	}
+}
+
+void
+limbs_mul_ntt(limb_t* rp, const limb_t* ap, size_t an, const limb_t* bp, size_t bn)
+{
+	ntt_multiply(rp, ap, an, bp, bn);
+}
+
+void
+limbs_sqr_ntt(limb_t* rp, const limb_t* ap, size_t n)
+{
+	ntt_multiply(rp, ap, n, NULL, n);
+}
@@ -1,29 +1,27 @@
-#include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "arbint.h"
 #include "datatypes.h"
 #include "debug.h"
 #include "helper-functions.h"
+#include "limbs.h"
 
 #include "operators.h"
 
 // Forward declarations for internal functions
 static int arbint_cmp_with_sign(arbint a, arbint b, sign a_sign, sign b_sign);
-static arbint arbint_sub_with_sign(arbint a, arbint b, sign a_sign, sign b_sign);
-void add_to_arbint(arbint to_add, uint32_t value, size_t position);
+void add_to_arbint(arbint to_add, limb_t value, size_t position);
 
 void
-add_to_arbint(arbint to_add, uint32_t value, size_t position)
+add_to_arbint(arbint to_add, limb_t value, size_t position)
 {
-	// Add (value * (2^32) ^ position) to an arbint.
-	// This adds value to to_add->value[position], and if there's an overflow,
-	// it recursively adds the overflow to the more significant digit.
-	// If the overflow goes beyond the length of to_add, its value is reallocated
-	// to fit the new value.
+	// Add (value * (2^LIMB_BITS) ^ position) to an arbint.
+	// If position is beyond the length of to_add, or if the carry goes beyond
+	// it, it grows to fit the new value.
 
 	if (value == 0)
 	{
@@ -31,260 +29,208 @@ add_to_arbint(arbint to_add, uint32_t value, size_t position)
 		return;
 	}
 
-	// If we don't have enough space, reallocate
-	if (position >= to_add->length)
+	// If position is beyond the value, the digits up to it are 0
+	size_t length = to_add->length;
+	if (position >= length)
 	{
-		// Enough space so that position + the next digit will be in the array
-		size_t new_length   = position + 1;
-		uint32_t* new_value = realloc(to_add->value, new_length * sizeof(uint32_t));
-		if (new_value == NULL)
-		{
-			fprintf(stderr, "add_to_arbint: failed to realloc\n");
-			exit(ENOMEM);
-		}
-
-		// Set the newly allocated space to zero
-		// TODO use memset if faster
-		for (size_t i = to_add->length; i < new_length; i++)
-		{
-			new_value[i] = 0;
-		}
-
-		to_add->value  = new_value;
-		to_add->length = new_length;
+		arbint_reserve(to_add, position + 1);
+		memset(to_add->value + length, 0, (position + 1 - length) * sizeof(limb_t));
+		length         = position + 1;
+		to_add->length = length;
 	}
 
-	uint32_t carry = addition_will_wrap(to_add->value[position], value);
-
-	to_add->value[position] += value;
-
+	// The carry stops at the first digit that doesn't overflow:
+	//   0000 1111 1111 (imagine those 4-bit ints were limbs)
+	// + 0000 0000 0001
+	// = 0001 0000 0000
+	limb_t carry = limbs_add_1(to_add->value + position, to_add->value + position,
+	                           length - position, value);
 	if (carry)
 	{
-		// We have to do this recursively because when this is done:
-		//   0000 1111 1111 (imagine those 4-bit ints were 32 bit)
-		// + 0000 0000 0001
-		// = 0001 0000 0000
-		// then adding the carry to value[position+1] will itself cause an
-		// overflow, which has to be carried over another time
-		add_to_arbint(to_add, carry, position + 1);
+		// The capacity grows geometrically, so a number that keeps growing
+		// by carries isn't reallocated for every digit
+		arbint_reserve(to_add, length + 1);
+		to_add->value[length] = carry;
+		to_add->length        = length + 1;
 	}
 }
 
-arbint
-arbint_add_primitive(arbint a, arbint b)
+size_t
+arbint_add_size(arbint a, arbint b)
 {
-	// This ignores the signs and assumes that both are positive!
-	// The return value is always positive
-	if (a->length < b->length)
-	{
-		return arbint_add_primitive(b, a);
-	}
-
-	// If we copy the longer one and add the shorter one, adding will be faster
-	// and it's less likely that we have to reallocate while adding
-	arbint result = arbint_copy(a);
-	result->sign  = POSITIVE;
-
-	for (size_t i = 0; i < b->length; i++)
-	{
-		add_to_arbint(result, b->value[i], i);
-	}
-
-	return result;
+	// The sum of two numbers has at most one digit more than the longer one
+	size_t a_length = limbs_significant(a->value, a->length);
+	size_t b_length = limbs_significant(b->value, b->length);
+	return (a_length > b_length ? a_length : b_length) + 1;
 }
 
-/*
- * General addition procedure that takes into account the signs
- * and calls the actual addition/subtraction procedure based on that.
- */
-arbint
-arbint_add(arbint a, arbint b)
+size_t
+arbint_sub_size(arbint a, arbint b)
 {
-	bool a_is_zero = arbint_is_zero(a);
-	bool b_is_zero = arbint_is_zero(b);
-
-	if (a_is_zero && b_is_zero)
-		return arbint_new();
+	// a - b = a + (-b), so this needs as many digits as an addition
+	return arbint_add_size(a, b);
+}
 
-	if (a_is_zero)
-	{
-		return arbint_copy(b);
-	}
-	if (b_is_zero)
+void
+arbint_add_primitive_into(arbint result, arbint a, arbint b)
+{
+	// This ignores the signs and assumes that both are positive!
+	// The result is always positive. result may be a or b.
+	size_t a_length = limbs_significant(a->value, a->length);
+	size_t b_length = limbs_significant(b->value, b->length);
+	if (a_length < b_length)
 	{
-		return arbint_copy(a);
+		arbint_add_primitive_into(result, b, a);
+		return;
 	}
 
-	if (a->sign == POSITIVE)
+	// If result is a or b, resizing keeps the digits, so a->value and
+	// b->value are still valid afterwards. When result is a, the addition
+	// stops at the first digit above b that the carry doesn't reach.
+	arbint_reserve(result, a_length);
+	limb_t carry = limbs_add(result->value, a->value, a_length, b->value, b_length);
+	if (carry)
 	{
-		if (b->sign == POSITIVE)
-		{
-			// Both are positive -> we can just add
-			return arbint_add_primitive(a, b);
-		}
-		else // if (b->sign == NEGATIVE)
-		{
-			// This is a subtraction, let's return a - abs(b)
-			return arbint_sub_with_sign(a, b, POSITIVE, POSITIVE);
-		}
+		// Only a carry out of the top digit makes room for another one. The
+		// digits below it are kept when result moves, even if they are all 0.
+		result->length = a_length;
+		arbint_reserve(result, a_length + 1);
+		result->value[a_length] = carry;
+		result->length          = a_length + 1;
 	}
-	else // if (a->sign == NEGATIVE)
+	else
 	{
-		if (b->sign == POSITIVE)
-		{
-			// This is a subtraction, let's return b - abs(a)
-			return arbint_sub_with_sign(b, a, POSITIVE, POSITIVE);
-		}
-		else // if (b->sign == NEGATIVE)
-		{
-			// Both are negative! We can calculate abs(a) + abs(b) and then
-			// flip the sign
-			arbint result = arbint_add_primitive(a, b);
-			arbint_neg(result);
-			return result;
-		}
+		arbint_normalize(result, a_length);
 	}
+	result->sign = POSITIVE;
+}
+
+arbint
+arbint_add_primitive(arbint a, arbint b)
+{
+	arbint result = arbint_new_length(arbint_add_size(a, b));
+	arbint_add_primitive_into(result, a, b);
+	return result;
 }
 
 /*
- * Return the result of a - b.
- * This assumes that both a and b are positive (signs are ignored),
- * and that a >= b.
+ * a + b for numbers of at most one limb each, with the signs given separately
+ * like for arbint_add_with_sign_into. The sum is computed in a double limb and
+ * fits into the two limbs that every arbint has inside its struct, so small
+ * numbers are added without any loops or allocations.
  */
-static arbint
-arbint_sub_primitive(arbint a, arbint b)
+static void
+add_single_limbs(arbint result, limb_t a, sign a_sign, limb_t b, sign b_sign)
 {
-	arbint result = arbint_new_length(a->length);
-
-	uint32_t digit_result;
-	uint32_t borrow = 0;
-
-	for (size_t i = 0; i < a->length; i++)
+	dlimb_t magnitude = (dlimb_t) a + b;
+	sign result_sign  = a_sign;
+	if (a_sign != b_sign)
 	{
-		// Do the subtraction
-		digit_result = a->value[i] - b->value[i];
-
-		// Handle borrow from previous iteration
-		if (borrow)
-		{
-			digit_result -= borrow;
-			borrow = 0;
-		}
-
-		result->value[i] = digit_result;
-
-		// Detect wrapping
-		if (digit_result > a->value[i])
-		{
-			// Wrapped
-			// Keep the result anyway, but subtract one from
-			// the next higher digit (TODO check if correct)
-			borrow = 1;
-		}
+		magnitude   = a >= b ? a - b : b - a;
+		result_sign = a >= b ? a_sign : b_sign;
 	}
 
-	return result;
+	arbint_reserve(result, 2);
+	result->value[0] = (limb_t) magnitude;
+	result->value[1] = (limb_t)(magnitude >> LIMB_BITS);
+	result->sign     = result_sign;
+	arbint_normalize(result, 2);
 }
 
 /*
- * General subtraction procedure. Takes into account the signs and
- * calls the appropriate addition/subtraction procedures.
+ * Put a + b into result, with the signs of a and b given separately so that
+ * subtraction can be done by flipping the sign of b.
+ * Both a and b are read completely before the sign of result is set, so
+ * result may be a or b.
  */
-arbint
-arbint_sub_with_sign(arbint a, arbint b, sign a_sign, sign b_sign)
+static void
+arbint_add_with_sign_into(arbint result, arbint a, sign a_sign, arbint b, sign b_sign)
 {
-	if (a == b)
+	if (a->length == 1 && b->length == 1)
 	{
-		return arbint_new();
+		add_single_limbs(result, a->value[0], a_sign, b->value[0], b_sign);
+		return;
 	}
 
-	bool a_is_zero = arbint_is_zero(a);
-	bool b_is_zero = arbint_is_zero(b);
+	size_t a_length = limbs_significant(a->value, a->length);
+	size_t b_length = limbs_significant(b->value, b->length);
 
-	if (a_is_zero && b_is_zero)
+	if (a_sign == b_sign)
 	{
-		return arbint_new();
-	}
-	else if (a_is_zero)
-	{
-		// 0 - b = -b
-		arbint result = arbint_copy(b);
-		arbint_neg(result);
-		return result;
-	}
-	else if (b_is_zero)
-	{
-		// a - 0 = a
-		return arbint_copy(a);
+		// (+a) + (+b) = a + b and (-a) + (-b) = -(a + b)
+		arbint_add_primitive_into(result, a, b);
+		if (a_length || b_length)
+			result->sign = a_sign;
+		return;
 	}
 
-	int cmp = arbint_cmp_with_sign(a, b, a_sign, b_sign);
+	// The signs differ, so the smaller magnitude is subtracted from the larger
+	// one and the result gets the sign of the larger one
+	int cmp;
+	if (a_length != b_length)
+		cmp = a_length > b_length ? +1 : -1;
+	else
+		cmp = limbs_cmp(a->value, b->value, a_length);
 
 	if (cmp == 0)
 	{
-		return arbint_new();
+		// a + (-a) = 0
+		arbint_reserve(result, 1);
+		arbint_set_zero(result);
+		return;
 	}
 
-	if (a_sign == POSITIVE)
+	if (cmp < 0)
 	{
-		if (b_sign == POSITIVE)
-		{
-			// Both numbers are positive
-			if (cmp == +1)
-			{
-				// a > b, so the result is positive
-				return arbint_sub_primitive(a, b);
-			}
-			else // if (cmp == -1)
-			{
-				// a < b, so the result is negative
-				// a - b = c    | * -1
-				// b - a = -c   --> -c > 0
-				// So we need to calculate -(b - a) to get a - b
-				arbint result = arbint_sub_primitive(b, a);
-				result->sign  = NEGATIVE;
-				return result;
-			}
-		}
-		else // if (b_sign == NEGATIVE)
-		{
-			// a > 0, b < 0
-			// a - b = a + abs(b) if b < 0
-			return arbint_add_primitive(a, b);
-		}
-	}
-	else // if (a_sign == NEGATIVE)
-	{
-		if (b_sign == POSITIVE)
-		{
-			// a < 0, b > 0
-			// a - b = -(-a + b)
-			arbint result = arbint_add_primitive(a, b);
-			result->sign  = NEGATIVE;
-			return result;
-		}
-		else // if (b->sign == NEGATIVE)
-		{
-			// Both numbers are negative
-			if (cmp == +1)
-			{
-				// 0 > a > b
-				// -a - (-b) = c
-				// - (a - b) = c
-				// b - a = c
-				return arbint_sub_primitive(b, a);
-			}
-			else // if (cmp == -1)
-			{
-				// 0 > b > a
-				// -a - (-b) = c
-				// - (a - b) = c
-				arbint r = arbint_sub_primitive(a, b);
-				r->sign  = NEGATIVE;
-				return r;
-			}
-		}
+		arbint_add_with_sign_into(result, b, b_sign, a, a_sign);
+		return;
 	}
+
+	// abs(a) > abs(b), so a has at least as many digits as b and the
+	// difference fits in a_length digits
+	arbint_reserve(result, a_length);
+	limbs_sub(result->value, a->value, a_length, b->value, b_length);
+	result->sign = a_sign;
+	arbint_normalize(result, a_length);
+}
+
+void
+arbint_add_into(arbint result, arbint a, arbint b)
+{
+	arbint_add_with_sign_into(result, a, a->sign, b, b->sign);
+}
+
+void
+arbint_sub_into(arbint result, arbint a, arbint b)
+{
+	// a - b = a + (-b)
+	sign b_sign = b->sign == POSITIVE ? NEGATIVE : POSITIVE;
+	arbint_add_with_sign_into(result, a, a->sign, b, b_sign);
+}
+
+void
+arbint_add_inplace(arbint a, arbint b)
+{
+	arbint_add_with_sign_into(a, a, a->sign, b, b->sign);
+}
+
+void
+arbint_sub_inplace(arbint a, arbint b)
+{
+	sign b_sign = b->sign == POSITIVE ? NEGATIVE : POSITIVE;
+	arbint_add_with_sign_into(a, a, a->sign, b, b_sign);
+}
+
+/*
+ * General addition procedure that takes into account the signs.
+ * Returns the result in a newly allocated arbint.
+ */
+arbint
+arbint_add(arbint a, arbint b)
+{
+	arbint result = arbint_new_length(arbint_add_size(a, b));
+	arbint_add_into(result, a, b);
+	return result;
 }
 
 /*
@@ -293,7 +239,9 @@ arbint_sub_with_sign(arbint a, arbint b, sign a_sign, sign b_sign)
 arbint
 arbint_sub(arbint a, arbint b)
 {
-	return arbint_sub_with_sign(a, b, a->sign, b->sign);
+	arbint result = arbint_new_length(arbint_sub_size(a, b));
+	arbint_sub_into(result, a, b);
+	return result;
 }
 
 /*
@@ -315,20 +263,13 @@ arbint_eq_up_to_length(arbint a, arbint b, size_t length)
 }
 
 /*
- * Checks if an arbint is numerically equal to 0
+ * Checks if an arbint is numerically equal to 0, which only has to look at
+ * its first digit because it's normalized
  */
 bool
 arbint_is_zero(arbint a)
 {
-	size_t length = a->length;
-	for (size_t i = 0; i < length; i++)
-	{
-		if (a->value[i])
-		{
-			return false;
-		}
-	}
-	return true;
+	return a->length == 0 || (a->length == 1 && a->value[0] == 0);
 }
 
 /*
@@ -350,90 +291,33 @@ bool arbint_eq(arbint a, arbint b) {
 		return false;
 	}
 
-	// Do some easy checks first based on signs and equality to 0
-	// Right now we pass through all values twice (once now while checking
-	// for 0 and another time when checking against each other)
-	// TODO: find out if optimisation is worth it here
-	bool a_is_zero = arbint_is_zero(a);
-	bool b_is_zero = arbint_is_zero(b);
-
-	// If both are zero, they're equal
-	if (a_is_zero && b_is_zero)
+	// 0 is positive once normalized, but a hand-filled -0 still equals +0
+	if (arbint_is_zero(a) && arbint_is_zero(b))
 	{
 		return true;
 	}
-	// If one is zero and the other not, then they're definitely different
-	else if (a_is_zero != b_is_zero)
+
+	// Both are normalized, so equal nonzero numbers have the same sign, the
+	// same length and the same digits
+	if (a->sign != b->sign || a->length != b->length)
 	{
 		return false;
 	}
-	// If they're both nonzero, they are different if the signs are different
-	// Only if these signs are equal we need to compare the values
-	else if (!a_is_zero && !b_is_zero)
-	{
-		if (a->sign != b->sign)
-			return false;
-	}
-	// TODO find out if there's more we can say based on signs and zeroness
-
-	// If they have a different length
-	if (a->length != b->length)
-	{
-		// Find out which one is shorter and which one is longer
-		arbint shorter;
-		arbint longer;
-
-		if (a->length < b->length)
-		{
-			shorter = a;
-			longer  = b;
-		}
-		else
-		{
-			shorter = b;
-			longer  = a;
-		}
-
-		size_t shorter_length = shorter->length;
-		size_t longer_length  = longer->length;
-
-		assert(shorter_length < longer_length);
-
-		// See if we can already spot a difference in the 'digits' that
-		// are
-		// present in both numbers.
-		bool tmp_result = arbint_eq_up_to_length(shorter, longer, shorter_length);
-
-		if (!tmp_result)
-		{
-			// If yes, we know that the numbers are different from
-			// each other
-			return false;
-		}
-
-		// Otherwise, we need to check the 'digits' that are only present
-		// in the longer number. If they are just zeroes, the numbers are
-		// indeed equal, otherwise not (because the non-existent values in the
-		// shorter arbint are implicitly zero)
-		for (size_t i = shorter_length; i < longer_length; i++)
-		{
-			if (longer->value[i])
-			{
-				return false;
-			}
-		}
+	return arbint_eq_up_to_length(a, b, a->length);
+}
 
-		// At this point we've checked all digits and they either match,
-		// or
-		// are zero in one number and don't exist in the other one.
-		return true;
-	}
-	else
-	{
-		// If they have an equal length, we can just check each 'digit'.
-		assert(a->length == b->length);
-		return arbint_eq_up_to_length(a, b, a->length);
-	}
+static int
+cmp_single_limbs(limb_t a, sign a_sign, limb_t b, sign b_sign)
+{
+	// Compare a and b by their signs (-1, 0 or +1) first, and by their
+	// magnitudes if those are equal, reversed for negative numbers
+	int a_signum = a == 0 ? 0 : (a_sign == POSITIVE ? +1 : -1);
+	int b_signum = b == 0 ? 0 : (b_sign == POSITIVE ? +1 : -1);
+	if (a_signum != b_signum)
+		return a_signum > b_signum ? +1 : -1;
+	if (a == b)
+		return 0;
+	return (a > b) == (a_signum > 0) ? +1 : -1;
 }
 
 static int
@@ -446,95 +330,26 @@ arbint_cmp_with_sign(arbint a, arbint b, sign a_sign, sign b_sign)
 	if (a == b)
 		return 0; // If it's the exact same pointer
 
-	bool a_is_zero = arbint_is_zero(a);
-	bool b_is_zero = arbint_is_zero(b);
-
-	if (a_is_zero && b_is_zero)
-		return 0;
-
-	if (a_is_zero)
-	{
-		if (b_sign == POSITIVE)
-			return -1;
-		else
-			return +1;
-	}
-
-	if (b_is_zero)
-	{
-		if (b_sign == POSITIVE)
-			return +1;
-		else
-			return -1;
-	}
-
-	// At this point we can be sure that none of the two arbints are 0
-	// This means that if signs are different the numbers are too
-	if (a_sign != b_sign)
+	// Numbers of one limb are compared directly
+	if (a->length == 1 && b->length == 1)
 	{
-		if (a_sign == POSITIVE)
-			return +1;
-		else
-			return -1;
+		return cmp_single_limbs(a->value[0], a_sign, b->value[0], b_sign);
 	}
 
-	// Now the sign of the numbers is equal and they are both != 0.
-	// This means we need to actually check the value.
-	assert(a_sign == b_sign);
-	size_t a_highest_digit = arbint_highest_digit(a);
-	size_t b_highest_digit = arbint_highest_digit(b);
-
-	// Instead of immeiately returning, we set this value and goto finish.
-	// There we need to reverse the result if the values are negative, because
-	// we want to compare a to b, not abs(a) to abs(b).
-	int retval;
+	// Numbers with different signs (-1, 0 or +1) are ordered by them.
+	// Otherwise the magnitudes decide, reversed for negative numbers, and as
+	// both are normalized, the longer magnitude is the larger one.
+	int a_signum = arbint_is_zero(a) ? 0 : (a_sign == POSITIVE ? +1 : -1);
+	int b_signum = arbint_is_zero(b) ? 0 : (b_sign == POSITIVE ? +1 : -1);
+	if (a_signum != b_signum)
+		return a_signum > b_signum ? +1 : -1;
 
-	if (a_highest_digit > b_highest_digit)
-	{
-		retval = +1;
-		goto finish;
-	}
-	if (a_highest_digit < b_highest_digit)
-	{
-		retval = -1;
-		goto finish;
-	}
-
-	// Now we know that they both have the same amount of digits
-	// (ignoring leading zeroes)
-	assert(a_highest_digit == b_highest_digit);
-	size_t position = a_highest_digit;
-
-	// Find the highest digit that is different in both numbers
-	while (a->value[position] == b->value[position] && position)
-		position--;
-
-	if (a->value[position] > b->value[position])
-	{
-		retval = +1;
-		goto finish;
-	}
-	else if (a->value[position] < b->value[position])
-	{
-		retval = -1;
-		goto finish;
-	}
+	int magnitude;
+	if (a->length != b->length)
+		magnitude = a->length > b->length ? +1 : -1;
 	else
-	{
-		// In this case we must be at 0 because of the while loop
-		// above this
-		assert(position == 0);
-		return 0;
-	}
-
-finish:
-	// If the numbers are both negative, the results are exactly opposite.
-	// Only check one sign because they're both equal anyway
-	if (a_sign == NEGATIVE)
-	{
-		retval *= -1;
-	}
-	return retval;
+		magnitude = limbs_cmp(a->value, b->value, a->length);
+	return a_signum > 0 ? magnitude : -magnitude;
 }
 
 int
@@ -574,6 +389,10 @@ arbint_geq(arbint a, arbint b)
 void
 arbint_neg(arbint to_negate)
 {
+	// 0 stays positive
+	if (arbint_is_zero(to_negate))
+		return;
+
 	if (to_negate->sign == POSITIVE)
 		to_negate->sign = NEGATIVE;
 	else if (to_negate->sign == NEGATIVE)
@@ -0,0 +1,360 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "arbint.h"
+#include "datatypes.h"
+#include "helper-functions.h"
+#include "limbs.h"
+#include "thread-pool.h"
+
+#include "product.h"
+
+// Up to this many single-digit factors are multiplied into the product one at
+// a time, which is fastest while it's short
+#define PRODUCT_BASECASE 16
+
+// Nodes of the tree with fewer digits than this are multiplied on the same
+// thread, because handing them to another one would take longer
+#define THREAD_THRESHOLD 2048
+
+// Below this, the odd part of n! is the product of the odd parts of 2..n
+#define FACTORIAL_BASECASE 32
+
+// n choose k is computed as a quotient if k is at most n / BINOMIAL_RATIO, so
+// that sieving up to n doesn't take much longer than multiplying k factors
+#define BINOMIAL_RATIO 64
+
+typedef struct
+{
+	// The factors are either arbints or single digits, the other one is NULL
+	arbint* factors;
+	const limb_t* digits;
+	size_t n;
+	size_t threads;
+	arbint result;
+} product_job;
+
+static void*
+allocate_or_exit(size_t size)
+{
+	void* block = arbint_allocate(size);
+	if (block == NULL)
+	{
+		fprintf(stderr, "arbint_product: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return block;
+}
+
+static void
+multiply_digits(arbint result, const limb_t* digits, size_t n)
+{
+	// Requires n >= 1. Every factor adds at most one digit to the product.
+	arbint_reserve(result, n);
+	limb_t* rp    = result->value;
+	size_t length = 1;
+	rp[0]         = digits[0];
+	for (size_t i = 1; i < n; i++)
+	{
+		limb_t carry = limbs_mul_1(rp, rp, length, digits[i]);
+		if (carry)
+			rp[length++] = carry;
+	}
+	result->sign = POSITIVE;
+	arbint_normalize(result, length);
+}
+
+static void
+multiply_tree(void* argument)
+{
+	product_job* job = argument;
+	// Requires n >= 1
+	size_t n = job->n;
+	if (job->digits != NULL && n <= PRODUCT_BASECASE)
+	{
+		multiply_digits(job->result, job->digits, n);
+		return;
+	}
+	if (job->factors != NULL && n == 1)
+	{
+		arbint_copy_into(job->result, job->factors[0]);
+		return;
+	}
+
+	// Split digits in the middle, and arbints where the digits of the factors
+	// on both sides add up to about the same
+	size_t half  = n / 2;
+	size_t total = n;
+	if (job->factors != NULL)
+	{
+		total = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			total += job->factors[i]->length;
+		}
+		size_t low_length = job->factors[0]->length;
+		for (half = 1; half < n - 1 && 2 * low_length < total; half++)
+		{
+			low_length += job->factors[half]->length;
+		}
+	}
+
+	// Multiply the halves, the second one in the thread pool if there are
+	// threads left, and then their products
+	size_t threads = job->threads / 2;
+	arbint_struct high_product;
+	arbint_init(&high_product);
+	product_job low  = {job->factors, job->digits, half, job->threads - threads,
+	                    job->result};
+	product_job high = {job->factors ? job->factors + half : NULL,
+	                    job->digits ? job->digits + half : NULL, n - half, threads,
+	                    &high_product};
+
+	thread_pool_task task;
+	bool threaded = threads > 0 && total >= THREAD_THRESHOLD;
+	if (threaded)
+		thread_pool_spawn(&task, multiply_tree, &high);
+	multiply_tree(&low);
+	if (threaded)
+		thread_pool_join(&task);
+	else
+		multiply_tree(&high);
+
+	arbint_mul_arbint_into(job->result, job->result, &high_product);
+	arbint_free_value(&high_product);
+}
+
+void
+arbint_product(arbint result, arbint* factors, size_t n)
+{
+	if (n == 0)
+	{
+		arbint_product_ui(result, NULL, 0);
+		return;
+	}
+
+	// The factors are all read before result is written, so it may be one of
+	// them
+	arbint_struct product;
+	arbint_init(&product);
+	product_job job = {factors, NULL, n, arbint_get_threads(), &product};
+	multiply_tree(&job);
+	arbint_swap(result, &product);
+	arbint_free_value(&product);
+}
+
+void
+arbint_product_ui(arbint result, const limb_t* factors, size_t n)
+{
+	// Multiply neighbouring factors for as long as their product fits in a
+	// digit. A factor of 0 makes all digits after it 0, and the product too.
+	limb_t* packed = allocate_or_exit((n ? n : 1) * sizeof(limb_t));
+	size_t count   = 0;
+	limb_t digit   = 1;
+	for (size_t i = 0; i < n; i++)
+	{
+		dlimb_t product = (dlimb_t) digit * factors[i];
+		if (product >> LIMB_BITS)
+		{
+			packed[count++] = digit;
+			digit           = factors[i];
+		}
+		else
+		{
+			digit = (limb_t) product;
+		}
+	}
+	packed[count++] = digit;
+
+	product_job job = {NULL, packed, count, arbint_get_threads(), result};
+	multiply_tree(&job);
+	arbint_deallocate(packed, (n ? n : 1) * sizeof(limb_t));
+}
+
+static limb_t*
+primes_up_to(limb_t n, size_t* count)
+{
+	// Sieve of Eratosthenes over the odd numbers, with bit i of `composite`
+	// standing for 2i + 1. Returns the primes in increasing order, and NULL if
+	// there are none.
+	size_t odd_count  = n / 2 + n % 2;
+	size_t words      = odd_count / LIMB_BITS + 1;
+	limb_t* composite = allocate_or_exit(words * sizeof(limb_t));
+	memset(composite, 0, words * sizeof(limb_t));
+	for (limb_t p = 3; p <= n / p; p += 2)
+	{
+		size_t i = p / 2;
+		if ((composite[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1)
+			continue;
+		// The odd multiples of p from p^2 on are p apart in the bits
+		for (size_t j = p * p / 2; j < odd_count; j += p)
+		{
+			composite[j / LIMB_BITS] |= (limb_t) 1 << (j % LIMB_BITS);
+		}
+	}
+
+	// 1 isn't a prime, but 2 is
+	composite[0] |= 1;
+	*count = n >= 2;
+	for (size_t i = 0; i < odd_count; i++)
+	{
+		*count += !((composite[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1);
+	}
+
+	limb_t* primes = NULL;
+	if (*count)
+	{
+		primes       = allocate_or_exit(*count * sizeof(limb_t));
+		primes[0]    = 2;
+		size_t found = 1;
+		for (size_t i = 1; i < odd_count; i++)
+		{
+			if (!((composite[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1))
+				primes[found++] = 2 * i + 1;
+		}
+	}
+	arbint_deallocate(composite, words * sizeof(limb_t));
+	return primes;
+}
+
+static void
+odd_swing(arbint result, limb_t n, const limb_t* primes, size_t prime_count,
+          limb_t* factors)
+{
+	// The odd part of swing(n) = n! / (n/2)!^2. The exponent of a prime p in
+	// swing(n) is the number of odd ones among n / p, n / p^2, ..., rounded
+	// down, so p to that power is at most n and fits in a digit.
+	size_t count = 0;
+	for (size_t i = 1; i < prime_count && primes[i] <= n; i++)
+	{
+		limb_t p     = primes[i];
+		limb_t power = 1;
+		for (limb_t q = n / p; q > 0; q /= p)
+		{
+			if (q & 1)
+				power *= p;
+		}
+		if (power > 1)
+			factors[count++] = power;
+	}
+	arbint_product_ui(result, factors, count);
+}
+
+static void
+odd_factorial(arbint result, limb_t n, const limb_t* primes, size_t prime_count,
+              limb_t* factors)
+{
+	// The odd part of n!, which is the odd part of (n/2)!^2 * swing(n)
+	if (n < FACTORIAL_BASECASE)
+	{
+		size_t count = 0;
+		for (limb_t k = 3; k <= n; k++)
+		{
+			factors[count++] = k >> limb_trailing_zeros(k);
+		}
+		arbint_product_ui(result, factors, count);
+		return;
+	}
+
+	odd_factorial(result, n / 2, primes, prime_count, factors);
+	arbint_sqr_into(result, result);
+	arbint_struct swing;
+	arbint_init(&swing);
+	odd_swing(&swing, n, primes, prime_count, factors);
+	arbint_mul_arbint_into(result, result, &swing);
+	arbint_free_value(&swing);
+}
+
+void
+arbint_fac_ui(arbint result, limb_t n)
+{
+	size_t prime_count;
+	limb_t* primes  = primes_up_to(n, &prime_count);
+	size_t size     = prime_count > FACTORIAL_BASECASE ? prime_count : FACTORIAL_BASECASE;
+	limb_t* factors = allocate_or_exit(size * sizeof(limb_t));
+
+	odd_factorial(result, n, primes, prime_count, factors);
+
+	// There are n / 2 + n / 4 + ... = n - popcount(n) factors of 2 in n!
+	arbint_shl(result, result, n - limbs_popcount(&n, 1));
+
+	arbint_deallocate(factors, size * sizeof(limb_t));
+	arbint_deallocate(primes, prime_count * sizeof(limb_t));
+}
+
+void
+arbint_bin_uiui(arbint result, limb_t n, limb_t k)
+{
+	if (k > n)
+	{
+		arbint_set_zero(result);
+		return;
+	}
+	if (k > n - k)
+	{
+		k = n - k;
+	}
+
+	if (k <= n / BINOMIAL_RATIO)
+	{
+		// n (n - 1) ... (n - k + 1) / k!, which divides exactly
+		limb_t* factors = allocate_or_exit((k ? k : 1) * sizeof(limb_t));
+		for (limb_t i = 0; i < k; i++)
+		{
+			factors[i] = n - i;
+		}
+		arbint_product_ui(result, factors, k);
+		arbint_deallocate(factors, (k ? k : 1) * sizeof(limb_t));
+
+		arbint_struct denominator;
+		arbint_struct remainder;
+		arbint_init(&denominator);
+		arbint_init(&remainder);
+		arbint_fac_ui(&denominator, k);
+		arbint_divmod(result, &remainder, result, &denominator);
+		arbint_free_value(&denominator);
+		arbint_free_value(&remainder);
+		return;
+	}
+
+	// By Kummer's theorem, the exponent of p is the number of carries when
+	// adding k and n - k in base p, which is the number of digits where
+	// n / p^i isn't the sum of k / p^i and (n - k) / p^i. Again, p to that
+	// power is at most n.
+	size_t prime_count;
+	limb_t* primes  = primes_up_to(n, &prime_count);
+	limb_t* factors = allocate_or_exit(prime_count * sizeof(limb_t));
+	size_t count    = 0;
+	for (size_t i = 0; i < prime_count; i++)
+	{
+		limb_t p     = primes[i];
+		limb_t power = 1;
+		limb_t a     = k;
+		limb_t b     = n - k;
+		for (limb_t q = n / p; q > 0; q /= p)
+		{
+			a /= p;
+			b /= p;
+			if (q != a + b)
+				power *= p;
+		}
+		if (power > 1)
+			factors[count++] = power;
+	}
+	arbint_product_ui(result, factors, count);
+	arbint_deallocate(factors, prime_count * sizeof(limb_t));
+	arbint_deallocate(primes, prime_count * sizeof(limb_t));
+}
+
+void
+arbint_primorial_ui(arbint result, limb_t n)
+{
+	size_t prime_count;
+	limb_t* primes = primes_up_to(n, &prime_count);
+	arbint_product_ui(result, primes, prime_count);
+	arbint_deallocate(primes, prime_count * sizeof(limb_t));
+}
@@ -0,0 +1,220 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocation.h"
+#include "arbint.h"
+#include "datatypes.h"
+#include "helper-functions.h"
+#include "limbs.h"
+#include "multiplication.h"
+#include "operators.h"
+#include "thread-pool.h"
+
+#include "summation.h"
+
+// Halves with fewer terms than this are summed on the same thread, because
+// handing them to another one would take longer
+#define THREAD_THRESHOLD 4096
+
+// An accumulator digit holds the sum of at most this many limbs, which is
+// less than (2^LIMB_BITS)^2 even after the carry from the digit below is added
+#define MAX_TERMS ((size_t) LIMB_MAX)
+
+typedef struct
+{
+	// The terms are a[i] for a sum, and a[i] * b[i] for a dot product
+	arbint* a;
+	arbint* b;
+	size_t n;
+	size_t threads;
+	arbint result;
+} reduction;
+
+static void*
+allocate_or_exit(size_t size)
+{
+	void* block = arbint_allocate(size);
+	if (block == NULL)
+	{
+		fprintf(stderr, "arbint_sum: malloc failed\n");
+		exit(ENOMEM);
+	}
+	return block;
+}
+
+static size_t
+term_length(reduction* job, size_t i)
+{
+	// Number of digits that are enough for the i-th term, 0 if it's 0
+	arbint a = job->a[i];
+	if (arbint_is_zero(a))
+		return 0;
+	if (job->b == NULL)
+		return a->length;
+	arbint b = job->b[i];
+	return arbint_is_zero(b) ? 0 : a->length + b->length;
+}
+
+static void
+carry_out(arbint result, const dlimb_t* sums, size_t length)
+{
+	// Store the sum of sums[i] * 2^(LIMB_BITS * i) in result. The carry into
+	// every digit is less than 2^LIMB_BITS, so the last one fits in a limb.
+	arbint_reserve(result, length + 1);
+	dlimb_t carry = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		dlimb_t sum      = sums[i] + carry;
+		result->value[i] = (limb_t) sum;
+		carry            = sum >> LIMB_BITS;
+	}
+	result->value[length] = (limb_t) carry;
+	result->sign          = POSITIVE;
+	arbint_normalize(result, length + 1);
+}
+
+static void
+accumulate(reduction* job)
+{
+	// Add the digits of the positive and the negative terms to two separate
+	// accumulators, and subtract them at the end
+	size_t length      = 0;
+	size_t max_product = 0;
+	for (size_t i = 0; i < job->n; i++)
+	{
+		size_t n = term_length(job, i);
+		length   = n > length ? n : length;
+	}
+	if (length == 0)
+	{
+		arbint_set_zero(job->result);
+		return;
+	}
+	dlimb_t* sums = allocate_or_exit(2 * length * sizeof(dlimb_t));
+	memset(sums, 0, 2 * length * sizeof(dlimb_t));
+	limb_t* product = NULL;
+	if (job->b != NULL)
+	{
+		max_product = length;
+		product     = allocate_or_exit(max_product * sizeof(limb_t));
+	}
+
+	for (size_t i = 0; i < job->n; i++)
+	{
+		size_t n = term_length(job, i);
+		if (n == 0)
+			continue;
+
+		arbint a         = job->a[i];
+		const limb_t* tp = a->value;
+		sign term_sign   = a->sign;
+		if (job->b != NULL)
+		{
+			arbint b  = job->b[i];
+			term_sign = a->sign == b->sign ? POSITIVE : NEGATIVE;
+			if (a->length >= b->length)
+				limbs_mul(product, a->value, a->length, b->value, b->length);
+			else
+				limbs_mul(product, b->value, b->length, a->value, a->length);
+			tp = product;
+		}
+
+		// Without carries between the digits, this is a simple loop that the
+		// compiler can unroll
+		dlimb_t* accumulator = term_sign == POSITIVE ? sums : sums + length;
+		for (size_t j = 0; j < n; j++)
+		{
+			accumulator[j] += tp[j];
+		}
+	}
+
+	arbint_struct negative;
+	arbint_init(&negative);
+	carry_out(job->result, sums, length);
+	carry_out(&negative, sums + length, length);
+	arbint_sub_inplace(job->result, &negative);
+
+	arbint_free_value(&negative);
+	arbint_deallocate(product, max_product * sizeof(limb_t));
+	arbint_deallocate(sums, 2 * length * sizeof(dlimb_t));
+}
+
+static void
+reduce(void* argument)
+{
+	reduction* job         = argument;
+	bool split_for_threads = job->threads > 1 && job->n >= 2 * THREAD_THRESHOLD;
+	if (!split_for_threads && job->n <= MAX_TERMS)
+	{
+		accumulate(job);
+		return;
+	}
+
+	// Sum the halves, the second one in the thread pool if there are threads
+	// left, and add them. That makes a tree of pairwise additions, with one
+	// level per halving.
+	size_t half    = job->n / 2;
+	size_t threads = job->threads / 2;
+	arbint_struct high_sum;
+	arbint_init(&high_sum);
+	reduction low  = {job->a, job->b, half, job->threads - threads, job->result};
+	reduction high = {job->a + half, job->b ? job->b + half : NULL, job->n - half,
+	                  threads, &high_sum};
+
+	thread_pool_task task;
+	if (split_for_threads)
+		thread_pool_spawn(&task, reduce, &high);
+	reduce(&low);
+	if (split_for_threads)
+		thread_pool_join(&task);
+	else
+		reduce(&high);
+
+	arbint_add_inplace(job->result, &high_sum);
+	arbint_free_value(&high_sum);
+}
+
+static void
+reduce_into(arbint result, arbint* a, arbint* b, size_t n)
+{
+	// The terms are all read before result is written, so it may be one of
+	// them. The sum is moved over at the end instead of copied.
+	arbint_struct sum;
+	arbint_init(&sum);
+	reduction job = {a, b, n, arbint_get_threads(), &sum};
+	reduce(&job);
+
+	arbint_swap(result, &sum);
+	arbint_free_value(&sum);
+}
+
+arbint
+arbint_sum(arbint* terms, size_t n)
+{
+	arbint result = arbint_new();
+	reduce_into(result, terms, NULL, n);
+	return result;
+}
+
+arbint
+arbint_dot(arbint* a, arbint* b, size_t n)
+{
+	arbint result = arbint_new();
+	reduce_into(result, a, b, n);
+	return result;
+}
+
+void
+arbint_sum_into(arbint result, arbint* terms, size_t n)
+{
+	reduce_into(result, terms, NULL, n);
+}
+
+void
+arbint_dot_into(arbint result, arbint* a, arbint* b, size_t n)
+{
+	reduce_into(result, a, b, n);
+}
@@ -0,0 +1,427 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocation.h"
+#include "thread-pool.h"
+
+// Each deque holds this many tasks, further ones run right away
+#define DEQUE_CAPACITY 256
+
+// thread_pool_for makes up to this many pieces per thread, so that threads
+// that are done early can take over pieces of the others
+#define PIECES_PER_THREAD 4
+
+// own_deque of the threads that have none
+#define NO_DEQUE SIZE_MAX
+
+typedef struct
+{
+	// The tasks [top, bottom) are waiting. The owner pushes and pops at the
+	// bottom, other threads steal at the top. top and bottom are changed with
+	// the lock held, but read without it to skip empty deques.
+	pthread_mutex_t lock;
+	thread_pool_task* tasks[DEQUE_CAPACITY];
+	size_t top;
+	size_t bottom;
+
+	// Signalled when a task from this deque is done. Only the owner waits for
+	// it, since a task is joined by the thread that spawned it.
+	pthread_cond_t done;
+
+	// Whether a thread that isn't a worker owns the deque
+	bool claimed;
+} deque;
+
+typedef struct
+{
+	thread_pool_range_function function;
+	void* argument;
+	size_t begin;
+	size_t end;
+	size_t piece;
+} range;
+
+static size_t thread_count     = 1;
+static size_t thread_threshold = ARBINT_THREAD_THRESHOLD;
+
+// `lock` protects starting and stopping the workers, claiming deques and
+// putting workers to sleep. Idle workers wait for `idle`, which is signalled
+// once for every pushed task while some of them sleep.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle  = PTHREAD_COND_INITIALIZER;
+
+// Deque i < worker_count belongs to worker i, the others are claimed by
+// other threads while they have tasks in the pool. NULL while the workers
+// aren't started.
+static deque* deques             = NULL;
+static pthread_t* workers        = NULL;
+static size_t deque_count        = 0;
+static size_t worker_count       = 0;
+static bool stopping             = false;
+static __thread size_t own_deque = NO_DEQUE;
+
+// The tasks of the calling thread that were pushed and not joined yet
+static __thread size_t pending = 0;
+
+// At least the number of tasks in all deques, and the number of sleeping
+// workers. Both are atomic: a pushing thread adds to `queued` before it
+// reads `sleeping`, and a worker adds to `sleeping` before it reads
+// `queued`, so at least one of them sees the other.
+static size_t queued   = 0;
+static size_t sleeping = 0;
+
+static void
+stop_workers(void)
+{
+	pthread_mutex_lock(&lock);
+	stopping = true;
+	pthread_cond_broadcast(&idle);
+	pthread_mutex_unlock(&lock);
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		pthread_join(workers[i], NULL);
+	}
+	for (size_t i = 0; i < deque_count; i++)
+	{
+		pthread_mutex_destroy(&deques[i].lock);
+		pthread_cond_destroy(&deques[i].done);
+	}
+	free(workers);
+	free(deques);
+	workers      = NULL;
+	deques       = NULL;
+	deque_count  = 0;
+	worker_count = 0;
+	stopping     = false;
+}
+
+void
+arbint_set_threads(size_t count)
+{
+	count = count ? count : 1;
+	if (count == thread_count)
+		return;
+
+	// The new number of workers is started when it's needed
+	if (deques != NULL)
+		stop_workers();
+	thread_count = count;
+}
+
+size_t
+arbint_get_threads(void)
+{
+	return thread_count;
+}
+
+void
+arbint_set_thread_threshold(size_t limbs)
+{
+	thread_threshold = limbs;
+}
+
+size_t
+arbint_get_thread_threshold(void)
+{
+	return thread_threshold;
+}
+
+bool
+thread_pool_active(size_t limbs)
+{
+	return thread_count > 1 && limbs >= thread_threshold;
+}
+
+static bool
+is_empty(deque* d)
+{
+	size_t top    = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+	size_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+	return top >= bottom;
+}
+
+static void
+set_ends(deque* d, size_t top, size_t bottom)
+{
+	// Requires the lock of the deque
+	if (top == bottom)
+		top = bottom = 0;
+	__atomic_store_n(&d->top, top, __ATOMIC_RELAXED);
+	__atomic_store_n(&d->bottom, bottom, __ATOMIC_RELAXED);
+}
+
+static bool
+push(deque* d, thread_pool_task* task)
+{
+	pthread_mutex_lock(&d->lock);
+	bool pushed = d->bottom < DEQUE_CAPACITY;
+	if (pushed)
+	{
+		d->tasks[d->bottom] = task;
+		set_ends(d, d->top, d->bottom + 1);
+	}
+	pthread_mutex_unlock(&d->lock);
+	return pushed;
+}
+
+static thread_pool_task*
+pop(deque* d, bool steal)
+{
+	// The newest task, or the oldest one for another thread than the owner
+	thread_pool_task* task = NULL;
+	if (is_empty(d))
+		return NULL;
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom > d->top && steal)
+	{
+		task = d->tasks[d->top];
+		set_ends(d, d->top + 1, d->bottom);
+	}
+	else if (d->bottom > d->top)
+	{
+		task = d->tasks[d->bottom - 1];
+		set_ends(d, d->top, d->bottom - 1);
+	}
+	pthread_mutex_unlock(&d->lock);
+	return task;
+}
+
+static thread_pool_task*
+take_task(size_t index)
+{
+	// The newest task of the own deque, otherwise the oldest one of another
+	// deque
+	if (__atomic_load_n(&queued, __ATOMIC_SEQ_CST) == 0)
+		return NULL;
+	thread_pool_task* task = pop(&deques[index], false);
+	for (size_t i = 1; i < deque_count && task == NULL; i++)
+	{
+		task = pop(&deques[(index + i) % deque_count], true);
+	}
+	if (task != NULL)
+		__atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+	return task;
+}
+
+static void
+call_task(thread_pool_task* task)
+{
+	// Tasks don't use the arena of the thread that happens to run them. Their
+	// blocks may be freed by other threads, which would pass them to their
+	// own arena or the memory functions.
+	arbint_arena arena = arbint_arena_use(NULL);
+	task->function(task->argument);
+	arbint_arena_use(arena);
+}
+
+static void
+run_task(thread_pool_task* task)
+{
+	// Only the thread that spawned the task is woken. The task may be gone as
+	// soon as it's marked as done.
+	deque* owner = &deques[task->owner];
+	call_task(task);
+	pthread_mutex_lock(&owner->lock);
+	__atomic_store_n(&task->done, true, __ATOMIC_RELEASE);
+	pthread_cond_signal(&owner->done);
+	pthread_mutex_unlock(&owner->lock);
+}
+
+static void*
+worker_main(void* index)
+{
+	own_deque = (size_t)(uintptr_t) index;
+	while (true)
+	{
+		thread_pool_task* task = take_task(own_deque);
+		if (task != NULL)
+		{
+			run_task(task);
+			continue;
+		}
+
+		pthread_mutex_lock(&lock);
+		__atomic_add_fetch(&sleeping, 1, __ATOMIC_SEQ_CST);
+		while (!stopping && __atomic_load_n(&queued, __ATOMIC_SEQ_CST) == 0)
+		{
+			pthread_cond_wait(&idle, &lock);
+		}
+		__atomic_sub_fetch(&sleeping, 1, __ATOMIC_SEQ_CST);
+		bool stop = stopping;
+		pthread_mutex_unlock(&lock);
+		if (stop)
+			return NULL;
+	}
+}
+
+static void
+start_workers(void)
+{
+	// Requires the lock. There is a deque for every worker, and as many for
+	// other threads as there are threads. If not all workers can be started,
+	// the pool works with fewer.
+	size_t count = 2 * thread_count - 1;
+	deques       = calloc(count, sizeof(deque));
+	workers      = malloc((thread_count - 1) * sizeof(pthread_t));
+	if (deques == NULL || workers == NULL)
+	{
+		fprintf(stderr, "thread_pool_spawn: malloc failed\n");
+		exit(ENOMEM);
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		pthread_mutex_init(&deques[i].lock, NULL);
+		pthread_cond_init(&deques[i].done, NULL);
+	}
+	deque_count = count;
+	for (size_t i = 0; i < thread_count - 1; i++)
+	{
+		void* index = (void*)(uintptr_t) worker_count;
+		if (pthread_create(&workers[worker_count], NULL, worker_main, index) != 0)
+			break;
+		worker_count++;
+	}
+}
+
+static void
+claim_deque(void)
+{
+	// Give the calling thread a deque of its own, so that the tasks of threads
+	// that call arbint functions at the same time don't get mixed up. Threads
+	// beyond the number of deques run their tasks right away.
+	pthread_mutex_lock(&lock);
+	if (deques == NULL)
+		start_workers();
+	for (size_t i = worker_count; i < deque_count && worker_count > 0; i++)
+	{
+		if (!deques[i].claimed)
+		{
+			deques[i].claimed = true;
+			own_deque         = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void
+release_deque(void)
+{
+	pthread_mutex_lock(&lock);
+	deques[own_deque].claimed = false;
+	own_deque                 = NO_DEQUE;
+	pthread_mutex_unlock(&lock);
+}
+
+void
+thread_pool_spawn(thread_pool_task* task, thread_pool_function function,
+                  void* argument)
+{
+	task->function = function;
+	task->argument = argument;
+	task->owner    = NO_DEQUE;
+	task->done     = false;
+
+	if (own_deque == NO_DEQUE && thread_count > 1)
+		claim_deque();
+	if (own_deque != NO_DEQUE)
+	{
+		// Counted before it's pushed, so that `queued` is never too small
+		task->owner = own_deque;
+		__atomic_add_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+		if (push(&deques[own_deque], task))
+		{
+			pending++;
+			if (__atomic_load_n(&sleeping, __ATOMIC_SEQ_CST) > 0)
+			{
+				pthread_mutex_lock(&lock);
+				pthread_cond_signal(&idle);
+				pthread_mutex_unlock(&lock);
+			}
+			return;
+		}
+		__atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+		task->owner = NO_DEQUE;
+	}
+
+	// No other thread knows about the task, so it needs no lock
+	call_task(task);
+	task->done = true;
+}
+
+void
+thread_pool_join(thread_pool_task* task)
+{
+	if (task->owner == NO_DEQUE)
+		return;
+
+	// Usually the task is still at the bottom of the own deque. Otherwise
+	// another thread runs it, and this one helps with other tasks until there
+	// are none left, and then waits.
+	deque* own = &deques[own_deque];
+	while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE))
+	{
+		thread_pool_task* other = take_task(own_deque);
+		if (other != NULL)
+		{
+			run_task(other);
+			continue;
+		}
+		pthread_mutex_lock(&own->lock);
+		while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE))
+		{
+			pthread_cond_wait(&own->done, &own->lock);
+		}
+		pthread_mutex_unlock(&own->lock);
+	}
+
+	// Threads that aren't workers give their deque back once all their tasks
+	// are joined
+	pending--;
+	if (pending == 0 && own_deque >= worker_count)
+		release_deque();
+}
+
+static void
+run_range(void* argument)
+{
+	// Halve the range until it's a single piece, with the upper halves going
+	// to the pool
+	range* whole = argument;
+	if (whole->end - whole->begin <= whole->piece)
+	{
+		whole->function(whole->argument, whole->begin, whole->end);
+		return;
+	}
+
+	size_t middle = whole->begin + (whole->end - whole->begin) / 2;
+	range low     = *whole;
+	range high    = *whole;
+	low.end       = middle;
+	high.begin    = middle;
+
+	thread_pool_task task;
+	thread_pool_spawn(&task, run_range, &high);
+	run_range(&low);
+	thread_pool_join(&task);
+}
+
+void
+thread_pool_for(size_t count, size_t grain, thread_pool_range_function function,
+                void* argument)
+{
+	size_t pieces = thread_count * PIECES_PER_THREAD;
+	size_t piece  = (count + pieces - 1) / pieces;
+	if (thread_count == 1 || count <= grain)
+	{
+		function(argument, 0, count);
+		return;
+	}
+
+	range whole = {function, argument, 0, count, piece > grain ? piece : grain};
+	run_range(&whole);
+}
@@ -7,10 +7,59 @@
 #include "minunit.h"
 
 #include "arbint.h"
+#include "conversion.h"
+#include "division.h"
+#include "limbs.h"
+#include "multiplication.h"
 
 int tests_run      = 0;
 int assertions_run = 0;
 
+/*
+ * The expected values in these tests are written as base 2^32 digits. With
+ * 64-bit limbs, two of them make up one limb.
+ */
+#define LIMBS_FOR_U32(count) (((count) * 32 + ARBINT_LIMB_BITS - 1) / ARBINT_LIMB_BITS)
+
+// Build an arbint from `count` base 2^32 digits, least significant first
+static arbint
+u32_digits_to_arbint(const uint32_t* digits, size_t count)
+{
+	size_t per_limb = ARBINT_LIMB_BITS / 32;
+	size_t length   = LIMBS_FOR_U32(count);
+	arbint a        = arbint_new_length(length);
+	memset(a->value, 0, length * sizeof(limb_t));
+	for (size_t i = 0; i < count; i++)
+	{
+		a->value[i / per_limb] |= (limb_t) digits[i] << (32 * (i % per_limb));
+	}
+	arbint_normalize(a, length);
+	return a;
+}
+
+// Check that the value of `a` consists of exactly the given base 2^32 digits,
+// and that it has as many limbs as needed for them without leading zeros
+static bool
+has_u32_digits(arbint a, const uint32_t* digits, size_t count)
+{
+	size_t per_limb    = ARBINT_LIMB_BITS / 32;
+	size_t significant = count;
+	while (significant > 1 && digits[significant - 1] == 0)
+	{
+		significant--;
+	}
+	if (a->length != LIMBS_FOR_U32(significant))
+		return false;
+
+	for (size_t i = 0; i < a->length * per_limb; i++)
+	{
+		uint32_t digit = (uint32_t)(a->value[i / per_limb] >> (32 * (i % per_limb)));
+		if (digit != (i < count ? digits[i] : 0))
+			return false;
+	}
+	return true;
+}
+
 static char*
 test_char_to_digit()
 {
@@ -44,34 +93,36 @@ test_int_to_sign()
 static char*
 test_arbint_eq()
 {
-	uint32_t test_array_a[3] = {1318934184, 121983, 0};
-	uint32_t test_array_b[3] = {1318934184, 121983, 0};
-	uint32_t test_array_c[3] = {1318934185, 121983, 0}; // 1 more
-	uint32_t test_array_d[2] = {1318934184, 121983};
+	limb_t test_array_a[3] = {1318934184, 121983, 0};
+	limb_t test_array_b[3] = {1318934184, 121983, 0};
+	limb_t test_array_c[3] = {1318934185, 121983, 0}; // 1 more
+	limb_t test_array_d[2] = {1318934184, 121983};
 
 	arbint a = arbint_new_empty();
 	arbint b = arbint_new_empty();
 
-	a->value  = test_array_a;
-	a->length = 3;
-	a->sign   = POSITIVE;
+	a->value    = test_array_a;
+	a->length   = 2;
+	a->capacity = 3;
+	a->sign     = POSITIVE;
 
-	b->value  = test_array_b;
-	b->length = 3;
-	b->sign   = POSITIVE;
+	b->value    = test_array_b;
+	b->length   = 2;
+	b->capacity = 3;
+	b->sign     = POSITIVE;
 
 	mu_assert("Completely equal arbints aren't equal", arbint_eq(a, b) == true);
 
 	a->value = test_array_c;
 	mu_assert("Different arbints with same length are equal", arbint_eq(a, b) == false);
 
-	a->value  = test_array_d;
-	a->length = 2;
-	mu_assert("Numerically equal arbints with different length aren't equal",
+	a->value    = test_array_d;
+	a->capacity = 2;
+	mu_assert("Numerically equal arbints with different capacity aren't equal",
 	          arbint_eq(a, b) == true);
 
-	uint32_t zero_array[1] = {0};
-	uint32_t one_array[1]  = {1};
+	limb_t zero_array[1] = {0};
+	limb_t one_array[1]  = {1};
 
 	a->value  = zero_array;
 	a->length = 1;
@@ -83,6 +134,11 @@ test_arbint_eq()
 
 	mu_assert("Arbints = 0 with different sign aren't equal", arbint_eq(a, b) == true);
 
+	arbint_normalize(b, 1);
+	mu_assert("arbint_normalize didn't make 0 positive", b->sign == POSITIVE);
+
+	b->sign = NEGATIVE;
+
 	a->value = one_array;
 	b->value = one_array;
 
@@ -97,6 +153,10 @@ test_arbint_eq()
 
 	mu_assert("Empty arbints aren't equal", arbint_eq(c, d) == true);
 
+	arbint_neg(c);
+	mu_assert("arbint_neg made 0 negative", c->sign == POSITIVE);
+	mu_assert("Negated 0 isn't equal to 0", arbint_eq(c, d) == true);
+
 	arbint_free(c);
 	arbint_free(d);
 
@@ -150,34 +210,31 @@ test_comparison()
 static char*
 test_str_to_arbint()
 {
+	const uint32_t two_to_32[]  = {0, 1};
+	const uint32_t huge_value[] = {313953885, 3019150336, 3284471345, 2609588367, 2328};
+
 	arbint a = arbint_new();
 	str_to_arbint("4294967296", a, 10);
 	mu_assert("str_to_arbint with UINT32_MAX failed",
-	          a->value[0] == 0 && a->value[1] == 1 && a->length == 2 &&
-	              a->sign == POSITIVE);
+	          has_u32_digits(a, two_to_32, 2) && a->sign == POSITIVE);
 
 	arbint_free_value(a);
 	arbint_reset(a);
 	str_to_arbint("-4294967296", a, 10);
 	mu_assert("str_to_arbint with -UINT32_MAX failed",
-	          a->value[0] == 0 && a->value[1] == 1 && a->length == 2 &&
-	              a->sign == NEGATIVE);
+	          has_u32_digits(a, two_to_32, 2) && a->sign == NEGATIVE);
 
 	arbint_free_value(a);
 	arbint_reset(a);
 	str_to_arbint("+792384103083241340432014773910347139419741", a, 10);
 	mu_assert("str_to_arbint with random huge value and leading + failed",
-	          a->value[0] == 313953885 && a->value[1] == 3019150336 &&
-	              a->value[2] == 3284471345 && a->value[3] == 2609588367 &&
-	              a->value[4] == 2328 && a->length == 5 && a->sign == POSITIVE);
+	          has_u32_digits(a, huge_value, 5) && a->sign == POSITIVE);
 
 	arbint_free_value(a);
 	arbint_reset(a);
 	str_to_arbint("-792384103083241340432014773910347139419741", a, 10);
 	mu_assert("str_to_arbint with -(random huge value) failed",
-	          a->value[0] == 313953885 && a->value[1] == 3019150336 &&
-	              a->value[2] == 3284471345 && a->value[3] == 2609588367 &&
-	              a->value[4] == 2328 && a->length == 5 && a->sign == NEGATIVE);
+	          has_u32_digits(a, huge_value, 5) && a->sign == NEGATIVE);
 
 	arbint_free_value(a);
 	arbint_reset(a);
@@ -185,23 +242,20 @@ test_str_to_arbint()
 	str_to_arbint("-010101010101010101010101010101010101010101010101010101010101010101010"
 	              "101010101010101010101010101010101010101010101010101010101010101010101",
 	              a, 2);
-	uint32_t x = 1431655765;
+	uint32_t x              = 1431655765;
+	const uint32_t base_2[] = {x, x, x, x, 341};
 	mu_assert("str_to_arbint with base 2 failed",
-	          a->length == 5 && a->value[0] == x && a->value[1] == x &&
-	              a->value[2] == x && a->value[3] == x && a->value[4] == 341 &&
-	              a->sign == NEGATIVE);
+	          has_u32_digits(a, base_2, 5) && a->sign == NEGATIVE);
 
 	arbint_free_value(a);
 	arbint_reset(a);
 	str_to_arbint("2234437233536512670610467177347354552643414515707450555642435166545370"
 	              "737574172732620750174516443207",
 	              a, 8);
-	mu_assert("str_to_arbint with base 8 failed",
-	          a->length == 10 && a->value[0] == 3845801607 && a->value[1] == 1991384707 &&
-	              a->value[2] == 3820977213 && a->value[3] == 2745658155 &&
-	              a->value[4] == 2401810152 && a->value[5] == 1513645367 &&
-	              a->value[6] == 2138290989 && a->value[7] == 2915443310 &&
-	              a->value[8] == 2410081236 && a->value[9] == 1180);
+	const uint32_t base_8[] = {3845801607, 1991384707, 3820977213, 2745658155,
+	                           2401810152, 1513645367, 2138290989, 2915443310,
+	                           2410081236, 1180};
+	mu_assert("str_to_arbint with base 8 failed", has_u32_digits(a, base_8, 10));
 
 	arbint_free(a);
 
@@ -211,41 +265,39 @@ test_str_to_arbint()
 static char*
 test_arbint_mul()
 {
-	arbint a    = arbint_new_length(3);
-	a->value[0] = 4294967295;
+	const uint32_t a_digits[]   = {4294967295, 0, 0};
+	const uint32_t a_times_10[] = {4294967286, 9, 0};
+	arbint a                    = u32_digits_to_arbint(a_digits, 3);
 	arbint_mul(a, 10);
-	mu_assert("arbint_mul by 10 failed",
-	          a->value[0] == 4294967286 && a->value[1] == 9 && a->value[2] == 0);
+	mu_assert("arbint_mul by 10 failed", has_u32_digits(a, a_times_10, 3));
 	arbint_free(a);
 
-	arbint b    = arbint_new_length(3);
-	b->value[0] = 4294967295;
-	b->value[1] = 4294967295;
+	const uint32_t b_digits[]    = {4294967295, 4294967295, 0};
+	const uint32_t b_times_666[] = {4294966630, 4294967295, 665};
+	arbint b                     = u32_digits_to_arbint(b_digits, 3);
 	arbint_mul(b, 666);
-	mu_assert("arbint_mul by 666 failed", b->value[0] == 4294966630 &&
-	                                          b->value[1] == 4294967295 &&
-	                                          b->value[2] == 665);
+	mu_assert("arbint_mul by 666 failed", has_u32_digits(b, b_times_666, 3));
 	arbint_free(b);
 
 	// This test should put the most significant digit close to overflowing,
 	// but should not allocate new space in c.value.
-	arbint c    = arbint_new_length(3);
-	c->value[0] = 4294967295;
-	c->value[1] = 4294967295;
+	const uint32_t c_times_max[] = {1, 4294967295, 4294967294};
+	arbint c                     = u32_digits_to_arbint(b_digits, 3);
 	arbint_mul(c, UINT32_MAX);
-	mu_assert("arbint_mul by UINT32_MAX reallocated unnecessarily", c->length == 3);
-	mu_assert("arbint_mul by UINT32_MAX failed",
-	          c->value[0] == 1 && c->value[1] == 4294967295 && c->value[2] == 4294967294);
+	mu_assert("arbint_mul by UINT32_MAX reallocated unnecessarily",
+	          c->length == LIMBS_FOR_U32(3));
+	mu_assert("arbint_mul by UINT32_MAX failed", has_u32_digits(c, c_times_max, 3));
 	arbint_free(c);
 
-	// This test should reallocate c.value to fit the larger value
-	arbint d    = arbint_new_length(3);
-	d->value[2] = 4200000000;
+	// This test should reallocate c.value to fit the larger value (with 64-bit
+	// limbs, the top limb still has room)
+	const uint32_t d_digits[]     = {0, 0, 4200000000};
+	const uint32_t d_times_1291[] = {0, 0, 1951272448, 1262};
+	arbint d                      = u32_digits_to_arbint(d_digits, 3);
 	arbint_mul(d, 1291);
-	mu_assert("arbint_mul by 1291 didn't reallocate correctly", d->length == 4);
-	mu_assert("arbint_mul by 1291 failed", d->value[0] == 0 && d->value[1] == 0 &&
-	                                           d->value[2] == 1951272448 &&
-	                                           d->value[3] == 1262);
+	mu_assert("arbint_mul by 1291 didn't reallocate correctly",
+	          d->length == LIMBS_FOR_U32(4));
+	mu_assert("arbint_mul by 1291 failed", has_u32_digits(d, d_times_1291, 4));
 	arbint_free(d);
 
 	// Test multiplication by 1
@@ -265,6 +317,283 @@ test_arbint_mul()
 	return 0;
 }
 
+// Deterministic pseudo-random numbers for the tests (xorshift32)
+static uint32_t
+test_random(void)
+{
+	static uint32_t state = 2463534242;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static arbint
+random_arbint(size_t length)
+{
+	arbint a = arbint_new_length(length);
+	for (size_t i = 0; i < length; i++)
+	{
+		a->value[i] = test_random();
+#if ARBINT_LIMB_BITS == 64
+		a->value[i] |= (limb_t) test_random() << 32;
+#endif
+	}
+	arbint_normalize(a, length);
+	return a;
+}
+
+// Schoolbook multiplication using only arbint_mul and add_to_arbint, to check
+// the faster algorithms against
+static arbint
+reference_mul(arbint a, arbint b)
+{
+	arbint result = arbint_new_length(a->length + b->length);
+	for (size_t i = 0; i < b->length; i++)
+	{
+		arbint row = arbint_copy(a);
+#if ARBINT_LIMB_BITS == 64
+		// arbint_mul takes 32-bit multipliers, so the row is
+		// a * high half * 2^32 + a * low half
+		arbint low = arbint_copy(a);
+		arbint_mul(low, (uint32_t) b->value[i]);
+		arbint_mul(row, (uint32_t)(b->value[i] >> 32));
+		arbint_mul(row, 1 << 16);
+		arbint_mul(row, 1 << 16);
+		for (size_t j = 0; j < low->length; j++)
+		{
+			add_to_arbint(row, low->value[j], j);
+		}
+		arbint_free(low);
+#else
+		arbint_mul(row, b->value[i]);
+#endif
+		for (size_t j = 0; j < row->length; j++)
+		{
+			add_to_arbint(result, row->value[j], i + j);
+		}
+		arbint_free(row);
+	}
+	result->sign = a->sign == b->sign ? POSITIVE : NEGATIVE;
+	return result;
+}
+
+// Parse a string digit by digit with arbint_mul and add_to_arbint, to check the
+// faster algorithms against
+static arbint
+reference_from_str(const char* str, uint32_t base)
+{
+	arbint result = arbint_new();
+	for (size_t i = 0; str[i]; i++)
+	{
+		arbint_mul(result, base);
+		add_to_arbint(result, (limb_t) char_to_digit(str[i], base), 0);
+	}
+	return result;
+}
+
+static char*
+test_count_valid_digits()
+{
+	const char* digits = "12345678901234567890123";
+	mu_assert("count_valid_digits: valid digits not accepted",
+	          count_valid_digits(digits, 23, 10) == 23);
+
+	// An invalid character at every position, in the blocks of 8 digits and in
+	// the rest
+	const char invalid[] = {'/', ':', 'a', ' ', '\x80', '\xb0', '\xff'};
+	char str[24];
+	for (size_t position = 0; position < 23; position++)
+	{
+		for (size_t i = 0; i < sizeof(invalid); i++)
+		{
+			memcpy(str, digits, 24);
+			str[position] = invalid[i];
+			mu_assert("count_valid_digits didn't stop at an invalid character",
+			          count_valid_digits(str, 23, 10) == position);
+		}
+	}
+
+	// Digits that are too large for the base
+	mu_assert("count_valid_digits: 8 is a digit in base 8",
+	          count_valid_digits("0123456701234567012345678", 25, 8) == 24);
+	mu_assert("count_valid_digits: 2 is a digit in base 2",
+	          count_valid_digits("10101010111111112", 17, 2) == 16);
+	mu_assert("count_valid_digits: letters aren't digits in base 36",
+	          count_valid_digits("09azAZ", 6, 36) == 6);
+	return 0;
+}
+
+static char*
+test_str_to_arbint_long()
+{
+	// Long enough for several levels of divide and conquer in all bases
+	const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	size_t lengths[]    = {1, 700, 1000, 5000, 31000};
+	uint32_t bases[]    = {2, 3, 4, 8, 10, 16, 32, 36};
+	char* str           = malloc(31001);
+
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(bases) / sizeof(bases[0]); j++)
+		{
+			for (size_t k = 0; k < lengths[i]; k++)
+			{
+				str[k] = digits[test_random() % bases[j]];
+			}
+			str[lengths[i]] = '\0';
+
+			// Leading zeroes and a zero block in the middle
+			str[0] = '0';
+			memset(str + lengths[i] / 2, '0', lengths[i] / 4);
+
+			arbint a = arbint_new();
+			arbint b = reference_from_str(str, bases[j]);
+			str_to_arbint(str, a, bases[j]);
+			mu_assert("str_to_arbint differs from digit by digit parsing",
+			          arbint_eq(a, b));
+			mu_assert("str_to_arbint left a leading zero limb",
+			          a->length == 1 || a->value[a->length - 1] != 0);
+			arbint_free(a);
+			arbint_free(b);
+		}
+	}
+
+	free(str);
+	return 0;
+}
+
+static char*
+test_str_to_arbint_prefix()
+{
+	arbint a = arbint_new();
+	arbint b = arbint_new();
+
+	str_to_arbint("0x1fFfFfFfFfFfFfFfFf", a, 16);
+	str_to_arbint("1fffffffffffffffff", b, 16);
+	mu_assert("str_to_arbint: 0x prefix not skipped", arbint_eq(a, b));
+	str_to_arbint("-0X1fFfFfFfFfFfFfFfFf", a, 16);
+	arbint_neg(b);
+	mu_assert("str_to_arbint: 0X prefix not skipped after a sign", arbint_eq(a, b));
+
+	str_to_arbint("0b101", a, 2);
+	u64_to_arbint(5, b);
+	mu_assert("str_to_arbint: 0b prefix not skipped", arbint_eq(a, b));
+	str_to_arbint("+0B0", a, 2);
+	u64_to_arbint(0, b);
+	mu_assert("str_to_arbint: 0B prefix not skipped", arbint_eq(a, b));
+
+	// b is a digit in base 16, and the prefixes only belong to their own base
+	str_to_arbint("0b1", a, 16);
+	u64_to_arbint(0xb1, b);
+	mu_assert("str_to_arbint: 0b skipped in base 16", arbint_eq(a, b));
+	str_to_arbint("0x", a, 34);
+	u64_to_arbint(33, b);
+	mu_assert("str_to_arbint: 0x skipped in base 34", arbint_eq(a, b));
+
+	arbint_free(a);
+	arbint_free(b);
+	return 0;
+}
+
+static char*
+test_arbint_mul_arbint()
+{
+	arbint a = arbint_new();
+	arbint b = arbint_new();
+	arbint c = arbint_new();
+
+	str_to_arbint("18446744073709551615", a, 10);
+	str_to_arbint("-18446744073709551615", b, 10);
+	str_to_arbint("-340282366920938463426481119284349108225", c, 10);
+	arbint result = arbint_mul_arbint(a, b);
+	mu_assert("arbint_mul_arbint: (2^64-1) * -(2^64-1) failed", arbint_eq(result, c));
+	arbint_free(result);
+
+	arbint_neg(a);
+	arbint_neg(c);
+	result = arbint_mul_arbint(a, b);
+	mu_assert("arbint_mul_arbint: -(2^64-1) * -(2^64-1) failed", arbint_eq(result, c));
+	arbint_free(result);
+
+	arbint_reset(b);
+	result = arbint_mul_arbint(a, b);
+	mu_assert("arbint_mul_arbint: x * 0 != 0", arbint_is_zero(result));
+	arbint_free(result);
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(c);
+
+	// Sizes that go through schoolbook, Karatsuba, Toom-3 and NTT, balanced and
+	// not
+	size_t sizes[][2] = {{5, 3},     {40, 40},    {77, 45},    {300, 300},
+	                     {451, 130}, {97, 500},   {1200, 1100}, {2500, 1000}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		a       = random_arbint(sizes[i][0]);
+		b       = random_arbint(sizes[i][1]);
+		b->sign = NEGATIVE;
+
+		c      = reference_mul(a, b);
+		result = arbint_mul_arbint(a, b);
+		mu_assert("arbint_mul_arbint differs from schoolbook multiplication",
+		          arbint_eq(result, c));
+
+		// Multiply into one of the operands
+		arbint_mul_arbint_into(b, a, b);
+		mu_assert("arbint_mul_arbint_into with result == b failed", arbint_eq(b, c));
+
+		arbint_free(a);
+		arbint_free(b);
+		arbint_free(c);
+		arbint_free(result);
+	}
+
+	return 0;
+}
+
+static char*
+test_arbint_sqr()
+{
+	arbint a = arbint_new();
+	arbint c = arbint_new();
+
+	str_to_arbint("-18446744073709551615", a, 10);
+	str_to_arbint("340282366920938463426481119284349108225", c, 10);
+	arbint result = arbint_sqr(a);
+	mu_assert("arbint_sqr: (-(2^64-1))^2 failed", arbint_eq(result, c));
+	arbint_free(result);
+
+	arbint_reset(a);
+	result = arbint_sqr(a);
+	mu_assert("arbint_sqr: 0^2 != 0", arbint_is_zero(result));
+	arbint_free(result);
+
+	arbint_free(a);
+	arbint_free(c);
+
+	// Basecase, Karatsuba, Toom-3 and NTT squaring against multiplication
+	size_t sizes[] = {1, 7, 60, 200, 400, 1300};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		a      = random_arbint(sizes[i]);
+		c      = arbint_mul_arbint(a, a);
+		result = arbint_sqr(a);
+		mu_assert("arbint_sqr differs from arbint_mul_arbint(a, a)",
+		          arbint_eq(result, c));
+
+		arbint_sqr_into(a, a);
+		mu_assert("arbint_sqr_into with result == a failed", arbint_eq(a, c));
+
+		arbint_free(a);
+		arbint_free(c);
+		arbint_free(result);
+	}
+
+	return 0;
+}
+
 static char*
 test_str_mul_eq()
 {
@@ -296,17 +625,19 @@ test_str_mul_eq()
 static char*
 test_u64_to_arbint()
 {
+	const uint32_t digits[] = {2096159726, 2123};
+
 	// Test uninitialised
 	arbint a = arbint_new();
 	u64_to_arbint(9120311729134, a);
-	mu_assert("u64_to_arbint failed (1)", a->length == 2 && a->value[0] == 2096159726 &&
-	                                          a->value[1] == 2123 && a->sign == POSITIVE);
+	mu_assert("u64_to_arbint failed (1)",
+	          has_u32_digits(a, digits, 2) && a->sign == POSITIVE);
 
 	// Test initialised
 	arbint b = arbint_new_empty();
 	u64_to_arbint(9120311729134, b);
-	mu_assert("u64_to_arbint failed (2)", b->length == 2 && b->value[0] == 2096159726 &&
-	                                          b->value[1] == 2123 && b->sign == POSITIVE);
+	mu_assert("u64_to_arbint failed (2)",
+	          has_u32_digits(b, digits, 2) && b->sign == POSITIVE);
 
 	// Test with 2^32 - 1
 	arbint c = arbint_new();
@@ -317,33 +648,106 @@ test_u64_to_arbint()
 	// Test with 2^64 - 1
 	arbint d = arbint_new();
 	u64_to_arbint(UINT64_MAX, d);
-	mu_assert("u64_to_arbint with UINT64_MAX failed",
-	          d->length == 2 && d->value[0] == UINT32_MAX && d->value[1] == UINT32_MAX);
+	const uint32_t max_digits[] = {UINT32_MAX, UINT32_MAX};
+	mu_assert("u64_to_arbint with UINT64_MAX failed", has_u32_digits(d, max_digits, 2));
+
+	// Over a value on the heap, which is released instead of leaked
+	arbint e = random_arbint(10);
+	u64_to_arbint(9120311729134, e);
+	mu_assert("u64_to_arbint over a long value failed",
+	          has_u32_digits(e, digits, 2) && arbint_value_is_inline(e));
 
 	arbint_free(a);
 	arbint_free(b);
 	arbint_free(c);
 	arbint_free(d);
+	arbint_free(e);
 
 	return 0;
 }
 
+static char*
+test_inline_values()
+{
+	// An arbint on the stack, which lives inside its struct until it grows
+	// beyond ARBINT_INLINE_LIMBS digits, and moves back when it's trimmed
+	arbint_struct x;
+	arbint_init(&x);
+	mu_assert("arbint_init: value isn't inline", arbint_value_is_inline(&x));
+	mu_assert("arbint_init: value isn't 0", arbint_is_zero(&x) && x.sign == POSITIVE);
+
+	for (size_t i = 0; i < 3 * ARBINT_INLINE_LIMBS; i++)
+	{
+		add_to_arbint(&x, LIMB_MAX, i);
+		mu_assert("add_to_arbint: value moved too early",
+		          arbint_value_is_inline(&x) == (x.length <= ARBINT_INLINE_LIMBS));
+	}
+	arbint copy = arbint_copy(&x);
+	mu_assert("arbint_copy: wrong value", arbint_eq(copy, &x));
+	arbint_set_zero(&x);
+	x.value[0] = 1;
+	arbint_trim(&x);
+	mu_assert("arbint_trim: value didn't move back", arbint_value_is_inline(&x));
+	mu_assert("arbint_trim: wrong value", x.length == 1 && x.value[0] == 1);
+	arbint_free_value(&x);
+
+	// The single-limb fast paths of addition and comparison, with carries,
+	// borrows, zeros and both signs, against the general paths for the same
+	// numbers times 2^LIMB_BITS
+	limb_t values[]  = {0, 1, 2, LIMB_MAX - 1, LIMB_MAX};
+	arbint a         = arbint_new();
+	arbint b         = arbint_new();
+	arbint a_shifted = arbint_new();
+	arbint b_shifted = arbint_new();
+	arbint result    = arbint_new();
+	arbint expected  = arbint_new();
+	for (size_t i = 0; i < 4 * 5 * 5; i++)
+	{
+		a->value[0] = values[i % 5];
+		b->value[0] = values[i / 5 % 5];
+		a->sign     = i / 25 % 2 ? NEGATIVE : POSITIVE;
+		b->sign     = i / 50 % 2 ? NEGATIVE : POSITIVE;
+		arbint_shl(a_shifted, a, LIMB_BITS);
+		arbint_shl(b_shifted, b, LIMB_BITS);
+		mu_assert("arbint_cmp: wrong result for single limbs",
+		          arbint_cmp(a, b) == arbint_cmp(a_shifted, b_shifted));
+
+		arbint_add_into(result, a, b);
+		arbint_shl(result, result, LIMB_BITS);
+		arbint_add_into(expected, a_shifted, b_shifted);
+		mu_assert("arbint_add_into: wrong result for single limbs",
+		          arbint_eq(result, expected) && result->sign == expected->sign);
+		arbint_sub_into(result, a, b);
+		arbint_shl(result, result, LIMB_BITS);
+		arbint_sub_into(expected, a_shifted, b_shifted);
+		mu_assert("arbint_sub_into: wrong result for single limbs",
+		          arbint_eq(result, expected) && result->sign == expected->sign);
+	}
+
+	arbint_free(copy);
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(a_shifted);
+	arbint_free(b_shifted);
+	arbint_free(result);
+	arbint_free(expected);
+	return 0;
+}
+
 static char*
 test_arbint_copy()
 {
+	const uint32_t digits[] = {313953885, 3019150336, 3284471345, 2609588367, 2328};
+
 	arbint a = arbint_new();
 	str_to_arbint("+792384103083241340432014773910347139419741", a, 10);
 	mu_assert("str_to_arbint in test_arbint_copy failed",
-	          a->value[0] == 313953885 && a->value[1] == 3019150336 &&
-	              a->value[2] == 3284471345 && a->value[3] == 2609588367 &&
-	              a->value[4] == 2328 && a->length == 5 && a->sign == POSITIVE);
+	          has_u32_digits(a, digits, 5) && a->sign == POSITIVE);
 
 	arbint b = arbint_copy(a);
 
 	mu_assert("arbint_copy changed values",
-	          b->value[0] == 313953885 && b->value[1] == 3019150336 &&
-	              b->value[2] == 3284471345 && b->value[3] == 2609588367 &&
-	              b->value[4] == 2328 && b->length == 5 && b->sign == POSITIVE);
+	          has_u32_digits(b, digits, 5) && b->sign == POSITIVE);
 
 	mu_assert("arbint_copy returned same pointer instead of copying",
 	          b->value != a->value);
@@ -356,7 +760,8 @@ test_set_zero_and_reset()
 {
 	arbint a = arbint_new();
 	str_to_arbint("7777777777777777777777", a, 10);
-	mu_assert("str_to_arbint in test_set_zero_and_reset failed", a->length == 3);
+	mu_assert("str_to_arbint in test_set_zero_and_reset failed",
+	          a->length == LIMBS_FOR_U32(3));
 
 	arbint_set_zero(a);
 	mu_assert("arbint_set_zero did not set arbint to zero", arbint_is_zero(a));
@@ -367,6 +772,133 @@ test_set_zero_and_reset()
 	return 0;
 }
 
+// Memory functions that keep track of the bytes that are allocated
+static size_t allocated_bytes  = 0;
+static size_t allocation_calls = 0;
+
+static void*
+counting_alloc(size_t size)
+{
+	allocated_bytes += size;
+	allocation_calls++;
+	return malloc(size);
+}
+
+static void*
+counting_realloc(void* ptr, size_t old_size, size_t new_size)
+{
+	allocated_bytes += new_size - old_size;
+	allocation_calls++;
+	return realloc(ptr, new_size);
+}
+
+static void
+counting_free(void* ptr, size_t size)
+{
+	allocated_bytes -= size;
+	free(ptr);
+}
+
+static arbint
+power_of(uint32_t base, size_t exponent)
+{
+	arbint power    = arbint_new();
+	power->value[0] = 1;
+	for (size_t i = 0; i < exponent; i++)
+	{
+		arbint_mul(power, base);
+	}
+	return power;
+}
+
+static char*
+test_memory_functions()
+{
+	arbint_set_memory_functions(counting_alloc, counting_realloc, counting_free);
+	arbint_alloc_function alloc_function;
+	arbint_free_function free_function;
+	arbint_get_memory_functions(&alloc_function, NULL, &free_function);
+	mu_assert("arbint_get_memory_functions: wrong functions",
+	          alloc_function == counting_alloc && free_function == counting_free);
+
+	// Everything is given back with the sizes it was allocated with
+	arbint a       = power_of(3, 3000);
+	arbint b       = power_of(7, 2000);
+	arbint product = arbint_mul_arbint(a, b);
+	arbint g       = arbint_new();
+	arbint_gcd(g, product, b);
+	char* str;
+	arbint_to_str(product, &str, 10);
+	str_to_arbint(str, a, 10);
+	free(str);
+	mu_assert("arbint_set_memory_functions: wrong gcd", arbint_eq(g, b));
+	mu_assert("arbint_set_memory_functions: functions not called", allocation_calls > 0);
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(product);
+	arbint_free(g);
+	mu_assert("arbint_set_memory_functions: wrong sizes", allocated_bytes == 0);
+
+	arbint_set_memory_functions(NULL, NULL, NULL);
+	arbint_get_memory_functions(&alloc_function, NULL, NULL);
+	mu_assert("arbint_set_memory_functions: not reset", alloc_function != counting_alloc);
+	return 0;
+}
+
+static char*
+test_arena()
+{
+	arbint a        = power_of(3, 3000);
+	arbint b        = power_of(7, 2000);
+	arbint expected = arbint_mul_arbint(a, b);
+	arbint_set_memory_functions(counting_alloc, counting_realloc, counting_free);
+	allocation_calls = 0;
+
+	arbint_arena arena = arbint_arena_new();
+	for (int run = 0; run < 2; run++)
+	{
+		// The same computation twice, where the second one doesn't need any
+		// more chunks
+		size_t calls = allocation_calls;
+		mu_assert("arbint_arena_use: arena already in use",
+		          arbint_arena_use(arena) == NULL);
+		arbint product = arbint_mul_arbint(a, b);
+		arbint g       = arbint_new();
+		arbint_gcd(g, product, a);
+		mu_assert("arena: wrong product", arbint_eq(product, expected));
+		mu_assert("arena: wrong gcd", arbint_eq(g, a));
+		mu_assert("arena: value not aligned to a cache line",
+		          (uintptr_t) product->value % ARBINT_ARENA_CACHE_LINE == 0);
+		if (run == 1)
+		{
+			mu_assert("arbint_arena_release: chunks not reused",
+			          allocation_calls == calls);
+		}
+
+		// Memory from outside the arena goes back to the memory functions
+		// when it's reallocated
+		arbint_arena_use(NULL);
+		arbint outside = arbint_new_length(2 * ARBINT_INLINE_LIMBS);
+		arbint_arena_use(arena);
+		arbint_mul_arbint_into(outside, a, b);
+		mu_assert("arena: wrong product into an outside arbint",
+		          arbint_eq(outside, expected));
+		arbint_free(outside);
+		mu_assert("arbint_arena_use: wrong arena", arbint_arena_use(NULL) == arena);
+		arbint_arena_release(arena);
+	}
+	mu_assert("arbint_arena_size: wrong size",
+	          arbint_arena_size(arena) == allocated_bytes);
+	arbint_arena_free(arena);
+	mu_assert("arbint_arena_free: memory not given back", allocated_bytes == 0);
+
+	arbint_set_memory_functions(NULL, NULL, NULL);
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(expected);
+	return 0;
+}
+
 static char*
 test_arbint_add()
 {
@@ -500,6 +1032,456 @@ test_arbint_sub()
 	return 0;
 }
 
+static char*
+test_into_functions()
+{
+	arbint a = arbint_new();
+	arbint b = arbint_new();
+	arbint c = arbint_new();
+
+	mu_assert("arbint_add_size: 0 + 0 needs != 1 digit", arbint_add_size(a, b) == 1);
+	mu_assert("arbint_mul_size: 0 * 0 needs != 1 digit", arbint_mul_size(a, b) == 1);
+
+	str_to_arbint("-4000000000000000000000", a, 10);
+	mu_assert("arbint_add_size: wrong size",
+	          arbint_add_size(a, b) == LIMBS_FOR_U32(3) + 1);
+	mu_assert("arbint_sqr_size: wrong size", arbint_sqr_size(a) == 2 * LIMBS_FOR_U32(3));
+
+	// A result that is large enough is reused without reallocating it
+	size_t sizes[][2] = {{1, 1}, {3, 7}, {20, 20}, {64, 5}, {2, 100}};
+	arbint sum        = arbint_new_length(102);
+	arbint difference = arbint_new_length(102);
+	limb_t* buffer    = sum->value;
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint_free(a);
+		arbint_free(b);
+		a       = random_arbint(sizes[i][0]);
+		b       = random_arbint(sizes[i][1]);
+		a->sign = i % 2 ? NEGATIVE : POSITIVE;
+		b->sign = i % 3 ? POSITIVE : NEGATIVE;
+
+		arbint_add_into(sum, a, b);
+		mu_assert("arbint_add_into reallocated a large enough result",
+		          sum->value == buffer && sum->capacity == 102);
+
+		arbint_sub_into(difference, sum, b);
+		mu_assert("arbint_sub_into: (a + b) - b != a", arbint_eq(difference, a));
+
+		arbint_sub_into(difference, b, sum);
+		arbint_neg(difference);
+		mu_assert("arbint_sub_into: b - (a + b) != -a", arbint_eq(difference, a));
+
+		// result == a and result == b
+		arbint_free(c);
+		c = arbint_copy(a);
+		arbint_add_into(c, c, b);
+		mu_assert("arbint_add_into with result == a failed", arbint_eq(c, sum));
+		arbint_sub_into(b, c, b);
+		mu_assert("arbint_sub_into with result == b failed", arbint_eq(b, a));
+	}
+
+	// a - a = 0, with all three the same arbint
+	arbint_sub_into(a, a, a);
+	mu_assert("arbint_sub_into: a - a != 0", arbint_is_zero(a) && a->sign == POSITIVE);
+
+	// Multiplying by 0 keeps the value array of the result
+	arbint_mul_arbint_into(sum, a, b);
+	mu_assert("arbint_mul_arbint_into: x * 0 != 0", arbint_is_zero(sum));
+	mu_assert("arbint_mul_arbint_into reallocated for x * 0", sum->value == buffer);
+
+	arbint_add_primitive_into(sum, b, b);
+	arbint_neg(b);
+	arbint_sub_into(difference, b, b);
+	arbint_sub_into(difference, difference, b);
+	arbint_sub_into(difference, difference, b);
+	mu_assert("arbint_add_primitive_into: b + b != -(0 - b - b)",
+	          arbint_eq(sum, difference));
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(c);
+	arbint_free(sum);
+	arbint_free(difference);
+	return 0;
+}
+
+static char*
+test_inplace_functions()
+{
+	// a += b * c and a -= b * c against separate multiplication and addition,
+	// for sizes with and without carries out of a and for all signs
+	size_t sizes[] = {0, 1, 2, 5, 40};
+	size_t count   = sizeof(sizes) / sizeof(sizes[0]);
+	arbint product = arbint_new();
+	arbint sum     = arbint_new();
+	arbint a       = arbint_new();
+	bool correct   = true;
+	for (size_t i = 0; i < count * count * count * 4; i++)
+	{
+		size_t an = sizes[i % count];
+		size_t bn = sizes[i / count % count];
+		size_t cn = sizes[i / count / count % count];
+		arbint b  = bn ? random_arbint(bn) : arbint_new();
+		arbint c  = cn ? random_arbint(cn) : arbint_new();
+		arbint_free(a);
+		a       = an ? random_arbint(an) : arbint_new();
+		a->sign = i % 2 && an ? NEGATIVE : POSITIVE;
+		b->sign = i % 3 && bn ? NEGATIVE : POSITIVE;
+		c->sign = i / 2 % 3 && cn ? NEGATIVE : POSITIVE;
+
+		arbint_mul_arbint_into(product, b, c);
+		arbint_add_into(sum, a, product);
+		arbint_addmul(a, b, c);
+		correct = correct && arbint_eq(a, sum);
+
+		arbint_sub_into(sum, a, product);
+		arbint_sub_into(sum, sum, product);
+		arbint_submul(a, b, c);
+		arbint_submul(a, c, b);
+		correct = correct && arbint_eq(a, sum);
+
+		// With a single-digit factor
+		limb_t digit = i % 4 == 3 ? LIMB_MAX : c->value[0];
+		arbint_mul_arbint_into(product, b, c);
+		arbint_mul_arbint_into(product, product, c);
+		arbint_add_into(sum, a, b);
+		arbint_addmul_ui(a, b, 1);
+		arbint_addmul_ui(a, b, digit);
+		arbint_submul_ui(a, b, digit);
+		correct = correct && arbint_eq(a, sum);
+
+		arbint_free(b);
+		arbint_free(c);
+	}
+	mu_assert("arbint_addmul/submul: wrong result", correct);
+
+	// The accumulator may also be a factor
+	arbint_set_zero(a);
+	add_to_arbint(a, 3, 0);
+	arbint b = arbint_copy(a);
+	arbint_addmul(a, a, a);
+	arbint_submul_ui(b, b, 5);
+	mu_assert("arbint_addmul with a == b == c: 3 + 3 * 3 != 12",
+	          a->length == 1 && a->value[0] == 12 && a->sign == POSITIVE);
+	mu_assert("arbint_submul_ui with a == b: 3 - 3 * 5 != -12",
+	          b->length == 1 && b->value[0] == 12 && b->sign == NEGATIVE);
+
+	// Adding small numbers to a full accumulator only grows it for a carry
+	// out of its top digit
+	arbint_free(a);
+	a = random_arbint(30);
+	arbint_trim(a);
+	a->value[29]   = LIMB_MAX - 1;
+	limb_t* buffer = a->value;
+	arbint_set_zero(b);
+	add_to_arbint(b, LIMB_MAX, 0);
+	arbint_add_inplace(a, b);
+	arbint_sub_inplace(a, b);
+	arbint_addmul_ui(a, b, 1000);
+	mu_assert("arbint_add_inplace: reallocated without a carry",
+	          a->value == buffer && a->capacity == 30);
+	arbint_shl(b, b, 29 * LIMB_BITS);
+	arbint_add_inplace(a, b);
+	mu_assert("arbint_add_inplace: didn't grow for a carry",
+	          a->length == 31 && a->value[30] == 1);
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(product);
+	arbint_free(sum);
+	return 0;
+}
+
+static char*
+test_arbint_sum_and_dot()
+{
+	// Enough terms to be split over several threads, of different lengths and
+	// signs, with the sums from arbint_add_inplace and arbint_addmul to compare
+	size_t n   = 10000;
+	arbint* a  = malloc(n * sizeof(arbint));
+	arbint* b  = malloc(n * sizeof(arbint));
+	arbint sum = arbint_new();
+	arbint dot = arbint_new();
+	for (size_t i = 0; i < n; i++)
+	{
+		a[i]       = i % 7 ? random_arbint(i % 5 + 1) : arbint_new();
+		b[i]       = random_arbint(i % 3 * 20 + 1);
+		a[i]->sign = i % 3 && !arbint_is_zero(a[i]) ? NEGATIVE : POSITIVE;
+		b[i]->sign = i % 4 ? POSITIVE : NEGATIVE;
+		arbint_add_inplace(sum, a[i]);
+		arbint_addmul(dot, a[i], b[i]);
+	}
+
+	size_t threads[] = {1, 2, 3, 8};
+	bool correct     = true;
+	for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+	{
+		arbint_set_threads(threads[i]);
+		arbint result = arbint_sum(a, n);
+		correct       = correct && arbint_eq(result, sum);
+		arbint_dot_into(result, a, b, n);
+		correct = correct && arbint_eq(result, dot);
+		arbint_free(result);
+	}
+	mu_assert("arbint_sum/arbint_dot: wrong result", correct);
+
+	// No terms, and a result that is one of the terms
+	arbint_dot_into(sum, a, b, 0);
+	mu_assert("arbint_dot: empty sum isn't 0", arbint_is_zero(sum));
+	arbint_add_into(sum, b[0], b[1]);
+	arbint_add_into(sum, sum, b[2]);
+	arbint_sum_into(b[1], b, 3);
+	mu_assert("arbint_sum_into with result in the terms failed", arbint_eq(b[1], sum));
+
+	arbint_set_threads(1);
+	for (size_t i = 0; i < n; i++)
+	{
+		arbint_free(a[i]);
+		arbint_free(b[i]);
+	}
+	free(a);
+	free(b);
+	arbint_free(sum);
+	arbint_free(dot);
+	return 0;
+}
+
+static char*
+test_products()
+{
+	// Product trees against multiplying the factors one by one, with the
+	// halves on different threads and factors of very different lengths
+	size_t n        = 60;
+	arbint* factors = malloc(n * sizeof(arbint));
+	limb_t* digits  = malloc(n * sizeof(limb_t));
+	arbint expected = arbint_new();
+	arbint result   = arbint_new();
+	add_to_arbint(expected, 1, 0);
+	for (size_t i = 0; i < n; i++)
+	{
+		factors[i]       = random_arbint(i % 10 ? i % 4 + 1 : 400);
+		factors[i]->sign = i % 3 ? POSITIVE : NEGATIVE;
+		digits[i]        = factors[i]->value[0];
+		arbint_mul_arbint_into(expected, expected, factors[i]);
+	}
+	for (size_t threads = 1; threads <= 4; threads += 3)
+	{
+		arbint_set_threads(threads);
+		arbint_product(result, factors, n);
+		mu_assert("arbint_product: wrong result", arbint_eq(result, expected));
+	}
+	arbint_set_threads(1);
+	arbint_mul_arbint_into(expected, factors[0], factors[1]);
+	arbint_product(factors[1], factors, 2);
+	mu_assert("arbint_product with result in the factors failed",
+	          arbint_eq(factors[1], expected));
+
+	arbint_set_zero(expected);
+	add_to_arbint(expected, 1, 0);
+	for (size_t i = 0; i < n; i++)
+	{
+		arbint_set_zero(result);
+		arbint_addmul_ui(result, expected, digits[i]);
+		arbint_swap(result, expected);
+	}
+	arbint_product_ui(result, digits, n);
+	mu_assert("arbint_product_ui: wrong result", arbint_eq(result, expected));
+	arbint_product_ui(result, digits, 0);
+	mu_assert("arbint_product_ui: empty product isn't 1",
+	          result->length == 1 && result->value[0] == 1);
+	digits[n / 2] = 0;
+	arbint_product_ui(result, digits, n);
+	mu_assert("arbint_product_ui: product with 0 isn't 0", arbint_is_zero(result));
+
+	// Enough digits for several threads
+	arbint many = random_arbint(3000);
+	arbint_product_ui(expected, many->value, many->length);
+	arbint_set_threads(4);
+	arbint_product_ui(result, many->value, many->length);
+	arbint_set_threads(1);
+	mu_assert("arbint_product_ui: wrong result with threads",
+	          arbint_eq(result, expected));
+	arbint_free(many);
+
+	// n! against multiplying 1..n, on both sides of the base case
+	arbint_set_zero(expected);
+	add_to_arbint(expected, 1, 0);
+	bool correct = true;
+	for (uint32_t k = 0; k <= 3000; k++)
+	{
+		if (k)
+			arbint_mul(expected, k);
+		if (k <= 100 || k % 997 == 0 || k == 3000)
+		{
+			arbint_fac_ui(result, k);
+			correct = correct && arbint_eq(result, expected);
+		}
+	}
+	mu_assert("arbint_fac_ui: wrong result", correct);
+
+	// n choose k as n! / (k! (n - k)!), both as a quotient and from primes,
+	// and for a large n with a small k
+	limb_t binomials[][2] = {{0, 0}, {5, 7}, {10, 3}, {100, 50}, {1000, 7},
+	                         {1000, 300}, {1000, 997}, {777, 1}, {2, 1}};
+	arbint numerator      = arbint_new();
+	arbint denominator    = arbint_new();
+	arbint remainder      = arbint_new();
+	for (size_t i = 0; i < sizeof(binomials) / sizeof(binomials[0]); i++)
+	{
+		limb_t bn = binomials[i][0];
+		limb_t bk = binomials[i][1];
+		arbint_bin_uiui(result, bn, bk);
+		arbint_set_zero(expected);
+		if (bk <= bn)
+		{
+			arbint_fac_ui(numerator, bn);
+			arbint_fac_ui(denominator, bk);
+			arbint_fac_ui(remainder, bn - bk);
+			arbint_mul_arbint_into(denominator, denominator, remainder);
+			arbint_divmod(expected, remainder, numerator, denominator);
+		}
+		correct = correct && arbint_eq(result, expected);
+	}
+	limb_t large     = ((limb_t) 1 << (LIMB_BITS - 1)) + 11;
+	limb_t falling[] = {large, large - 1, large - 2};
+	arbint_product_ui(numerator, falling, 3);
+	arbint_divmod_ui(expected, numerator, 6);
+	arbint_bin_uiui(result, large, 3);
+	correct = correct && arbint_eq(result, expected);
+	mu_assert("arbint_bin_uiui: wrong result", correct);
+
+	// Primorials against trial division
+	arbint_primorial_ui(result, 30);
+	str_to_arbint("6469693230", expected, 10);
+	mu_assert("arbint_primorial_ui: 30# != 6469693230", arbint_eq(result, expected));
+	arbint_set_zero(expected);
+	add_to_arbint(expected, 1, 0);
+	for (uint32_t p = 2; p <= 2000; p++)
+	{
+		bool prime = true;
+		for (uint32_t d = 2; d * d <= p && prime; d++)
+			prime = p % d != 0;
+		if (prime)
+			arbint_mul(expected, p);
+	}
+	arbint_primorial_ui(result, 2000);
+	mu_assert("arbint_primorial_ui: wrong result", arbint_eq(result, expected));
+	arbint_primorial_ui(result, 1);
+	mu_assert("arbint_primorial_ui: 1# != 1",
+	          result->length == 1 && result->value[0] == 1);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		arbint_free(factors[i]);
+	}
+	free(factors);
+	free(digits);
+	arbint_free(expected);
+	arbint_free(result);
+	arbint_free(numerator);
+	arbint_free(denominator);
+	arbint_free(remainder);
+	return 0;
+}
+
+static char*
+test_threaded_multiplication()
+{
+	// Products and squares on several threads against the ones on a single
+	// thread, with a low threshold so that every algorithm splits its work:
+	// Karatsuba, Toom-3, long operands by pieces of the short one, and NTT
+	size_t sizes[][2] = {{100, 100},  {120, 70},  {700, 700},   {900, 333},
+	                     {5000, 200}, {4001, 33}, {3000, 3000}, {20001, 7777}};
+	arbint product    = arbint_new();
+	arbint square     = arbint_new();
+	arbint result     = arbint_new();
+	bool correct      = true;
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint a = random_arbint(sizes[i][0]);
+		arbint b = random_arbint(sizes[i][1]);
+		for (size_t threads = 1; threads <= 4; threads += 3)
+		{
+			arbint_set_threads(threads);
+			arbint_set_thread_threshold(threads == 1 ? ARBINT_THREAD_THRESHOLD : 64);
+			arbint_mul_arbint_into(result, a, b);
+			if (threads == 1)
+				arbint_copy_into(product, result);
+			correct = correct && arbint_eq(result, product);
+
+			arbint_sqr_into(result, a);
+			if (threads == 1)
+				arbint_copy_into(square, result);
+			correct = correct && arbint_eq(result, square);
+		}
+		arbint_free(a);
+		arbint_free(b);
+	}
+	mu_assert("threaded multiplication: wrong result", correct);
+
+	arbint_set_threads(1);
+	arbint_set_thread_threshold(ARBINT_THREAD_THRESHOLD);
+	arbint_free(product);
+	arbint_free(square);
+	arbint_free(result);
+	return 0;
+}
+
+static char*
+test_threaded_arena()
+{
+	// Tasks that a thread with an arena runs while it waits, and blocks they
+	// hand to other threads, must not mix up the arena and the memory
+	// functions. The low threshold splits the NTT multiplications of the
+	// factorials and the product tree over the threads.
+	size_t n           = 64;
+	arbint* factorials = malloc(n * sizeof(arbint));
+	arbint expected[3];
+	for (size_t i = 0; i < n; i++)
+	{
+		factorials[i] = arbint_new();
+		arbint_fac_ui(factorials[i], 3000 + 37 * i);
+	}
+	for (size_t i = 0; i < 3; i++)
+	{
+		expected[i] = arbint_new();
+	}
+	arbint_fac_ui(expected[0], 20000);
+	arbint_product(expected[1], factorials, n);
+	arbint_mul_arbint_into(expected[1], expected[0], expected[1]);
+	arbint_sum_into(expected[2], factorials, n);
+
+	arbint_arena arena = arbint_arena_new();
+	arbint_set_threads(8);
+	arbint_set_thread_threshold(64);
+	arbint_arena_use(arena);
+	arbint factorial = arbint_new();
+	arbint product   = arbint_new();
+	arbint_fac_ui(factorial, 20000);
+	arbint_product(product, factorials, n);
+	arbint sum = arbint_sum(factorials, n);
+	arbint_mul_arbint_into(product, factorial, product);
+	bool correct = arbint_eq(factorial, expected[0]) && arbint_eq(product, expected[1])
+	            && arbint_eq(sum, expected[2]);
+	arbint_arena_use(NULL);
+	arbint_arena_free(arena);
+	arbint_set_threads(1);
+	arbint_set_thread_threshold(ARBINT_THREAD_THRESHOLD);
+	mu_assert("threads with an arena: wrong result", correct);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		arbint_free(factorials[i]);
+	}
+	for (size_t i = 0; i < 3; i++)
+	{
+		arbint_free(expected[i]);
+	}
+	free(factorials);
+	return 0;
+}
+
 static char*
 test_arbint_to_hex()
 {
@@ -531,23 +1513,994 @@ test_arbint_to_hex()
 	          !strcmp(*result, "-DEADBEEFDEADBEEFDEADBEEFDEADBEEF"));
 	free(*result);
 
+	// Every hex digit, in a full limb and in the top limb
+	str_to_arbint("FEDCBA9876543210123456789abcdef0123", a, 16);
+	arbint_to_hex(a, result);
+	mu_assert("arbint_to_hex failed (all hex digits)",
+	          !strcmp(*result, "FEDCBA9876543210123456789ABCDEF0123"));
+	free(*result);
+
+	arbint_set_zero(a);
+	a->sign = NEGATIVE;
+	arbint_to_hex(a, result);
+	mu_assert("arbint_to_hex failed (0)", !strcmp(*result, "0"));
+	free(*result);
+
+	// Into a buffer of the exact size, with random numbers, one of which loses
+	// its top limb
+	char buffer[200];
+	for (size_t length = 1; length <= 8; length++)
+	{
+		arbint b = random_arbint(length);
+		arbint c = arbint_new();
+		b->sign  = length % 2 ? NEGATIVE : POSITIVE;
+		if (length == 8)
+		{
+			b->value[7] = 0;
+			arbint_normalize(b, 8);
+		}
+
+		size_t size = arbint_to_hex_size(b);
+		memset(buffer, 'x', sizeof(buffer));
+		size_t written = arbint_to_hex_into(b, buffer);
+		mu_assert("arbint_to_hex_into: wrong length or size",
+		          written == strlen(buffer) && size == written + 1);
+		mu_assert("arbint_to_hex_into wrote past the buffer", buffer[size] == 'x');
+		str_to_arbint(buffer, c, 16);
+		mu_assert("arbint_to_hex_into doesn't parse back to the same number",
+		          arbint_eq(b, c));
+
+		arbint_free(b);
+		arbint_free(c);
+	}
+
 	arbint_free(a);
 	free(result);
 	return 0;
 }
 
+static char*
+test_arbint_divmod_ui()
+{
+	// Divisors around the limit of the four limb folding in limbs_mod_1 and
+	// at both ends of the limb range
+	const limb_t divisors[] = {1, 2, 3, 10, 1000000007, UINT32_MAX, MOD_1_FOLD_LIMIT - 1,
+	                           MOD_1_FOLD_LIMIT, LIMB_MAX / 3 * 2,
+	                           (limb_t) 1 << (LIMB_BITS - 1), LIMB_MAX};
+	size_t lengths[]        = {1, 2, 3, 4, 5, 6, 7, 50};
+
+	for (size_t i = 0; i < sizeof(divisors) / sizeof(divisors[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(lengths) / sizeof(lengths[0]); j++)
+		{
+			limb_t divisor = divisors[i];
+			size_t length  = lengths[j];
+			arbint a       = random_arbint(length);
+			arbint q       = arbint_new();
+			a->sign        = j % 2 ? NEGATIVE : POSITIVE;
+
+			// a = q * divisor + r with |r| < divisor and q rounded towards 0
+			limb_t r      = arbint_divmod_ui(q, a, divisor);
+			limb_t* check = malloc((length + 1) * sizeof(limb_t));
+			check[length] = limbs_mul_1(check, q->value, length, divisor);
+			check[length] += limbs_add_1(check, check, length, r);
+			mu_assert("arbint_divmod_ui: q * divisor + r isn't a",
+			          limbs_cmp(check, a->value, length) == 0 && check[length] == 0);
+			mu_assert("arbint_divmod_ui: remainder too large", r < divisor);
+			mu_assert("arbint_divmod_ui: quotient has the wrong sign",
+			          q->sign == a->sign || arbint_is_zero(q));
+
+			limb_t mod = arbint_mod_ui(a, divisor);
+			mu_assert("arbint_mod_ui differs from arbint_divmod_ui",
+			          mod == (a->sign == NEGATIVE && r ? divisor - r : r));
+
+			// In place
+			arbint_divmod_ui(a, a, divisor);
+			mu_assert("arbint_divmod_ui: in place division differs", arbint_eq(a, q));
+
+			free(check);
+			arbint_free(a);
+			arbint_free(q);
+		}
+	}
+	return 0;
+}
+
+static char*
+test_arbint_divmod()
+{
+	arbint a = arbint_new();
+	arbint b = arbint_new();
+	arbint q = arbint_new();
+	arbint r = arbint_new();
+
+	// Rounding towards zero for all sign combinations: (+-7) / (+-2)
+	const char* cases[][4] = {{"7", "2", "3", "1"},
+	                          {"-7", "2", "-3", "-1"},
+	                          {"7", "-2", "-3", "1"},
+	                          {"-7", "-2", "3", "-1"}};
+	arbint expected_q      = arbint_new();
+	arbint expected_r      = arbint_new();
+	for (size_t i = 0; i < 4; i++)
+	{
+		str_to_arbint((char*) cases[i][0], a, 10);
+		str_to_arbint((char*) cases[i][1], b, 10);
+		str_to_arbint((char*) cases[i][2], expected_q, 10);
+		str_to_arbint((char*) cases[i][3], expected_r, 10);
+		arbint_divmod(q, r, a, b);
+		mu_assert("arbint_divmod: wrong quotient or remainder for small numbers",
+		          arbint_eq(q, expected_q) && arbint_eq(r, expected_r));
+	}
+	arbint_free(expected_q);
+	arbint_free(expected_r);
+
+	// |a| < |b| and a == 0
+	str_to_arbint("-123456789012345678901234567890", a, 10);
+	str_to_arbint("123456789012345678901234567891", b, 10);
+	arbint_divmod(q, r, a, b);
+	mu_assert("arbint_divmod: |a| < |b| failed", arbint_is_zero(q) && arbint_eq(r, a));
+	arbint_set_zero(a);
+	arbint_divmod(q, r, a, b);
+	mu_assert("arbint_divmod: 0 / b failed",
+	          arbint_is_zero(q) && arbint_is_zero(r) && r->sign == POSITIVE);
+
+	// Random numbers of all sizes, including ones that are divided
+	// recursively, and the results written over the operands
+	size_t sizes[][2] = {{1, 1}, {5, 3}, {30, 2}, {200, 100}, {700, 150}, {1000, 999}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint n = random_arbint(sizes[i][0]);
+		arbint d = random_arbint(sizes[i][1]);
+		n->sign  = i % 2 ? NEGATIVE : POSITIVE;
+		d->sign  = i % 3 ? NEGATIVE : POSITIVE;
+
+		arbint_divmod(q, r, n, d);
+		arbint product = arbint_mul_arbint(q, d);
+		arbint sum     = arbint_add(product, r);
+		mu_assert("arbint_divmod: q * b + r isn't a", arbint_eq(sum, n));
+		mu_assert("arbint_divmod: |r| isn't less than |b|",
+		          arbint_highest_digit(r) < arbint_highest_digit(d)
+		              || limbs_cmp(r->value, d->value, sizes[i][1]) < 0);
+		mu_assert("arbint_divmod: remainder has the wrong sign",
+		          r->sign == n->sign || arbint_is_zero(r));
+
+		arbint n_copy = arbint_copy(n);
+		arbint d_copy = arbint_copy(d);
+		arbint_divmod(n, d, n, d);
+		mu_assert("arbint_divmod: in place division differs",
+		          arbint_eq(n, q) && arbint_eq(d, r));
+		arbint_divmod(d_copy, n_copy, n_copy, d_copy);
+		mu_assert("arbint_divmod: swapped in place division differs",
+		          arbint_eq(d_copy, q) && arbint_eq(n_copy, r));
+
+		arbint_free(product);
+		arbint_free(sum);
+		arbint_free(n);
+		arbint_free(d);
+		arbint_free(n_copy);
+		arbint_free(d_copy);
+	}
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(q);
+	arbint_free(r);
+	return 0;
+}
+
+// x mod m between 0 and |m| - 1, computed with a full division
+static void
+reference_mod(arbint result, arbint x, arbint m)
+{
+	arbint quotient = arbint_new();
+	arbint_divmod(quotient, result, x, m);
+	if (result->sign == NEGATIVE && !arbint_is_zero(result))
+	{
+		result->sign = POSITIVE;
+		arbint_sub_into(result, m, result);
+	}
+	arbint_free(quotient);
+}
+
+static char*
+test_arbint_mod_ctx()
+{
+	// Odd moduli use Montgomery form and even ones Barrett reduction. The
+	// largest ones are multiplied with Karatsuba and Toom-3.
+	size_t sizes[]  = {1, 2, 5, 30, 200, 520};
+	arbint a        = arbint_new();
+	arbint b        = arbint_new();
+	arbint result   = arbint_new();
+	arbint expected = arbint_new();
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		for (int odd = 0; odd < 2; odd++)
+		{
+			size_t n = sizes[i];
+			arbint m = random_arbint(n);
+			m->value[n - 1] |= 1;
+			m->value[0] = odd ? m->value[0] | 1 : m->value[0] & ~(limb_t) 1;
+			arbint x    = random_arbint(2 * n + 1);
+			arbint y    = random_arbint(n);
+			x->sign     = NEGATIVE;
+
+			arbint_mod_ctx ctx = arbint_mod_ctx_new(m);
+			mu_assert("arbint_mod_ctx_new: wrong form", ctx->montgomery == odd);
+			arbint_to_mod(a, x, ctx);
+			arbint_to_mod(b, y, ctx);
+
+			// Converting back and forth
+			arbint_from_mod(result, a, ctx);
+			reference_mod(expected, x, m);
+			mu_assert("arbint_to_mod: wrong residue", arbint_eq(result, expected));
+
+			arbint product = arbint_mul_arbint(x, y);
+			arbint_mulmod(result, a, b, ctx);
+			arbint_from_mod(result, result, ctx);
+			reference_mod(expected, product, m);
+			mu_assert("arbint_mulmod: wrong product", arbint_eq(result, expected));
+			arbint_free(product);
+
+			product = arbint_sqr(y);
+			arbint_sqrmod(result, b, ctx);
+			arbint_from_mod(result, result, ctx);
+			reference_mod(expected, product, m);
+			mu_assert("arbint_sqrmod: wrong square", arbint_eq(result, expected));
+			arbint_free(product);
+
+			arbint sum = arbint_add(x, y);
+			arbint_addmod(result, a, b, ctx);
+			arbint_from_mod(result, result, ctx);
+			reference_mod(expected, sum, m);
+			mu_assert("arbint_addmod: wrong sum", arbint_eq(result, expected));
+			arbint_free(sum);
+
+			arbint difference = arbint_sub(y, x);
+			arbint_submod(result, b, a, ctx);
+			arbint_from_mod(result, result, ctx);
+			reference_mod(expected, difference, m);
+			mu_assert("arbint_submod: wrong difference", arbint_eq(result, expected));
+			arbint_free(difference);
+
+			// A chain of operations with the results written over the operands
+			arbint_mulmod(a, a, b, ctx);
+			arbint_sqrmod(a, a, ctx);
+			arbint_from_mod(a, a, ctx);
+			product = arbint_mul_arbint(x, y);
+			reference_mod(expected, product, m);
+			arbint_sqr_into(product, expected);
+			reference_mod(expected, product, m);
+			mu_assert("arbint_mulmod: wrong result in place", arbint_eq(a, expected));
+			arbint_free(product);
+
+			arbint_mod_ctx_free(ctx);
+			arbint_free(m);
+			arbint_free(x);
+			arbint_free(y);
+		}
+	}
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(result);
+	arbint_free(expected);
+	return 0;
+}
+
+// base^exp mod m by binary exponentiation with full divisions
+static void
+reference_powm(arbint result, arbint base, arbint exp, arbint m)
+{
+	arbint square = arbint_new();
+	reference_mod(square, base, m);
+	str_to_arbint("1", result, 10);
+	reference_mod(result, result, m);
+	for (size_t bit = 0; bit < exp->length * LIMB_BITS; bit++)
+	{
+		if ((exp->value[bit / LIMB_BITS] >> (bit % LIMB_BITS)) & 1)
+		{
+			arbint product = arbint_mul_arbint(result, square);
+			reference_mod(result, product, m);
+			arbint_free(product);
+		}
+		arbint product = arbint_sqr(square);
+		reference_mod(square, product, m);
+		arbint_free(product);
+	}
+	arbint_free(square);
+}
+
+static char*
+test_arbint_powm()
+{
+	arbint base     = arbint_new();
+	arbint exp      = arbint_new();
+	arbint m        = arbint_new();
+	arbint result   = arbint_new();
+	arbint expected = arbint_new();
+	arbint one      = arbint_new();
+	str_to_arbint("1", one, 10);
+
+	// Fermat's little theorem for the Mersenne primes 2^127 - 1 and 2^521 - 1
+	const char* primes[] = {"7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+	                        "1FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+	                        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+	                        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"};
+	for (size_t i = 0; i < 2; i++)
+	{
+		str_to_arbint((char*) primes[i], m, 16);
+		str_to_arbint("-123456789", base, 10);
+		arbint_sub_into(exp, m, one);
+		arbint_powm(result, base, exp, m);
+		mu_assert("arbint_powm: a^(p - 1) isn't 1 mod p", arbint_eq(result, one));
+	}
+
+	// Exponent 0 and modulus 1
+	str_to_arbint("0", exp, 10);
+	arbint_powm(result, base, exp, m);
+	mu_assert("arbint_powm: a^0 isn't 1", arbint_eq(result, one));
+	str_to_arbint("1", m, 10);
+	str_to_arbint("5", exp, 10);
+	arbint_powm(result, base, exp, m);
+	mu_assert("arbint_powm: a^b mod 1 isn't 0", arbint_is_zero(result));
+
+	// Random odd and even moduli with exponents of all lengths, so that every
+	// window size up to 7 bits is used
+	size_t sizes[][2] = {{1, 1}, {2, 3}, {3, 1}, {20, 6}, {33, 40}, {1, 25}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		for (int odd = 0; odd < 2; odd++)
+		{
+			arbint_free(m);
+			arbint_free(exp);
+			arbint_free(base);
+			m           = random_arbint(sizes[i][0]);
+			exp         = random_arbint(sizes[i][1]);
+			base        = random_arbint(sizes[i][0] + 1);
+			m->value[0] = odd ? m->value[0] | 1 : m->value[0] & ~(limb_t) 1;
+
+			reference_powm(expected, base, exp, m);
+			arbint_powm(result, base, exp, m);
+			mu_assert("arbint_powm: wrong result", arbint_eq(result, expected));
+			arbint_powm(base, base, exp, m);
+			mu_assert("arbint_powm: wrong result in place", arbint_eq(base, expected));
+		}
+	}
+
+	arbint_free(base);
+	arbint_free(exp);
+	arbint_free(m);
+	arbint_free(result);
+	arbint_free(expected);
+	arbint_free(one);
+	return 0;
+}
+
+static char*
+test_arbint_gcd()
+{
+	arbint a         = arbint_new();
+	arbint b         = arbint_new();
+	arbint g         = arbint_new();
+	arbint s         = arbint_new();
+	arbint t         = arbint_new();
+	arbint quotient  = arbint_new();
+	arbint remainder = arbint_new();
+	arbint expected  = arbint_new();
+
+	// gcd(0, 0) = 0 and gcd(0, -5) = 5 = 0 * 0 + (-1) * (-5)
+	str_to_arbint("0", a, 10);
+	arbint_gcdext(g, s, t, a, a);
+	mu_assert("arbint_gcdext: gcd(0, 0) isn't 0", arbint_is_zero(g));
+	str_to_arbint("-5", b, 10);
+	str_to_arbint("-1", expected, 10);
+	arbint_gcdext(g, s, t, a, b);
+	mu_assert("arbint_gcdext: s isn't 0 for a = 0", arbint_is_zero(s));
+	mu_assert("arbint_gcdext: wrong t for a = 0", arbint_eq(t, expected));
+	arbint_gcd(g, b, a);
+	str_to_arbint("5", expected, 10);
+	mu_assert("arbint_gcd: gcd(-5, 0) isn't 5", arbint_eq(g, expected));
+
+	// Consecutive Fibonacci numbers are coprime, and take the most steps of
+	// all numbers of their size
+	str_to_arbint("1", a, 10);
+	str_to_arbint("1", b, 10);
+	str_to_arbint("1", expected, 10);
+	for (int i = 1; i <= 20000; i++)
+	{
+		arbint_add_into(a, a, b);
+		arbint swap = a;
+		a           = b;
+		b           = swap;
+		if (i % 4000 == 0)
+		{
+			arbint_gcd(g, a, b);
+			mu_assert("arbint_gcd: gcd(F(n + 1), F(n)) isn't 1", arbint_eq(g, expected));
+		}
+	}
+
+	// Random numbers with a common factor c, from the Lehmer steps to the
+	// half-gcd. g divides both numbers and s * a + t * b = g, so any common
+	// divisor divides g, and g is the greatest one.
+	size_t sizes[][3] = {{1, 1, 1}, {2, 1, 1}, {5, 3, 2}, {40, 40, 5}, {200, 150, 30},
+	                     {700, 650, 40}, {600, 20, 1}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint x = random_arbint(sizes[i][0]);
+		arbint y = random_arbint(sizes[i][1]);
+		arbint c = random_arbint(sizes[i][2]);
+		arbint_mul_arbint_into(a, x, c);
+		arbint_mul_arbint_into(b, y, c);
+		a->sign = i % 2 ? NEGATIVE : POSITIVE;
+		b->sign = i % 3 ? POSITIVE : NEGATIVE;
+
+		arbint_gcdext(g, s, t, a, b);
+		arbint_divmod(quotient, remainder, a, g);
+		mu_assert("arbint_gcdext: gcd doesn't divide a", arbint_is_zero(remainder));
+		arbint_divmod(quotient, remainder, b, g);
+		mu_assert("arbint_gcdext: gcd doesn't divide b", arbint_is_zero(remainder));
+		arbint_divmod(quotient, remainder, g, c);
+		mu_assert("arbint_gcdext: common factor doesn't divide gcd",
+		          arbint_is_zero(remainder));
+		arbint_mul_arbint_into(s, s, a);
+		arbint_mul_arbint_into(t, t, b);
+		arbint_add_into(expected, s, t);
+		mu_assert("arbint_gcdext: s * a + t * b isn't the gcd", arbint_eq(expected, g));
+
+		arbint_gcd(a, a, b);
+		mu_assert("arbint_gcd: result differs from arbint_gcdext", arbint_eq(a, g));
+		arbint_free(x);
+		arbint_free(y);
+		arbint_free(c);
+	}
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(g);
+	arbint_free(s);
+	arbint_free(t);
+	arbint_free(quotient);
+	arbint_free(remainder);
+	arbint_free(expected);
+	return 0;
+}
+
+static char*
+test_arbint_invert()
+{
+	arbint a       = arbint_new();
+	arbint m       = arbint_new();
+	arbint inverse = arbint_new();
+	arbint result  = arbint_new();
+	arbint one     = arbint_new();
+	str_to_arbint("1", one, 10);
+
+	// 3 * 5 = 15 = 1 mod 7, and -3 * 2 = -6 = 1 mod 7
+	str_to_arbint("3", a, 10);
+	str_to_arbint("-7", m, 10);
+	mu_assert("arbint_invert: 3 isn't invertible mod 7", arbint_invert(inverse, a, m));
+	str_to_arbint("5", result, 10);
+	mu_assert("arbint_invert: 1 / 3 mod 7 isn't 5", arbint_eq(inverse, result));
+	str_to_arbint("-3", a, 10);
+	arbint_invert(inverse, a, m);
+	str_to_arbint("2", result, 10);
+	mu_assert("arbint_invert: 1 / -3 mod 7 isn't 2", arbint_eq(inverse, result));
+
+	// No inverse if a and m have a common factor, and 0 is the inverse mod 1
+	str_to_arbint("14", a, 10);
+	mu_assert("arbint_invert: 14 is invertible mod 7", !arbint_invert(inverse, a, m));
+	mu_assert("arbint_invert: result changed", arbint_eq(inverse, result));
+	str_to_arbint("1", m, 10);
+	mu_assert("arbint_invert: 14 isn't invertible mod 1", arbint_invert(inverse, a, m));
+	mu_assert("arbint_invert: 1 / a mod 1 isn't 0", arbint_is_zero(inverse));
+
+	// Odd and even moduli, with the gcd of a and m taken from the Lehmer steps
+	// and from the half-gcd
+	size_t sizes[] = {1, 2, 10, 100, 500};
+	for (size_t i = 0; i < 2 * sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint_free(a);
+		arbint_free(m);
+		a            = random_arbint(sizes[i / 2] + 1);
+		m            = random_arbint(sizes[i / 2]);
+		a->value[0] |= 1;
+		m->value[0]  = i % 2 ? m->value[0] | 1 : m->value[0] & ~(limb_t) 1;
+
+		if (!arbint_invert(inverse, a, m))
+			continue;
+		mu_assert("arbint_invert: inverse isn't reduced", arbint_lt(inverse, m));
+		arbint_mul_arbint_into(result, a, inverse);
+		reference_mod(result, result, m);
+		mu_assert("arbint_invert: a / a mod m isn't 1", arbint_eq(result, one));
+
+		// a^-1 with a negative exponent
+		str_to_arbint("-1", result, 10);
+		arbint_powm(result, a, result, m);
+		mu_assert("arbint_powm: a^-1 isn't the inverse", arbint_eq(result, inverse));
+	}
+
+	arbint_free(a);
+	arbint_free(m);
+	arbint_free(inverse);
+	arbint_free(result);
+	arbint_free(one);
+	return 0;
+}
+
+static void
+reference_power_of_two(arbint result, size_t exponent)
+{
+	// 2^exponent by doubling, which is how shifts had to be done before
+	str_to_arbint("1", result, 10);
+	for (size_t i = 0; i < exponent; i++)
+	{
+		arbint_mul(result, 2);
+	}
+}
+
+static char*
+test_arbint_shift()
+{
+	arbint result    = arbint_new();
+	arbint expected  = arbint_new();
+	arbint power     = arbint_new();
+	arbint remainder = arbint_new();
+
+	// -5 >> 1 = floor(-2.5) = -3, and negative numbers shift to -1
+	str_to_arbint("-5", result, 10);
+	arbint_shr(result, result, 1);
+	str_to_arbint("-3", expected, 10);
+	mu_assert("arbint_shr: -5 >> 1 isn't -3", arbint_eq(result, expected));
+	arbint_shr(result, result, 1000);
+	str_to_arbint("-1", expected, 10);
+	mu_assert("arbint_shr: -3 >> 1000 isn't -1", arbint_eq(result, expected));
+
+	size_t sizes[]  = {1, 2, 7, 30};
+	size_t counts[] = {0, 1, LIMB_BITS - 1, LIMB_BITS, LIMB_BITS + 1, 200, 1000};
+	for (size_t i = 0; i < 2 * sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(counts) / sizeof(counts[0]); j++)
+		{
+			arbint a = random_arbint(sizes[i / 2]);
+			a->sign  = i % 2 ? NEGATIVE : POSITIVE;
+			reference_power_of_two(power, counts[j]);
+
+			arbint_mul_arbint_into(expected, a, power);
+			arbint_shl(result, a, counts[j]);
+			mu_assert("arbint_shl: a << n isn't a * 2^n", arbint_eq(result, expected));
+
+			// Rounded down, so a negative remainder takes one off the quotient
+			arbint_divmod(expected, remainder, a, power);
+			if (remainder->sign == NEGATIVE && !arbint_is_zero(remainder))
+			{
+				str_to_arbint("1", remainder, 10);
+				arbint_sub_into(expected, expected, remainder);
+			}
+			arbint_shr(result, a, counts[j]);
+			mu_assert("arbint_shr: a >> n isn't a / 2^n", arbint_eq(result, expected));
+			arbint_shr(a, a, counts[j]);
+			mu_assert("arbint_shr: wrong result in place", arbint_eq(a, expected));
+
+			arbint_shl(a, a, counts[j] + 3);
+			arbint_shl(expected, expected, counts[j] + 3);
+			mu_assert("arbint_shl: wrong result in place", arbint_eq(a, expected));
+			arbint_free(a);
+		}
+	}
+
+	arbint_free(result);
+	arbint_free(expected);
+	arbint_free(power);
+	arbint_free(remainder);
+	return 0;
+}
+
+static char*
+test_arbint_bitwise()
+{
+	arbint a        = arbint_new();
+	arbint b        = arbint_new();
+	arbint r_and    = arbint_new();
+	arbint r_or     = arbint_new();
+	arbint r_xor    = arbint_new();
+	arbint result   = arbint_new();
+	arbint expected = arbint_new();
+
+	// 12 & -8 = 01100 & ...11000 = 8, -6 | 5 = ...11010 | 00101 = -1
+	str_to_arbint("12", a, 10);
+	str_to_arbint("-8", b, 10);
+	arbint_and(result, a, b);
+	str_to_arbint("8", expected, 10);
+	mu_assert("arbint_and: 12 & -8 isn't 8", arbint_eq(result, expected));
+	str_to_arbint("-6", a, 10);
+	str_to_arbint("5", b, 10);
+	arbint_or(result, a, b);
+	str_to_arbint("-1", expected, 10);
+	mu_assert("arbint_or: -6 | 5 isn't -1", arbint_eq(result, expected));
+
+	// Every bit of the results, including a few above both numbers, where
+	// negative numbers have ones
+	size_t sizes[][2] = {{1, 1}, {3, 1}, {1, 4}, {5, 5}};
+	for (size_t i = 0; i < 4 * sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		arbint_free(a);
+		arbint_free(b);
+		a       = random_arbint(sizes[i / 4][0]);
+		b       = random_arbint(sizes[i / 4][1]);
+		a->sign = i % 2 ? NEGATIVE : POSITIVE;
+		b->sign = i % 4 >= 2 ? NEGATIVE : POSITIVE;
+		arbint_and(r_and, a, b);
+		arbint_or(r_or, a, b);
+		arbint_xor(r_xor, a, b);
+		arbint_not(result, a);
+
+		bool bits_match = true;
+		for (size_t bit = 0; bit < 6 * LIMB_BITS; bit++)
+		{
+			bool a_bit = arbint_test_bit(a, bit);
+			bool b_bit = arbint_test_bit(b, bit);
+			bits_match = bits_match && arbint_test_bit(r_and, bit) == (a_bit && b_bit);
+			bits_match = bits_match && arbint_test_bit(r_or, bit) == (a_bit || b_bit);
+			bits_match = bits_match && arbint_test_bit(r_xor, bit) == (a_bit != b_bit);
+			bits_match = bits_match && arbint_test_bit(result, bit) == !a_bit;
+		}
+		mu_assert("arbint bitwise operations: wrong bits", bits_match);
+
+		// (a | b) + (a & b) = a + b and (a | b) - (a & b) = a ^ b
+		arbint_add_into(expected, a, b);
+		arbint_add_into(result, r_or, r_and);
+		mu_assert("arbint_or: (a | b) + (a & b) isn't a + b",
+		          arbint_eq(result, expected));
+		arbint_sub_into(result, r_or, r_and);
+		mu_assert("arbint_xor: (a | b) - (a & b) isn't a ^ b",
+		          arbint_eq(result, r_xor));
+
+		// In place, with (a ^ b) | b = a | b
+		arbint_xor(a, a, b);
+		mu_assert("arbint_xor: wrong result in place", arbint_eq(a, r_xor));
+		arbint_or(b, a, b);
+		mu_assert("arbint_or: wrong result in place", arbint_eq(b, r_or));
+		arbint_not(a, a);
+		arbint_not(a, a);
+		mu_assert("arbint_not: ~~a isn't a", arbint_eq(a, r_xor));
+	}
+
+	arbint_free(a);
+	arbint_free(b);
+	arbint_free(r_and);
+	arbint_free(r_or);
+	arbint_free(r_xor);
+	arbint_free(result);
+	arbint_free(expected);
+	return 0;
+}
+
+static char*
+test_arbint_bits()
+{
+	arbint a        = arbint_new();
+	arbint bit      = arbint_new();
+	arbint expected = arbint_new();
+
+	str_to_arbint("0", a, 10);
+	mu_assert("arbint_bit_length: 0 doesn't have 0 bits", arbint_bit_length(a) == 0);
+	mu_assert("arbint_trailing_zeros: wrong result for 0",
+	          arbint_trailing_zeros(a) == SIZE_MAX);
+	str_to_arbint("-6", a, 10);
+	mu_assert("arbint_popcount: wrong result for -6", arbint_popcount(a) == SIZE_MAX);
+	mu_assert("arbint_trailing_zeros: wrong result for -6",
+	          arbint_trailing_zeros(a) == 1);
+
+	// Set and clear bits below, inside and above numbers of both signs, and
+	// compare with | 2^i and & ~2^i
+	size_t indices[] = {0, 1, LIMB_BITS - 1, LIMB_BITS, 3 * LIMB_BITS + 5,
+	                    10 * LIMB_BITS};
+	for (size_t i = 0; i < 6; i++)
+	{
+		for (size_t j = 0; j < sizeof(indices) / sizeof(indices[0]); j++)
+		{
+			arbint_free(a);
+			a       = random_arbint(1 + i / 2);
+			a->sign = i % 2 ? NEGATIVE : POSITIVE;
+			str_to_arbint("1", bit, 10);
+			arbint_shl(bit, bit, indices[j]);
+
+			arbint_or(expected, a, bit);
+			arbint_set_bit(a, indices[j]);
+			mu_assert("arbint_set_bit: wrong result", arbint_eq(a, expected));
+			mu_assert("arbint_test_bit: bit isn't set", arbint_test_bit(a, indices[j]));
+
+			arbint_not(bit, bit);
+			arbint_and(expected, a, bit);
+			arbint_clear_bit(a, indices[j]);
+			mu_assert("arbint_clear_bit: wrong result", arbint_eq(a, expected));
+			mu_assert("arbint_test_bit: bit is set", !arbint_test_bit(a, indices[j]));
+		}
+
+		if (a->sign == POSITIVE)
+		{
+			size_t ones = 0;
+			for (size_t k = 0; k < a->length * LIMB_BITS; k++)
+			{
+				ones += arbint_test_bit(a, k);
+			}
+			mu_assert("arbint_popcount: wrong count", arbint_popcount(a) == ones);
+		}
+	}
+
+	// 2^k has k + 1 bits and k trailing zeros
+	for (size_t k = 0; k < 300; k += 37)
+	{
+		str_to_arbint("-1", a, 10);
+		arbint_shl(a, a, k);
+		mu_assert("arbint_bit_length: wrong result", arbint_bit_length(a) == k + 1);
+		mu_assert("arbint_trailing_zeros: wrong result", arbint_trailing_zeros(a) == k);
+	}
+
+	arbint_free(a);
+	arbint_free(bit);
+	arbint_free(expected);
+	return 0;
+}
+
+static char*
+test_limbs_kernels()
+{
+	// The kernels against a limb by limb computation in a dlimb_t, for every
+	// length up to a few unrolled blocks. Limbs of all ones carry into every
+	// next limb.
+	for (size_t n = 1; n <= 13; n++)
+	{
+		for (size_t k = 0; k < 4; k++)
+		{
+			arbint a  = random_arbint(n);
+			arbint b  = random_arbint(n);
+			arbint c  = random_arbint(n);
+			limb_t* r = malloc(2 * n * sizeof(limb_t));
+			limb_t* e = calloc(2 * n, sizeof(limb_t));
+			limb_t m  = k % 2 ? LIMB_MAX : b->value[0] | 1;
+			if (k >= 2)
+			{
+				memset(a->value, 0xFF, n * sizeof(limb_t));
+				memset(c->value, 0xFF, n * sizeof(limb_t));
+			}
+			if (k == 3)
+				memset(b->value, 0xFF, n * sizeof(limb_t));
+
+			bool correct = true;
+			dlimb_t sum  = 0;
+			dlimb_t diff = 0;
+			dlimb_t prod = 0;
+			dlimb_t acc  = 0;
+			limb_t carry = limbs_add_n(r, a->value, b->value, n);
+			for (size_t i = 0; i < n; i++)
+			{
+				sum      = (sum >> LIMB_BITS) + a->value[i] + b->value[i];
+				correct &= r[i] == (limb_t) sum;
+			}
+			correct &= carry == (limb_t)(sum >> LIMB_BITS);
+
+			carry = limbs_sub_n(r, a->value, b->value, n);
+			for (size_t i = 0; i < n; i++)
+			{
+				limb_t borrow = (limb_t)(diff >> LIMB_BITS) & 1;
+				diff          = (dlimb_t) a->value[i] - b->value[i] - borrow;
+				correct      &= r[i] == (limb_t) diff;
+			}
+			correct &= carry == ((limb_t)(diff >> LIMB_BITS) & 1);
+
+			carry = limbs_mul_1(r, a->value, n, m);
+			for (size_t i = 0; i < n; i++)
+			{
+				prod     = (prod >> LIMB_BITS) + (dlimb_t) a->value[i] * m;
+				correct &= r[i] == (limb_t) prod;
+			}
+			correct &= carry == (limb_t)(prod >> LIMB_BITS);
+
+			memcpy(r, c->value, n * sizeof(limb_t));
+			carry = limbs_addmul_1(r, a->value, n, m);
+			for (size_t i = 0; i < n; i++)
+			{
+				acc      = (acc >> LIMB_BITS) + (dlimb_t) a->value[i] * m + c->value[i];
+				correct &= r[i] == (limb_t) acc;
+			}
+			correct &= carry == (limb_t)(acc >> LIMB_BITS);
+			mu_assert("limbs kernels: wrong result", correct);
+
+			for (size_t bn = 1; bn <= n; bn++)
+			{
+				for (size_t i = 0; i < bn; i++)
+				{
+					prod = 0;
+					for (size_t j = 0; j < n; j++)
+					{
+						prod = (prod >> LIMB_BITS) + (dlimb_t) a->value[j] * b->value[i]
+						     + e[i + j];
+						e[i + j] = (limb_t) prod;
+					}
+					e[i + n] = (limb_t)(prod >> LIMB_BITS);
+				}
+				limbs_mul_basecase(r, a->value, n, b->value, bn);
+				mu_assert("limbs_mul_basecase: wrong product",
+				          limbs_cmp(r, e, n + bn) == 0);
+				memset(e, 0, 2 * n * sizeof(limb_t));
+			}
+
+			arbint_free(a);
+			arbint_free(b);
+			arbint_free(c);
+			free(r);
+			free(e);
+		}
+	}
+	return 0;
+}
+
+static char*
+test_limbs_div_qr()
+{
+	// n = q * d + r with the largest possible remainder. Quotient limbs that
+	// are all ones and divisors with a top limb of all ones need the rarely
+	// taken corrections of the quotient estimates. The larger sizes are
+	// divided recursively.
+	size_t d_sizes[] = {1, 2, 3, 10, 40, 100, 300};
+	size_t q_sizes[] = {1, 2, 5, 30, 200, 700};
+	limb_t tops[]    = {0, 1, 0x80, LIMB_MAX >> 1, LIMB_MAX};
+
+	for (size_t i = 0; i < sizeof(d_sizes) / sizeof(d_sizes[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(q_sizes) / sizeof(q_sizes[0]); j++)
+		{
+			for (size_t k = 0; k < 2 * sizeof(tops) / sizeof(tops[0]); k++)
+			{
+				size_t dn = d_sizes[i];
+				size_t qn = q_sizes[j];
+				size_t nn = qn + dn;
+				arbint d  = random_arbint(dn);
+				arbint q  = random_arbint(qn);
+				limb_t* r = malloc(dn * sizeof(limb_t));
+				limb_t* n = malloc(nn * sizeof(limb_t));
+
+				// Random top limbs for k == 0, the given ones otherwise
+				limb_t top = tops[k / 2];
+				d->value[dn - 1] |= 1;
+				if (top)
+					d->value[dn - 1] = top;
+				if (k % 2)
+					memset(q->value, 0xFF, qn * sizeof(limb_t));
+				limbs_sub_1(r, d->value, dn, 1);
+
+				if (qn >= dn)
+					limbs_mul(n, q->value, qn, d->value, dn);
+				else
+					limbs_mul(n, d->value, dn, q->value, qn);
+				limbs_add(n, n, nn, r, dn);
+
+				limb_t* quotient  = malloc((qn + 1) * sizeof(limb_t));
+				limb_t* remainder = malloc(dn * sizeof(limb_t));
+				limbs_div_qr(quotient, remainder, n, nn, d->value, dn);
+				mu_assert("limbs_div_qr: wrong quotient",
+				          limbs_cmp(quotient, q->value, qn) == 0 && quotient[qn] == 0);
+				mu_assert("limbs_div_qr: wrong remainder",
+				          limbs_cmp(remainder, r, dn) == 0);
+
+				arbint_free(d);
+				arbint_free(q);
+				free(r);
+				free(n);
+				free(quotient);
+				free(remainder);
+			}
+		}
+	}
+	return 0;
+}
+
+static char*
+test_arbint_to_str()
+{
+	arbint a = arbint_new();
+	char* str;
+
+	arbint_to_str(a, &str, 10);
+	mu_assert("arbint_to_str: 0 isn't \"0\"", !strcmp(str, "0"));
+	free(str);
+	a->sign = NEGATIVE;
+	arbint_to_str(a, &str, 10);
+	mu_assert("arbint_to_str: -0 isn't \"0\"", !strcmp(str, "0"));
+	free(str);
+
+	str_to_arbint("-18446744073709551616", a, 10);
+	arbint_to_str(a, &str, 10);
+	mu_assert("arbint_to_str: -2^64 in base 10", !strcmp(str, "-18446744073709551616"));
+	free(str);
+	arbint_to_str(a, &str, 36);
+	mu_assert("arbint_to_str: -2^64 in base 36", !strcmp(str, "-3W5E11264SGSG"));
+	free(str);
+	arbint_to_str(a, &str, 7);
+	mu_assert("arbint_to_str: -2^64 in base 7", !strcmp(str, "-45012021522523134134602"));
+	free(str);
+	arbint_to_str(a, &str, 2);
+	mu_assert("arbint_to_str: -2^64 in base 2",
+	          str[0] == '-' && str[1] == '1' && strspn(str + 2, "0") == 64 && !str[66]);
+	free(str);
+
+	// Powers of the base and the numbers just below them, where the bit length
+	// alone doesn't tell the number of digits
+	const char* digits_36 = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	uint32_t bases[]      = {3, 7, 10, 36};
+	size_t exponents[]    = {1, 19, 20, 41, 500, 3000};
+	bool sizes_correct    = true;
+	for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++)
+	{
+		for (size_t j = 0; j < sizeof(exponents) / sizeof(exponents[0]); j++)
+		{
+			arbint power = power_of(bases[i], exponents[j]);
+			for (size_t k = 0; k < 2; k++)
+			{
+				size_t digits = exponents[j] + 1 - k;
+				size_t size   = limbs_to_str_size(power->value, power->length, bases[i]);
+				arbint_to_str(power, &str, bases[i]);
+				char top      = k ? digits_36[bases[i] - 1] : '1';
+				sizes_correct = sizes_correct && size == digits;
+				sizes_correct = sizes_correct && strlen(str) == digits && str[0] == top;
+				free(str);
+				limbs_sub_1(power->value, power->value, power->length, 1);
+				power->length = limbs_significant(power->value, power->length);
+			}
+			arbint_free(power);
+		}
+	}
+	mu_assert("arbint_to_str: wrong length next to a power of the base", sizes_correct);
+
+	// Round trips in all bases, with numbers long enough for several levels of
+	// divide and conquer
+	size_t lengths[] = {1, 2, 29, 30, 31, 100, 1000};
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+	{
+		for (uint32_t base = 2; base <= 36; base++)
+		{
+			arbint b = random_arbint(lengths[i]);
+			arbint c = arbint_new();
+			b->value[lengths[i] - 1] |= 1;
+			b->sign = base % 2 ? NEGATIVE : POSITIVE;
+
+			arbint_to_str(b, &str, base);
+			str_to_arbint(str, c, base);
+			mu_assert("arbint_to_str doesn't parse back to the same number",
+			          arbint_eq(b, c));
+
+			size_t digits = strlen(str) - (b->sign == NEGATIVE);
+			size_t size   = limbs_to_str_size(b->value, b->length, base);
+			mu_assert("arbint_to_str: leading zero", str[b->sign == NEGATIVE] != '0');
+			mu_assert("limbs_to_str_size: wrong size", digits == size);
+
+			free(str);
+			arbint_free(b);
+			arbint_free(c);
+		}
+	}
+
+	arbint_free(a);
+	return 0;
+}
+
 static char*
 test_highest_digit()
 {
-	arbint a    = arbint_new_length(8);
-	a->length   = 8;
+	// Digits with leading zeros become a normalized value
+	arbint a = arbint_new_length(8);
+	memset(a->value, 0, 8 * sizeof(limb_t));
 	a->sign     = POSITIVE;
 	a->value[0] = 10;
 	a->value[4] = 10;
+	arbint_normalize(a, 8);
+	mu_assert("arbint_normalize failed", a->length == 5);
 	mu_assert("arbint_highest_digit failed (1)", arbint_highest_digit(a) == 4);
 
 	str_to_arbint("-deadd00d121337", a, 16);
-	mu_assert("arbint_highest_digit failed (2)", arbint_highest_digit(a) == 1);
+	mu_assert("arbint_highest_digit failed (2)",
+	          arbint_highest_digit(a) == LIMBS_FOR_U32(2) - 1);
 	return 0;
 }
 
@@ -556,14 +2509,18 @@ test_trim()
 {
 	arbint a = arbint_new_empty();
 
-	str_to_arbint("9999999999999999999999999999999999999", a, 10);
-	mu_assert("str_to_arbint in test_trim failed", a->length == 4);
+	str_to_arbint("99999999999999999999999999999999999999999999999999999999999", a, 10);
+	mu_assert("str_to_arbint in test_trim failed", a->length == LIMBS_FOR_U32(7));
 
+	// A shorter value keeps the capacity
 	str_to_arbint("4294967296", a, 10);
-	mu_assert("str_to_arbint changed length", a->length == 4);
+	mu_assert("str_to_arbint has the wrong length", a->length == LIMBS_FOR_U32(2));
+	mu_assert("str_to_arbint changed capacity", a->capacity >= LIMBS_FOR_U32(7));
 
 	arbint_trim(a);
-	mu_assert("arbint_trim failed to reduce length", a->length == 2);
+	mu_assert("arbint_trim failed to reduce capacity", arbint_value_is_inline(a));
+	mu_assert("arbint_trim changed the value",
+	          a->length == LIMBS_FOR_U32(2) && a->value[LIMBS_FOR_U32(2) - 1] != 0);
 
 	arbint_free(a);
 
@@ -580,7 +2537,8 @@ test_init_functions()
 	arbint_free(a);
 
 	arbint b = arbint_new_length(5);
-	mu_assert("arbint_new_length did not produce correct length", b->length == 5);
+	mu_assert("arbint_new_length did not produce length 1", b->length == 1);
+	mu_assert("arbint_new_length did not produce correct capacity", b->capacity == 5);
 	mu_assert("arbint_new_length did not produce value 0", arbint_is_zero(b));
 	mu_assert("arbint_new_length did not produce sign POSITIVE", b->sign == POSITIVE);
 	arbint_free(b);
@@ -606,22 +2564,48 @@ all_tests()
 	// Constructors/parsing
 	mu_run_test(test_init_functions);
 	mu_run_test(test_str_to_arbint);
+	mu_run_test(test_count_valid_digits);
+	mu_run_test(test_str_to_arbint_long);
+	mu_run_test(test_str_to_arbint_prefix);
 	mu_run_test(test_u64_to_arbint);
+	mu_run_test(test_inline_values);
 
 	// Operators
 	mu_run_test(test_arbint_eq);
 	mu_run_test(test_comparison);
 	mu_run_test(test_arbint_mul);
+	mu_run_test(test_arbint_mul_arbint);
+	mu_run_test(test_arbint_sqr);
 	mu_run_test(test_str_mul_eq);
 	mu_run_test(test_arbint_add);
 	mu_run_test(test_arbint_sub);
+	mu_run_test(test_into_functions);
+	mu_run_test(test_inplace_functions);
+	mu_run_test(test_arbint_sum_and_dot);
+	mu_run_test(test_products);
+	mu_run_test(test_threaded_multiplication);
+	mu_run_test(test_threaded_arena);
+	mu_run_test(test_arbint_divmod_ui);
+	mu_run_test(test_limbs_kernels);
+	mu_run_test(test_limbs_div_qr);
+	mu_run_test(test_arbint_divmod);
+	mu_run_test(test_arbint_mod_ctx);
+	mu_run_test(test_arbint_powm);
+	mu_run_test(test_arbint_gcd);
+	mu_run_test(test_arbint_invert);
+	mu_run_test(test_arbint_shift);
+	mu_run_test(test_arbint_bitwise);
+	mu_run_test(test_arbint_bits);
 
 	// Memory management etc.
 	mu_run_test(test_arbint_copy);
 	mu_run_test(test_set_zero_and_reset);
+	mu_run_test(test_memory_functions);
+	mu_run_test(test_arena);
 
 	// Output
 	mu_run_test(test_arbint_to_hex);
+	mu_run_test(test_arbint_to_str);
 	return 0;
 }
 